@@ -0,0 +1,501 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+#include "example.h"
+#include "mesh.h"
+#include "mesh_file.h"
+#include "model_cook.h"
+#include "texture_cook.h"
+#include "texture_file.h"
+#include "thread_pool.h"
+
+// written into the output directory, one "hash name" line per cooked asset
+static const char *MANIFEST_NAME = "cook_manifest.txt";
+static const char *MODEL_EXTENSIONS[] = {".obj"};
+static const uint32_t MODEL_EXTENSION_COUNT = sizeof(MODEL_EXTENSIONS) / sizeof(const char *);
+static const char *IMAGE_EXTENSIONS[] = {".jpg", ".jpeg", ".png", ".tga", ".bmp"};
+static const uint32_t IMAGE_EXTENSION_COUNT = sizeof(IMAGE_EXTENSIONS) / sizeof(const char *);
+// the images of a directory named like this are packed into one texture instead of one each
+static const char *ATLAS_EXTENSIONS[] = {".atlas"};
+static const uint32_t ATLAS_EXTENSION_COUNT = sizeof(ATLAS_EXTENSIONS) / sizeof(const char *);
+// most images an atlas directory may hold
+#define ATLAS_MAX_IMAGES 1024
+
+typedef enum asset_type {
+    ASSET_MODEL,
+    ASSET_IMAGE,
+    ASSET_ATLAS
+} asset_type;
+
+typedef enum cook_result {
+    COOK_FAILED,
+    COOK_SKIPPED,
+    COOK_DONE
+} cook_result;
+
+typedef struct asset {
+    char source[MAX_PATH]; // as opened, relative to the working directory like the renderer's paths
+    const char *name;      // part of source below the source directory, used for the output and the manifest, set once the scan is done
+    asset_type type;
+    uint64_t hash;         // content and settings, what the manifest remembers
+    cook_result result;
+    float seconds;
+} asset;
+
+typedef struct manifest_entry {
+    uint64_t hash;
+    char name[MAX_PATH];
+} manifest_entry;
+
+typedef struct cooker {
+    char source_dir[MAX_PATH];
+    char output_dir[MAX_PATH];
+    bool force;
+    model_cook_settings settings;
+    texture_cook_settings texture_settings;
+    texture_atlas_settings atlas_settings;
+    thread_pool *pool;
+
+    asset *assets;
+    uint32_t asset_count;
+    uint32_t asset_capacity;
+
+    // the manifest of the last run, sorted by name
+    manifest_entry *entries;
+    uint32_t entry_count;
+} cooker;
+
+static bool has_extension(const char *name, const char **extensions, uint32_t extension_count) {
+    const char *dot = strrchr(name, '.');
+    for (uint32_t i = 0; dot && i < extension_count; ++i) {
+        if (!_stricmp(dot, extensions[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_same_directory(const char *a, const char *b) {
+    char full_a[MAX_PATH];
+    char full_b[MAX_PATH];
+    return GetFullPathNameA(a, MAX_PATH, full_a, NULL) && GetFullPathNameA(b, MAX_PATH, full_b, NULL) && !_stricmp(full_a, full_b);
+}
+
+static bool add_asset(cooker *self, const char *source, asset_type type) {
+    if (self->asset_count == self->asset_capacity) {
+        uint32_t capacity = self->asset_capacity ? self->asset_capacity * 2 : 64;
+        asset *assets = realloc(self->assets, capacity * sizeof(asset));
+        if (!assets) {
+            return false;
+        }
+        self->assets = assets;
+        self->asset_capacity = capacity;
+    }
+
+    asset *item = self->assets + self->asset_count ++;
+    memset(item, 0, sizeof(asset));
+    snprintf(item->source, MAX_PATH, "%s", source);
+    item->type = type;
+    return true;
+}
+
+static bool scan_directory(cooker *self, const char *directory) {
+    char pattern[MAX_PATH];
+    snprintf(pattern, MAX_PATH, "%s\\*", directory);
+
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) {
+        printf("Scan %s failed!\n", directory);
+        return false;
+    }
+
+    bool ret = true;
+    char path[MAX_PATH];
+    do {
+        if (!strcmp(data.cFileName, ".") || !strcmp(data.cFileName, "..")) {
+            continue;
+        }
+        snprintf(path, MAX_PATH, "%s\\%s", directory, data.cFileName);
+
+        // an output directory inside the source directory holds cooked files, not sources
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && has_extension(data.cFileName, ATLAS_EXTENSIONS, ATLAS_EXTENSION_COUNT)) {
+            ret = add_asset(self, path, ASSET_ATLAS) && ret;
+        } else if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (!is_same_directory(path, self->output_dir)) {
+                ret = scan_directory(self, path) && ret;
+            }
+        } else if (has_extension(data.cFileName, MODEL_EXTENSIONS, MODEL_EXTENSION_COUNT)) {
+            ret = add_asset(self, path, ASSET_MODEL) && ret;
+        } else if (has_extension(data.cFileName, IMAGE_EXTENSIONS, IMAGE_EXTENSION_COUNT)) {
+            ret = add_asset(self, path, ASSET_IMAGE) && ret;
+        }
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    return ret;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const manifest_entry *)a)->name, ((const manifest_entry *)b)->name);
+}
+
+static void read_manifest(cooker *self) {
+    char file_name[MAX_PATH];
+    snprintf(file_name, MAX_PATH, "%s\\%s", self->output_dir, MANIFEST_NAME);
+
+    char *content = NULL;
+    uint32_t length = 0;
+    if (!read_file(file_name, (void **)&content, &length)) {
+        return;
+    }
+
+    // one line per entry, a missing or damaged manifest only costs a full cook
+    uint32_t line_count = 0;
+    for (uint32_t i = 0; i < length; ++i) {
+        line_count += content[i] == '\n';
+    }
+    self->entries = malloc(MAX(line_count, 1) * sizeof(manifest_entry));
+    if (!self->entries) {
+        free(content);
+        return;
+    }
+
+    uint32_t i = 0;
+    while (i < length) {
+        uint32_t line_end = i;
+        while (line_end < length && content[line_end] != '\n') {
+            ++ line_end;
+        }
+
+        // 16 hex digits, a space and the name
+        uint32_t name_length = line_end - i;
+        while (name_length > 0 && content[i + name_length - 1] == '\r') {
+            -- name_length;
+        }
+        if (line_end < length && name_length > 17 && name_length - 17 < MAX_PATH && content[i + 16] == ' ') {
+            manifest_entry *entry = self->entries + self->entry_count ++;
+            entry->hash = strtoull(content + i, NULL, 16);
+            memcpy(entry->name, content + i + 17, name_length - 17);
+            entry->name[name_length - 17] = '\0';
+        }
+
+        i = line_end + 1;
+    }
+    free(content);
+
+    qsort(self->entries, self->entry_count, sizeof(manifest_entry), compare_entries);
+}
+
+static bool write_manifest(const cooker *self) {
+    char file_name[MAX_PATH];
+    snprintf(file_name, MAX_PATH, "%s\\%s", self->output_dir, MANIFEST_NAME);
+
+    FILE *file = fopen(file_name, "wb");
+    if (!file) {
+        return false;
+    }
+
+    // failed assets are left out so the next run tries them again
+    for (uint32_t i = 0; i < self->asset_count; ++i) {
+        const asset *item = self->assets + i;
+        if (item->result != COOK_FAILED) {
+            fprintf(file, "%016llx %s\n", (unsigned long long)item->hash, item->name);
+        }
+    }
+
+    return fclose(file) == 0;
+}
+
+static bool is_up_to_date(const cooker *self, const asset *item, const char *output) {
+    if (self->entry_count == 0) {
+        return false;
+    }
+
+    manifest_entry key;
+    snprintf(key.name, MAX_PATH, "%s", item->name);
+    const manifest_entry *entry = bsearch(&key, self->entries, self->entry_count, sizeof(manifest_entry), compare_entries);
+    return entry && entry->hash == item->hash && GetFileAttributesA(output) != INVALID_FILE_ATTRIBUTES;
+}
+
+// create every missing directory on the way to file_name, workers may race on the same ones
+static void create_parent_directories(const char *file_name) {
+    char path[MAX_PATH];
+    snprintf(path, MAX_PATH, "%s", file_name);
+    for (char *p = path; *p; ++p) {
+        if ((*p == '\\' || *p == '/') && p != path && p[-1] != ':') {
+            char separator = *p;
+            *p = '\0';
+            CreateDirectoryA(path, NULL);
+            *p = separator;
+        }
+    }
+}
+
+// name under the output directory, with the extension swapped if extension is not NULL
+static bool get_output_path(const cooker *self, const asset *item, const char *extension, char *output) {
+    int length = snprintf(output, MAX_PATH, "%s\\%s", self->output_dir, item->name);
+    if (length <= 0 || length >= MAX_PATH) {
+        return false;
+    }
+
+    // every asset name has an extension, it is how the scan picked them
+    char *dot = strrchr(output, '.');
+    size_t space = MAX_PATH - (dot - output);
+    return !extension || (size_t)snprintf(dot, space, "%s", extension) < space;
+}
+
+static cook_result cook_model(const cooker *self, asset *item, const mapped_file *source) {
+    char output[MAX_PATH];
+    if (!get_output_path(self, item, ".bin", output)) {
+        return COOK_FAILED;
+    }
+
+    item->hash = model_cook_source_hash(source, &(self->settings));
+    if (!self->force && is_up_to_date(self, item, output)) {
+        return COOK_SKIPPED;
+    }
+
+    mesh model = {0};
+    create_parent_directories(output);
+    bool ret = model_cook(source, self->pool, &(self->settings), &model) && mesh_file_write(output, item->hash, &model, 1);
+    mesh_free(&model);
+    return ret ? COOK_DONE : COOK_FAILED;
+}
+
+static cook_result cook_image(const cooker *self, asset *item, const mapped_file *source) {
+    char output[MAX_PATH];
+    if (!get_output_path(self, item, ".tex", output)) {
+        return COOK_FAILED;
+    }
+
+    item->hash = texture_cook_source_hash(source, &(self->texture_settings));
+    if (!self->force && is_up_to_date(self, item, output)) {
+        return COOK_SKIPPED;
+    }
+
+    texture_chain chain = {0};
+    create_parent_directories(output);
+    bool ret = texture_cook(source, self->pool, &(self->texture_settings), &chain) && texture_file_write(output, item->hash, &chain);
+    texture_chain_free(&chain);
+    return ret ? COOK_DONE : COOK_FAILED;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp((const char *)a, (const char *)b);
+}
+
+// the images directly inside an atlas directory, sorted so the packing does not depend on the order the file system lists them in
+static uint32_t find_atlas_images(const char *directory, char (*names)[MAX_PATH], uint32_t capacity) {
+    char pattern[MAX_PATH];
+    snprintf(pattern, MAX_PATH, "%s\\*", directory);
+
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    do {
+        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && has_extension(data.cFileName, IMAGE_EXTENSIONS, IMAGE_EXTENSION_COUNT) && count < capacity) {
+            snprintf(names[count ++], MAX_PATH, "%s", data.cFileName);
+        }
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+
+    qsort(names, count, MAX_PATH, compare_names);
+    return count;
+}
+
+// where each image went, one "layer scale_u scale_v offset_u offset_v name" line per image,
+// the models sampling the atlas are authored against it, their texcoords are not remapped here
+static bool write_atlas_table(const char *file_name, char (*names)[MAX_PATH], const texture_atlas_entry *entries, uint32_t count) {
+    FILE *file = fopen(file_name, "w");
+    if (!file) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const texture_atlas_entry *entry = entries + i;
+        fprintf(file, "%u %.9g %.9g %.9g %.9g %s\n", entry->layer, entry->uv_scale[0], entry->uv_scale[1], entry->uv_offset[0], entry->uv_offset[1], names[i]);
+    }
+    return fclose(file) == 0;
+}
+
+static cook_result cook_atlas(const cooker *self, asset *item) {
+    char output[MAX_PATH];
+    char table[MAX_PATH];
+    if (!get_output_path(self, item, ".tex", output) || !get_output_path(self, item, ".txt", table)) {
+        return COOK_FAILED;
+    }
+
+    char (*names)[MAX_PATH] = malloc(ATLAS_MAX_IMAGES * MAX_PATH);
+    mapped_file *sources = calloc(ATLAS_MAX_IMAGES, sizeof(mapped_file));
+    texture_atlas_entry *entries = calloc(ATLAS_MAX_IMAGES, sizeof(texture_atlas_entry));
+    uint32_t count = names && sources && entries ? find_atlas_images(item->source, names, ATLAS_MAX_IMAGES) : 0;
+
+    // names and contents of every image and the atlas settings
+    bool ret = count > 0;
+    item->hash = hash_bytes(&(self->atlas_settings), sizeof(texture_atlas_settings), 0);
+    for (uint32_t i = 0; i < count && ret; ++i) {
+        char path[MAX_PATH];
+        snprintf(path, MAX_PATH, "%s\\%s", item->source, names[i]);
+        ret = map_file(path, sources + i);
+        if (ret) {
+            uint64_t image_hash = texture_cook_source_hash(sources + i, &(self->texture_settings));
+            item->hash = hash_bytes(names[i], strlen(names[i]), item->hash);
+            item->hash = hash_bytes(&image_hash, sizeof(image_hash), item->hash);
+        }
+    }
+
+    cook_result result = ret ? COOK_DONE : COOK_FAILED;
+    if (ret && !self->force && is_up_to_date(self, item, output)) {
+        result = COOK_SKIPPED;
+    } else if (ret) {
+        texture_chain chain = {0};
+        create_parent_directories(output);
+        ret = texture_cook_atlas(sources, count, self->pool, &(self->texture_settings), &(self->atlas_settings), entries, &chain)
+            && texture_file_write(output, item->hash, &chain)
+            && write_atlas_table(table, names, entries, count);
+        texture_chain_free(&chain);
+        result = ret ? COOK_DONE : COOK_FAILED;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        unmap_file(sources + i);
+    }
+    free(names);
+    free(sources);
+    free(entries);
+    return result;
+}
+
+static void cook_asset(void *data, size_t index) {
+    cooker *self = data;
+    asset *item = self->assets + index;
+    float start = high_resolution_clock_now();
+
+    // an atlas is a directory, its images are mapped one by one
+    if (item->type == ASSET_ATLAS) {
+        item->result = cook_atlas(self, item);
+        item->seconds = high_resolution_clock_now() - start;
+        return;
+    }
+
+    mapped_file source;
+    if (!map_file(item->source, &source)) {
+        item->result = COOK_FAILED;
+        return;
+    }
+
+    item->result = item->type == ASSET_MODEL ? cook_model(self, item, &source) : cook_image(self, item, &source);
+    unmap_file(&source);
+
+    item->seconds = high_resolution_clock_now() - start;
+}
+
+static void print_usage(void) {
+    printf("usage: AssetCooker <source dir> [output dir] [--force] [--packed-vertices] [--uncompressed] [--atlas-size texels] [--threads count]\n");
+    printf("run it from the directory the renderer runs in, paths and material libraries resolve from there,\n");
+    printf("the output dir defaults to the source dir, so 'AssetCooker resources' cooks next to the sources,\n");
+    printf("the images of a directory named name.atlas are packed into name.tex with the uv transforms in name.txt,\n");
+    printf("models sampling it are authored against name.txt, the renderer loads it as a 2d texture when it fits one layer\n");
+}
+
+int main(int argc, char *argv[]) {
+    example_init();
+
+    cooker self = {0};
+    self.settings = model_cook_default_settings;
+    self.texture_settings = texture_cook_default_settings;
+    self.atlas_settings = texture_atlas_default_settings;
+    const char *source_dir = NULL;
+    const char *output_dir = NULL;
+    uint32_t thread_count = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--force")) {
+            self.force = true;
+        } else if (!strcmp(argv[i], "--packed-vertices")) {
+            self.settings.packed_vertices = true;
+        } else if (!strcmp(argv[i], "--uncompressed")) {
+            self.texture_settings.block_compress = false;
+        } else if (!strcmp(argv[i], "--atlas-size") && i + 1 < argc) {
+            self.atlas_settings.size = (uint32_t)strtoul(argv[++ i], NULL, 10);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            thread_count = (uint32_t)strtoul(argv[++ i], NULL, 10);
+        } else if (argv[i][0] == '-') {
+            print_usage();
+            return EXIT_FAILURE;
+        } else if (!source_dir) {
+            source_dir = argv[i];
+        } else if (!output_dir) {
+            output_dir = argv[i];
+        }
+    }
+    if (!source_dir) {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    // trailing separators would double up when names are joined
+    snprintf(self.source_dir, MAX_PATH, "%s", source_dir);
+    snprintf(self.output_dir, MAX_PATH, "%s", output_dir ? output_dir : source_dir);
+    for (char *dir = self.source_dir; dir; dir = dir == self.source_dir ? self.output_dir : NULL) {
+        size_t length = strlen(dir);
+        while (length > 1 && (dir[length - 1] == '\\' || dir[length - 1] == '/')) {
+            dir[-- length] = '\0';
+        }
+    }
+    CreateDirectoryA(self.output_dir, NULL);
+
+    if (!scan_directory(&self, self.source_dir)) {
+        free(self.assets);
+        return EXIT_FAILURE;
+    }
+    for (uint32_t i = 0; i < self.asset_count; ++i) {
+        self.assets[i].name = self.assets[i].source + strlen(self.source_dir) + 1;
+    }
+    read_manifest(&self);
+
+    // assets are cooked side by side, a single large model or image still spreads its work over the same pool
+    self.pool = thread_pool_new(thread_count);
+    if (!self.pool) {
+        printf("Create thread pool failed!\n");
+        free(self.entries);
+        free(self.assets);
+        return EXIT_FAILURE;
+    }
+    float start = high_resolution_clock_now();
+    thread_pool_parallel_for(self.pool, self.asset_count, cook_asset, &self);
+    float seconds = high_resolution_clock_now() - start;
+    uint32_t worker_count = thread_pool_size(self.pool);
+    thread_pool_delete(self.pool);
+
+    uint32_t counts[3] = {0};
+    static const char *result_names[] = {"failed", "skipped", "cooked"};
+    for (uint32_t i = 0; i < self.asset_count; ++i) {
+        const asset *item = self.assets + i;
+        ++ counts[item->result];
+        if (item->result != COOK_SKIPPED) {
+            printf("%-8s %s (%.3fs)\n", result_names[item->result], item->source, item->seconds);
+        }
+    }
+    printf("%u cooked, %u up to date, %u failed in %.3fs on %u threads\n",
+           counts[COOK_DONE], counts[COOK_SKIPPED], counts[COOK_FAILED], seconds, worker_count);
+
+    bool ret = write_manifest(&self);
+    if (!ret) {
+        printf("Write %s failed!\n", MANIFEST_NAME);
+    }
+
+    free(self.entries);
+    free(self.assets);
+    return ret && counts[COOK_FAILED] == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
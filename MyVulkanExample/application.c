@@ -9,16 +9,44 @@
 #include "vulkan/vulkan.h"
 #include "GLFW/glfw3.h"
 #include "GLFW/glfw3native.h"
-#include "stb_image.h"
-#include "tinyobj_loader_c.h"
 
 #include "example.h"
 #include "application.h"
+#include "memory_pool.h"
+#include "mesh.h"
+#include "mesh_cluster.h"
+#include "mesh_file.h"
+#include "mesh_simplifier.h"
+#include "model_cook.h"
+#include "texture_cook.h"
+#include "texture_file.h"
+#include "texture_loader.h"
+#include "texture_mips.h"
+#include "texture_residency.h"
+#include "thread_pool.h"
+#include "virtual_texture.h"
+#include "vk_allocator.h"
 
 static const int WINDOW_WIDTH = 800;
 static const int WINDOW_HEIGHT = 600;
 
 static const uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+// uploads are packed into host visible blocks of this size, a larger upload gets a block of its own
+static const VkDeviceSize UPLOAD_STAGING_BLOCK_SIZE = 32 * 1024 * 1024;
+// covers the texel block size of every format uploaded and the usual optimal copy offset alignment
+static const VkDeviceSize UPLOAD_STAGING_ALIGNMENT = 64;
+// buffers and images are carved out of blocks of this size per memory type, at most an eighth of a small heap,
+// a resource larger than half a block or an attachment recreated with the swap chain gets an allocation of its own
+static const VkDeviceSize MEMORY_BLOCK_SIZE = 64 * 1024 * 1024;
+// heap usage past this share of its budget makes the streamed texture give levels back, below the low mark it may grow again
+static const float MEMORY_BUDGET_HIGH_WATER = 0.9f;
+static const float MEMORY_BUDGET_LOW_WATER = 0.75f;
+// share of a heap taken as the budget where VK_EXT_memory_budget is missing, the rest is left to other processes
+static const float MEMORY_BUDGET_FALLBACK_SHARE = 0.8f;
+// frames between budget queries
+static const uint32_t MEMORY_BUDGET_INTERVAL = 16;
+// frames not measured by the draw benchmark while clocks and caches settle
+static const uint32_t BENCHMARK_WARMUP_FRAMES = 16;
 
 static const char *validation_layer_names[] = {"VK_LAYER_LUNARG_standard_validation"};
 static const uint32_t validation_layer_count = sizeof(validation_layer_names) / sizeof(const char *);
@@ -26,15 +54,61 @@ static const uint32_t validation_layer_count = sizeof(validation_layer_names) /
 static const char *device_extension_names[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 static uint32_t device_extension_count = sizeof(device_extension_names) / sizeof(const char *);
 
+// the model and texture settings are those of the asset cooker run with its defaults, changed only by the constants below,
+// so the binaries it cooked are loaded as they are instead of being rebuilt here
 static const char *MODEL_SRC_PATH = "resources\\chalet.obj";
 static const char *MODEL_BIN_PATH = "resources\\chalet.bin";
+// the coarsest level whose error projects to at most this many pixels is drawn
+static const float MODEL_LOD_PIXEL_ERROR = 1.0f;
+// upload packed_vertex instead of vertex, the pipeline and vertex shader follow this,
+// needs vert_packed.spv built by resources/convert.bat
+static const bool MODEL_PACKED_VERTICES = false;
 static const char *TEXTURE_PATH = "resources\\chalet.jpg";
+static const char *TEXTURE_BIN_PATH = "resources\\chalet.tex";
+// upload every level from TEXTURE_BIN_PATH with one copy, cooked here or by the asset cooker when it is stale,
+// otherwise the image is decoded and its mips are made on every launch
+static const bool TEXTURE_COOKED = true;
+// cook the levels to bc1 or bc3 where textureCompressionBC is supported, rgba8 otherwise
+static const bool TEXTURE_BLOCK_COMPRESSION = true;
+// build texture mips on the cpu even where the gpu could blit them, the fallback is used anyway when it can not
+static const bool TEXTURE_CPU_MIPS = false;
+// the jpeg holds srgb encoded colors although it is sampled as unorm, cpu mips decode them before filtering
+static const bool TEXTURE_SRGB_CONTENT = true;
+// bytes of the cooked mip tail uploaded before the first frame, the finer levels stream in one at a time after it,
+// SIZE_MAX uploads every level at startup
+static const size_t TEXTURE_STREAM_TAIL_SIZE = 256 * 1024;
+// video memory the streamed textures may keep resident, levels past it are not streamed in or are dropped again,
+// update_memory_residency lowers it while their heap nears its budget
+static const size_t TEXTURE_STREAM_BUDGET = 64 * 1024 * 1024;
+// a texture not drawn for this many frames gives up levels to the ones that are
+static const uint32_t TEXTURE_STREAM_IDLE_FRAMES = 300;
+// sample every texture from one partially bound, update after bind array indexed by the material of the draw,
+// falls back to the single texture binding where VK_EXT_descriptor_indexing is missing,
+// needs the bindless spv built by resources/convert.bat
+static const bool TEXTURE_BINDLESS = false;
+// elements of the bindless array, fewer where the device limits are lower
+static const uint32_t TEXTURE_TABLE_SIZE = 4096;
+// sample the cooked texture through a page table from a page cache whose size does not depend on the texture,
+// a low resolution feedback pass picks the pages to upload, takes the place of streaming and the bindless table,
+// needs the virtual and feedback spv built by resources/convert.bat
+static const bool TEXTURE_VIRTUAL = false;
+// the feedback pass renders the swap chain size divided by this
+static const uint32_t VIRTUAL_FEEDBACK_SCALE = 8;
+// pages uploaded in one frame at most
+static const uint32_t VIRTUAL_PAGES_PER_FRAME = 16;
 static const char *VERTEX_SHADER_PATH = "resources\\vert.spv";
+static const char *PACKED_VERTEX_SHADER_PATH = "resources\\vert_packed.spv";
+static const char *BINDLESS_VERTEX_SHADER_PATH = "resources\\vert_bindless.spv";
+static const char *PACKED_BINDLESS_VERTEX_SHADER_PATH = "resources\\vert_packed_bindless.spv";
 static const char *FRAGMENT_SHADER_PATH = "resources\\frag.spv";
+static const char *BINDLESS_FRAGMENT_SHADER_PATH = "resources\\frag_bindless.spv";
+static const char *VIRTUAL_FRAGMENT_SHADER_PATH = "resources\\frag_virtual.spv";
+static const char *FEEDBACK_FRAGMENT_SHADER_PATH = "resources\\frag_feedback.spv";
 
 typedef struct extension_functions {
     PFN_vkCreateDebugReportCallbackEXT f_vkCreateDebugReportCallbackEXT;
     PFN_vkDestroyDebugReportCallbackEXT f_vkDestroyDebugReportCallbackEXT;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR f_vkGetPhysicalDeviceMemoryProperties2KHR;
 } extension_functions;
 
 typedef struct swap_chain_details {
@@ -45,11 +119,109 @@ typedef struct swap_chain_details {
     uint32_t present_mode_count;
 } swap_chain_details;
 
-typedef struct vertex {
-    vec3 position;
-    vec2 texcoord;
-    vec3 color;
-} vertex;
+// what a resource needs its memory for, find_memory_type ranks the memory types for it
+typedef enum memory_usage {
+    MEMORY_USAGE_GPU_ONLY, // written by transfers or the gpu alone, device local without host access where there is a choice
+    MEMORY_USAGE_UPLOAD,   // written once by the cpu and copied from, host memory to keep device local heaps free
+    MEMORY_USAGE_READBACK, // written by the gpu and read by the cpu, host cached where possible
+    MEMORY_USAGE_DYNAMIC   // rewritten by the cpu every frame and read by the gpu in place, resizable bar memory where present
+} memory_usage;
+
+// a range of a memory block, or a dedicated allocation when block is MEMORY_POOL_NO_RANGE
+typedef struct device_memory {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint8_t *mapped; // at offset, NULL unless the memory type is host visible
+    uint32_t type;
+    uint32_t block;
+    uint32_t range;
+} device_memory;
+
+// one vkAllocateMemory shared out by a memory_pool, host visible blocks stay mapped for their lifetime,
+// optimal images get blocks apart from buffers where bufferImageGranularity could put both on one page
+typedef struct memory_block {
+    VkDeviceMemory memory;
+    uint8_t *mapped;
+    uint32_t type;
+    bool optimal;
+    memory_pool pool;
+} memory_block;
+
+// device memory of a memory type
+typedef struct memory_stats {
+    uint32_t block_count;
+    VkDeviceSize block_bytes;
+    VkDeviceSize used_bytes;
+    VkDeviceSize largest_free; // in any block
+    uint32_t allocation_count; // ranges in blocks
+    uint32_t dedicated_count;
+    VkDeviceSize dedicated_bytes;
+} memory_stats;
+
+// device memory of a heap, what the process uses and what it may use before the driver starts to page or fail
+typedef struct heap_budget {
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+} heap_budget;
+
+// transfers recorded into one command buffer and submitted once with a fence,
+// staging blocks live until the fence is waited on
+typedef struct upload_batch {
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    VkBuffer *staging_buffers;
+    device_memory *staging_memories;
+    uint32_t staging_count;
+    uint32_t staging_capacity;
+    // the last block, which takes uploads while they fit
+    uint8_t *staging_mapped;
+    VkDeviceSize staging_used;
+    VkDeviceSize staging_size;
+    uint32_t upload_count;
+    bool submitted;
+} upload_batch;
+
+// a texture whose finer levels arrive after the first frames, each residency change uploads a new image
+// with one level more or less, so dropped levels give their memory back
+typedef struct streamed_texture {
+    texture_load load; // keeps the cooked levels mapped for later changes
+    texture_residency residency;
+    bool streaming;    // false for a decoded texture and after a change failed
+    VkFormat format;
+    VkImage image;
+    device_memory memory;
+    VkImageView view;
+
+    // the image being uploaded, it replaces image once its batch is done
+    upload_batch batch;
+    uint32_t pending_level;
+    VkImage pending_image;
+    device_memory pending_memory;
+    VkImageView pending_view;
+
+    // the image replaced last, kept until the frames submitted before the change are done
+    VkImage retired_image;
+    device_memory retired_memory;
+    VkImageView retired_view;
+    uint64_t retired_frame;
+} streamed_texture;
+
+// a virtual texture on the gpu, the pages sit in a cache image and a page table image with a level for every paged level
+// finds them, both only change through batches submitted ahead of the frames sampling them
+typedef struct paged_texture {
+    virtual_texture pages;
+    VkImage cache_image;
+    device_memory cache_memory;
+    VkImageView cache_view;
+    VkImage table_image;
+    device_memory table_memory;
+    VkImageView table_view;
+    VkSampler table_sampler;
+    VkFormat format;
+    // pages of the last frame, no more are uploaded until it is done
+    upload_batch batch;
+} paged_texture;
 
 //const vertex vertices[8] = {
 //    {{-0.5f, -0.5f,  0.0f}, {1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}},
@@ -74,6 +246,28 @@ typedef struct uniform_buffer_object {
     mat4 proj;
 } uniform_buffer_object;
 
+// one persistently mapped buffer with the ubo of every swap chain image in a partition of its own, read through a
+// single dynamic uniform buffer descriptor, the recorded command buffers bind the partition of their image,
+// the fence of the image guards it
+typedef struct uniform_partitions {
+    VkBuffer buffer;
+    device_memory memory;
+    VkDeviceSize partition_size; // the ubo rounded up to minUniformBufferOffsetAlignment
+} uniform_partitions;
+
+// maps packed unorm positions back into the mesh bounds
+typedef struct mesh_push_constants {
+    vec4 position_offset;
+    vec4 position_scale;
+} mesh_push_constants;
+
+// read by the virtual and feedback fragment shaders, after mesh_push_constants
+typedef struct virtual_push_constants {
+    float size[4]; // level 0 and the cache in texels
+    float page[4]; // page size, page size with borders, border and paged levels
+    float lod[4];  // added to the level picked from the texcoord derivatives
+} virtual_push_constants;
+
 struct my_application {
     // glfw objects
     GLFWwindow *window;
@@ -88,6 +282,21 @@ struct my_application {
     int32_t present_family; // index of queue family which contain platfrom presentation flag
     VkQueue graphics_queue;
     VkQueue present_queue;
+    uint32_t max_draw_indirect_count; // 1 unless multiDrawIndirect is supported
+    bool texture_compression_bc;
+    bool bindless; // TEXTURE_BINDLESS and supported
+    uint32_t texture_table_size; // elements of the texture binding, 1 unless bindless
+    VkDeviceSize buffer_image_granularity;
+    VkDeviceSize min_uniform_buffer_offset_alignment;
+    VkPhysicalDeviceMemoryProperties memory_properties; // of physical_device, read once it is picked
+    memory_block **memory_blocks; // NULL where a block was given back
+    uint32_t memory_block_count;
+    uint32_t dedicated_counts[VK_MAX_MEMORY_TYPES];
+    VkDeviceSize dedicated_bytes[VK_MAX_MEMORY_TYPES];
+    bool physical_device_properties2; // VK_KHR_get_physical_device_properties2 enabled on the instance
+    bool memory_budget; // VK_EXT_memory_budget enabled, otherwise heap usage is estimated from the allocations made here
+    heap_budget heap_budgets[VK_MAX_MEMORY_HEAPS]; // as of the last query
+    bool memory_pressure; // the heap of the streamed texture is past MEMORY_BUDGET_HIGH_WATER
     VkSwapchainKHR swap_chain;
     VkImage *swap_chain_images;
     uint32_t swap_chain_image_count;
@@ -95,49 +304,98 @@ struct my_application {
     VkExtent2D swap_chain_extent;
     VkImageView *swap_chain_image_views;
     VkRenderPass render_pass;
-    VkDescriptorSetLayout descriptor_set_layout;
+    VkDescriptorSetLayout uniform_set_layout; // set 0, the ubo partitions
+    VkDescriptorSetLayout descriptor_set_layout; // set 1, the textures
     VkDescriptorPool descriptor_pool;
+    VkDescriptorSet uniform_set;
     VkDescriptorSet *descriptor_sets;
     VkPipelineLayout pipeline_layout;
     VkPipeline pipeline;
     VkFramebuffer *swap_chain_frame_buffers;
     VkCommandPool command_pool;
+    upload_batch upload;
     VkCommandBuffer *command_buffers;
+    uint32_t command_buffer_count;
     VkSemaphore *image_available_semaphores;
     VkSemaphore *render_finished_semaphores;
     VkFence *flight_fences;
+    VkFence *image_fences; // flight fence of the last frame drawn to each swap chain image
+    uint64_t frame_number; // frames submitted
 
     VkBuffer vertex_buffer;
-    VkDeviceMemory vertex_buffer_memory;
+    device_memory vertex_buffer_memory;
     VkBuffer index_buffer;
-    VkDeviceMemory index_buffer_memory;
-    VkBuffer *uniform_buffers;
-    VkDeviceMemory *uniform_buffer_memories;
+    device_memory index_buffer_memory;
+    VkIndexType index_type;
+    uniform_partitions uniforms;
+
+    // indirect draws of the model per swap chain image, rewritten each frame for the selected lod
+    VkBuffer *draw_buffers;
+    device_memory *draw_buffer_memories;
+    uint32_t draw_slot_count;
+    uint32_t model_lod;
+    uint32_t visible_meshlet_count;
     uint32_t mip_levels;
-    VkImage texture_image;
-    VkDeviceMemory texture_image_memory;
-    VkImageView texture_image_view;
+    streamed_texture texture;
+    size_t texture_stream_budget; // TEXTURE_STREAM_BUDGET, lowered while the heap of the texture is short of memory
     VkSampler texture_sampler;
+    // bumped whenever the texture image changes, a descriptor set behind it is written again before its next frame
+    uint64_t texture_generation;
+    uint64_t *descriptor_generations;
+    // element of the texture binding holding the model texture, the material index of every draw of the model
+    uint32_t texture_slot;
+    bool virtual_texturing; // TEXTURE_VIRTUAL with a cooked texture
+    paged_texture paged;
+
+    // the feedback pass draws the page every texel asks for, its target is copied into a buffer per swap chain image
+    VkExtent2D feedback_extent;
+    VkRenderPass feedback_render_pass;
+    VkPipeline feedback_pipeline;
+    VkImage feedback_image;
+    device_memory feedback_image_memory;
+    VkImageView feedback_image_view;
+    VkImage feedback_depth_image;
+    device_memory feedback_depth_image_memory;
+    VkImageView feedback_depth_image_view;
+    VkFramebuffer feedback_frame_buffer;
+    VkBuffer *feedback_buffers;
+    device_memory *feedback_buffer_memories;
 
     VkFormat depth_format;
     VkImage depth_image;
-    VkDeviceMemory depth_image_memory;
+    device_memory depth_image_memory;
     VkImageView depth_image_view;
 
     VkSampleCountFlagBits msaa_samplers;
     VkImage color_image;
-    VkDeviceMemory color_image_memory;
+    device_memory color_image_memory;
     VkImageView color_image_view;
 
     // model
-    vertex *vertices;
-    uint32_t vertex_count;
-    uint32_t *indices;
-    uint32_t index_count;
+    mesh model;
+    mesh_file model_file;
+
+    // draw benchmark, alternates frames between the cooked model and the plain import of its source
+    uint32_t benchmark_frames;
+    uint32_t frame_count;
+    mesh reference_model;
+    VkBuffer reference_vertex_buffer;
+    device_memory reference_vertex_buffer_memory;
+    VkBuffer reference_index_buffer;
+    device_memory reference_index_buffer_memory;
+    VkIndexType reference_index_type;
+    VkQueryPool timestamp_query_pool;
+    float timestamp_period;
+    double benchmark_gpu_time[2];
+    uint32_t benchmark_samples[2];
+    vk_allocator_stats benchmark_allocations; // when the measured frames started
 
     // function pointer
     extension_functions *ext_funcs;
 
+    // workers for asset import
+    thread_pool *workers;
+
     uint32_t current_frame;
     bool frame_buffer_resized;
 };
@@ -159,48 +417,86 @@ extern bool pick_physical_device(my_application *self);
 extern bool is_physical_device_suitable(my_application *self, VkPhysicalDevice physical_device);
 extern bool check_physical_device_extension_support(my_application *self, VkPhysicalDevice physical_device);
 extern bool find_queue_families(my_application *self, VkPhysicalDevice physical_device);
+extern bool is_instance_extension_supported(const char *name);
+extern bool is_device_extension_supported(VkPhysicalDevice physical_device, const char *name);
+extern bool check_descriptor_indexing_support(my_application *self, VkPhysicalDeviceDescriptorIndexingFeaturesEXT *features);
 extern bool create_logic_device(my_application *self);
 
 extern bool create_swap_chain(my_application *self);
 extern bool create_swap_chain_image_views(my_application *self);
 extern bool create_render_pass(my_application *self);
+extern bool create_feedback_render_pass(my_application *self);
 extern bool create_graphics_pipeline(my_application *self);
+extern bool create_pipeline_layout(my_application *self);
+extern bool create_scene_pipeline(my_application *self, VkRenderPass render_pass, VkExtent2D extent, VkSampleCountFlagBits samples, const char *frag_shader_path, VkPipeline *pipeline);
 extern bool create_frame_buffers(my_application *self);
 extern VkShaderModule create_shader_module(my_application *self, void *shader_code, uint32_t length);
 extern bool create_command_pool(my_application *self);
 extern bool create_command_buffers(my_application *self);
+extern bool record_command_buffer(my_application *self, uint32_t index);
+extern void record_model_draws(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant, float lod_bias);
+extern void record_feedback_commands(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant);
 extern bool create_sync_objects(my_application *self);
-extern int32_t find_memory_type(my_application *self, uint32_t type_filter, VkMemoryPropertyFlags flags);
+extern VkFormat get_vertex_format(uint32_t format);
+extern int32_t find_memory_type(my_application *self, uint32_t type_filter, memory_usage intent);
 extern bool create_vertex_buffer(my_application *self);
 extern bool create_index_buffer(my_application *self);
+extern bool create_reference_buffers(my_application *self);
 extern bool create_descriptor_set_layout(my_application *self);
-extern bool create_uniform_buffers(my_application *self);
+extern bool create_uniform_partitions(my_application *self);
+extern bool create_draw_buffers(my_application *self);
 extern bool create_descriptor_pool(my_application *self);
 extern bool create_descriptor_set(my_application *self);
 extern bool create_texture_image(my_application *self);
+extern bool create_decoded_texture_image(my_application *self);
+extern bool create_cooked_texture_image(my_application *self);
 extern bool create_texture_image_view(my_application *self);
 extern bool create_texture_sampler(my_application *self);
+extern bool begin_texture_change(my_application *self, streamed_texture *texture, uint32_t level);
+extern void update_memory_residency(my_application *self);
+extern void update_texture_streaming(my_application *self);
+extern void update_texture_descriptor(my_application *self, uint32_t image_index);
+extern void destroy_streamed_texture(my_application *self, streamed_texture *texture);
+extern bool create_paged_texture(my_application *self, paged_texture *texture, const texture_chain *chain, VkFormat format);
+extern bool upload_pages(my_application *self, paged_texture *texture, upload_batch *batch, uint32_t max_pages, bool first, uint32_t *page_count);
+extern void update_virtual_texture(my_application *self, uint32_t image_index);
+extern void destroy_paged_texture(my_application *self, paged_texture *texture);
+extern bool create_feedback_resources(my_application *self);
 extern bool create_depth_resources(my_application *self);
-extern bool load_model_source(my_application *self);
-extern bool load_model_binary(my_application *self);
+extern bool load_model_source(my_application *self, const mapped_file *source, const model_cook_settings *settings, uint64_t source_hash);
+extern bool load_model_binary(my_application *self, const mapped_file *source, uint64_t source_hash);
+extern bool load_model(my_application *self);
 extern bool create_color_resources(my_application *self);
 
 extern void cleanup_swap_chain(my_application *self);
 extern void recreate_swap_chain(my_application *self);
 
 extern void draw_frame(my_application *self);
-extern void update_uniform_buffer(my_application *self, uint32_t index);
+extern void compute_uniform_buffer_object(my_application *self, uniform_buffer_object *ubo);
+extern void update_uniform_buffer(my_application *self, uint32_t index, const uniform_buffer_object *ubo);
+extern void update_draw_buffer(my_application *self, uint32_t index, const uniform_buffer_object *ubo);
 
 // utilities
-extern bool read_file(const char *file_name, void **content, uint32_t *length);
-extern bool create_buffer(my_application *self, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags property, VkBuffer *buffer, VkDeviceMemory *buffer_mempry);
-extern VkCommandBuffer begin_single_time_commands(my_application *self);
-extern void end_single_time_commands(my_application *self, VkCommandBuffer command_buffer);
-extern bool copy_buffer(my_application *self, VkBuffer src, VkBuffer dst, VkDeviceSize size);
-extern bool create_image_2d(my_application *self, uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits samplers, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage *image, VkDeviceMemory *image_memory);
-extern void transition_image_layout(my_application *self, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels);
-extern bool generate_mipmaps(my_application *self, VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels);
-extern void copy_buffer_to_image(my_application *self, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+extern bool allocate_device_memory(my_application *self, const VkMemoryRequirements *requirements, memory_usage intent, bool optimal, bool dedicated, device_memory *memory);
+extern void free_device_memory(my_application *self, device_memory *memory);
+extern void destroy_memory_blocks(my_application *self);
+extern void get_memory_stats(my_application *self, memory_stats *stats);
+extern void get_memory_budget(my_application *self, heap_budget *budgets);
+extern void log_memory_stats(my_application *self);
+extern bool create_buffer(my_application *self, VkDeviceSize size, VkBufferUsageFlags usage, memory_usage intent, VkBuffer *buffer, device_memory *buffer_mempry);
+extern bool begin_upload_batch(my_application *self, upload_batch *batch);
+extern void * stage_upload(my_application *self, upload_batch *batch, VkDeviceSize size, VkBuffer *buffer, VkDeviceSize *offset);
+extern bool submit_upload_batch(my_application *self, upload_batch *batch);
+extern bool finish_upload_batch(my_application *self, upload_batch *batch);
+extern void copy_buffer(VkCommandBuffer command_buffer, VkBuffer src, VkDeviceSize src_offset, VkBuffer dst, VkDeviceSize size);
+extern bool create_device_local_buffer(my_application *self, const void *data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, device_memory *buffer_memory);
+extern void record_draw_commands(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant);
+extern void collect_benchmark_sample(my_application *self, uint32_t command_index, uint32_t variant);
+extern bool create_image_2d(my_application *self, uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits samplers, VkFormat format, VkImageUsageFlags usage, memory_usage intent, bool dedicated, VkImage *image, device_memory *image_memory);
+extern void transition_image_layout(VkCommandBuffer command_buffer, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels);
+extern bool generate_mipmaps(my_application *self, VkCommandBuffer command_buffer, VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels);
+extern void copy_buffer_to_image(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize buffer_offset, VkImage image, const texture_mip *mips, uint32_t mip_count);
+extern bool upload_texture_levels(my_application *self, upload_batch *batch, const texture_chain *chain, uint32_t first_level, VkFormat format, VkImage *image, device_memory *image_memory);
 extern VkImageView create_image_view_2d(my_application *self, VkImage image, VkFormat format, VkImageAspectFlags aspect_flags, uint32_t mip_levels);
 extern VkFormat find_supported_format(my_application *self, VkFormat *formats, uint32_t count, VkImageTiling tiling, VkFormatFeatureFlags features);
 extern bool has_stencil_component(VkFormat format);
@@ -218,6 +514,11 @@ void my_application_delete(my_application *self) {
     destructor(self);
 }
 
+void my_application_run_draw_benchmark(my_application *self, uint32_t frame_count) {
+    self->benchmark_frames = BENCHMARK_WARMUP_FRAMES + frame_count;
+    my_application_run(self);
+}
+
 void my_application_run(my_application *self) {
     init_window(self);
     if (init_vulkan(self)) {
@@ -226,6 +527,17 @@ void my_application_run(my_application *self) {
     cleanup(self);
 }
 
+uint32_t my_application_get_heap_usage(const my_application *self, my_application_heap_usage *heaps, uint32_t capacity) {
+    const VkPhysicalDeviceMemoryProperties *mem_props = &(self->memory_properties);
+    for (uint32_t i = 0; i < mem_props->memoryHeapCount && i < capacity; ++i) {
+        heaps[i].size = mem_props->memoryHeaps[i].size;
+        heaps[i].usage = self->heap_budgets[i].usage;
+        heaps[i].budget = self->heap_budgets[i].budget;
+        heaps[i].device_local = (mem_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+    }
+    return mem_props->memoryHeapCount;
+}
+
 // private 
 
 static my_application * constructor(my_application *self) {
@@ -235,11 +547,14 @@ static my_application * constructor(my_application *self) {
         self->present_family = -1;
         self->frame_buffer_resized = false;
         self->msaa_samplers = VK_SAMPLE_COUNT_1_BIT;
+        self->texture_stream_budget = TEXTURE_STREAM_BUDGET;
+        self->workers = thread_pool_new(0);
     }
     return self;
 }
 
 static void destructor(my_application *self) {
+    thread_pool_delete(self->workers);
     free(self);
 }
 
@@ -277,20 +592,35 @@ static bool init_vulkan(my_application *self) {
         if (!create_descriptor_set_layout(self)) { break; }
         if (!create_graphics_pipeline(self)) { break; }
         if (!create_command_pool(self)) { break; }
+        // every startup transfer is recorded into one command buffer and submitted after the last of them
+        if (!begin_upload_batch(self, &(self->upload))) { break; }
         if (!create_color_resources(self)) { break; }
         if (!create_depth_resources(self)) { break; }
         if (!create_frame_buffers(self)) { break; }
+        if (self->virtual_texturing && !create_feedback_resources(self)) { break; }
         if (!create_texture_image(self)) { break; }
         if (!create_texture_image_view(self)) { break; }
         if (!create_texture_sampler(self)) { break; }
-        if (!load_model_binary(self)) { break; }
+        if (!load_model(self)) { break; }
         if (!create_vertex_buffer(self)) { break; }
         if (!create_index_buffer(self)) { break; }
-        if (!create_uniform_buffers(self)) { break; }
+        mesh_release_data(&(self->model));
+        mesh_file_close(&(self->model_file));
+        if (self->benchmark_frames && !create_reference_buffers(self)) { break; }
+        if (!submit_upload_batch(self, &(self->upload))) { break; }
+        if (!create_uniform_partitions(self)) { break; }
+        if (!create_draw_buffers(self)) { break; }
         if (!create_descriptor_pool(self)) { break; }
         if (!create_descriptor_set(self)) { break; }
         if (!create_command_buffers(self)) { break; }
         if (!create_sync_objects(self)) { break; }
+        // the transfers ran alongside the setup above, the first frame needs them done
+        uint32_t upload_count = self->upload.upload_count;
+        uint32_t staging_count = self->upload.staging_count;
+        float upload_start = high_resolution_clock_now();
+        if (!finish_upload_batch(self, &(self->upload))) { break; }
+        LOG("Waited %f seconds for %d startup uploads in %d staging blocks\n", high_resolution_clock_now() - upload_start, upload_count, staging_count);
+        log_memory_stats(self);
 
         ret = true;
 
@@ -300,15 +630,29 @@ static bool init_vulkan(my_application *self) {
 }
 
 static void main_loop(my_application *self) {
+    // driver heap churn of the frame loop, a steady frame should allocate nothing outside the command scope
+    vk_allocator_stats before;
+    vk_allocator_snapshot(&before);
+    uint64_t first_frame = self->frame_number;
+
     while (!glfwWindowShouldClose(self->window)) {
         glfwPollEvents();
         draw_frame(self);
     }
 
     vkDeviceWaitIdle(self->device);
+
+    vk_allocator_stats now, churn;
+    vk_allocator_snapshot(&now);
+    vk_allocator_difference(&now, &before, &churn);
+    LOG("Driver host allocations over %d frames\n", (uint32_t)(self->frame_number - first_frame));
+    vk_allocator_log("Frame loop", &churn);
 }
 
 static void cleanup(my_application *self) {
+    // left over when init stopped half way
+    finish_upload_batch(self, &(self->upload));
+
     cleanup_swap_chain(self);
 
     if (self->descriptor_pool) {
@@ -319,59 +663,67 @@ static void cleanup(my_application *self) {
         free(self->descriptor_sets);
     }
 
+    if (self->descriptor_generations) {
+        free(self->descriptor_generations);
+    }
+
     if (self->descriptor_set_layout) {
         vkDestroyDescriptorSetLayout(self->device, self->descriptor_set_layout, MY_VK_ALLOCATOR);
     }
 
-    if (self->vertices) {
-        free(self->vertices);
+    if (self->uniform_set_layout) {
+        vkDestroyDescriptorSetLayout(self->device, self->uniform_set_layout, MY_VK_ALLOCATOR);
     }
 
-    if (self->indices) {
-        free(self->indices);
+    mesh_free(&(self->model));
+    mesh_file_close(&(self->model_file));
+    mesh_free(&(self->reference_model));
+
+    if (self->uniforms.buffer) {
+        vkDestroyBuffer(self->device, self->uniforms.buffer, MY_VK_ALLOCATOR);
     }
+    free_device_memory(self, &(self->uniforms.memory));
 
-    if (self->uniform_buffers && self->uniform_buffer_memories) {
+    if (self->draw_buffers && self->draw_buffer_memories) {
         for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
-            vkDestroyBuffer(self->device, self->uniform_buffers[i], MY_VK_ALLOCATOR);
-            vkFreeMemory(self->device, self->uniform_buffer_memories[i], MY_VK_ALLOCATOR);
+            vkDestroyBuffer(self->device, self->draw_buffers[i], MY_VK_ALLOCATOR);
+            free_device_memory(self, self->draw_buffer_memories + i);
         }
-        free(self->uniform_buffers);
-        free(self->uniform_buffer_memories);
     }
+    free(self->draw_buffers);
+    free(self->draw_buffer_memories);
 
     if (self->index_buffer) {
         vkDestroyBuffer(self->device, self->index_buffer, MY_VK_ALLOCATOR);
     }
 
-    if (self->index_buffer_memory) {
-        vkFreeMemory(self->device, self->index_buffer_memory, MY_VK_ALLOCATOR);
-    }
+    free_device_memory(self, &(self->index_buffer_memory));
 
     if (self->vertex_buffer) {
         vkDestroyBuffer(self->device, self->vertex_buffer, MY_VK_ALLOCATOR);
     }
 
-    if (self->vertex_buffer_memory) {
-        vkFreeMemory(self->device, self->vertex_buffer_memory, MY_VK_ALLOCATOR);
-    }
+    free_device_memory(self, &(self->vertex_buffer_memory));
 
-    if (self->texture_sampler) {
-        vkDestroySampler(self->device, self->texture_sampler, MY_VK_ALLOCATOR);
+    if (self->reference_index_buffer) {
+        vkDestroyBuffer(self->device, self->reference_index_buffer, MY_VK_ALLOCATOR);
     }
 
-    if (self->texture_image_view) {
-        vkDestroyImageView(self->device, self->texture_image_view, MY_VK_ALLOCATOR);
-    }
+    free_device_memory(self, &(self->reference_index_buffer_memory));
 
-    if (self->texture_image) {
-        vkDestroyImage(self->device, self->texture_image, MY_VK_ALLOCATOR);
+    if (self->reference_vertex_buffer) {
+        vkDestroyBuffer(self->device, self->reference_vertex_buffer, MY_VK_ALLOCATOR);
     }
 
-    if (self->texture_image_memory) {
-        vkFreeMemory(self->device, self->texture_image_memory, MY_VK_ALLOCATOR);
+    free_device_memory(self, &(self->reference_vertex_buffer_memory));
+
+    if (self->texture_sampler) {
+        vkDestroySampler(self->device, self->texture_sampler, MY_VK_ALLOCATOR);
     }
 
+    destroy_paged_texture(self, &(self->paged));
+    destroy_streamed_texture(self, &(self->texture));
+
     if (self->image_available_semaphores) {
         for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             vkDestroySemaphore(self->device, self->image_available_semaphores[i], MY_VK_ALLOCATOR);
@@ -403,6 +755,8 @@ static void cleanup(my_application *self) {
     }
 #endif
 
+    destroy_memory_blocks(self);
+
     if (self->device) {
         vkDestroyDevice(self->device, MY_VK_ALLOCATOR);
     }
@@ -417,6 +771,12 @@ static void cleanup(my_application *self) {
         vkDestroyInstance(self->instance, MY_VK_ALLOCATOR);
     }
 
+    // anything still live here was never destroyed
+    vk_allocator_stats leaks;
+    vk_allocator_snapshot(&leaks);
+    vk_allocator_log("Driver host allocations left", &leaks);
+    vk_allocator_shutdown();
+
     if (self->window) {
         glfwDestroyWindow(self->window);
     }
@@ -449,6 +809,8 @@ static void load_extension_functions(my_application *self) {
 
     ext_funcs->f_vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
     ext_funcs->f_vkDestroyDebugReportCallbackEXT = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
+    ext_funcs->f_vkGetPhysicalDeviceMemoryProperties2KHR = self->physical_device_properties2
+        ? (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR") : NULL;
 
     self->ext_funcs = ext_funcs;
 }
@@ -503,20 +865,26 @@ static bool create_instance(my_application *self) {
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "No Engine",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0
+        // the descriptor indexing features are queried with vkGetPhysicalDeviceFeatures2
+        .apiVersion = TEXTURE_BINDLESS ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0
     };
 
     uint32_t glfw_ext_count = 0;
     const char **glfw_exts = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
 
     uint32_t ext_name_count = glfw_ext_count;
-    const char **ext_names = glfw_exts;
+    const char **ext_names = malloc((glfw_ext_count + 2) * sizeof(const char *));
+    if (glfw_ext_count) {
+        memcpy((void *)ext_names, glfw_exts, glfw_ext_count * sizeof(const char *));
+    }
 #ifdef ENABLE_VALIDATION_LAYERS
-    ++ ext_name_count;
-    ext_names = malloc(ext_name_count * sizeof(const char *));
-    memcpy((void *)ext_names, glfw_exts, glfw_ext_count * sizeof(const char *));
-    ext_names[ext_name_count - 1] = VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
+    ext_names[ext_name_count ++] = VK_EXT_DEBUG_REPORT_EXTENSION_NAME;
 #endif
+    // heap budgets are read with vkGetPhysicalDeviceMemoryProperties2KHR, left out where the loader lacks it
+    self->physical_device_properties2 = is_instance_extension_supported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (self->physical_device_properties2) {
+        ext_names[ext_name_count ++] = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+    }
 
     ret = check_instance_extension_support(self, ext_names, ext_name_count);
 
@@ -558,9 +926,9 @@ static bool create_instance(my_application *self) {
 
     result = glfwCreateWindowSurface(self->instance, self->window, MY_VK_ALLOCATOR, &self->surface);
     ret = (ret ? result == VK_SUCCESS : ret);
+    free((void *)ext_names);
 
 #ifdef ENABLE_VALIDATION_LAYERS
-    free((void *)ext_names);
 
     // create debug callback
     VkDebugReportCallbackCreateInfoEXT debug_create_info = {
@@ -643,6 +1011,13 @@ static bool pick_physical_device(my_application *self) {
         if (is_physical_device_suitable(self, devices[i])) {
             self->physical_device = devices[i];
             self->msaa_samplers = get_max_usable_sample_count(self);
+            vkGetPhysicalDeviceMemoryProperties(self->physical_device, &(self->memory_properties));
+            int32_t dynamic_type = find_memory_type(self, UINT32_MAX, MEMORY_USAGE_DYNAMIC);
+            if (dynamic_type >= 0) {
+                const VkMemoryType *type = self->memory_properties.memoryTypes + dynamic_type;
+                LOG("Per frame data goes to memory type %d with flags 0x%x in a heap of %llu bytes\n", dynamic_type, type->propertyFlags,
+                    (unsigned long long)self->memory_properties.memoryHeaps[type->heapIndex].size);
+            }
             break;
         }
     }
@@ -726,6 +1101,96 @@ static bool check_physical_device_extension_support(my_application *self, VkPhys
     return ret;
 }
 
+static bool is_instance_extension_supported(const char *name) {
+    uint32_t ext_count = 0;
+    vkEnumerateInstanceExtensionProperties(NULL, &ext_count, NULL);
+    VkExtensionProperties *exts = malloc(ext_count * sizeof(VkExtensionProperties));
+    vkEnumerateInstanceExtensionProperties(NULL, &ext_count, exts);
+
+    bool is_found = false;
+    for (uint32_t i = 0; i < ext_count && !is_found; ++i) {
+        is_found = !strcmp(name, exts[i].extensionName);
+    }
+
+    free(exts);
+    return is_found;
+}
+
+static bool is_device_extension_supported(VkPhysicalDevice physical_device, const char *name) {
+    uint32_t ext_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &ext_count, NULL);
+    VkExtensionProperties *exts = malloc(ext_count * sizeof(VkExtensionProperties));
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &ext_count, exts);
+
+    bool is_found = false;
+    for (uint32_t i = 0; i < ext_count && !is_found; ++i) {
+        is_found = !strcmp(name, exts[i].extensionName);
+    }
+
+    free(exts);
+    return is_found;
+}
+
+// whether the bindless texture table can be used, if so features holds just the ones it needs to enable
+// and texture_table_size is set within the update after bind limits
+static bool check_descriptor_indexing_support(my_application *self, VkPhysicalDeviceDescriptorIndexingFeaturesEXT *features) {
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(self->physical_device, &device_properties);
+    if (device_properties.apiVersion < VK_API_VERSION_1_1 || !is_device_extension_supported(self->physical_device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        LOG("Descriptor indexing is not supported!\n");
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+        .pNext = NULL
+    };
+    VkPhysicalDeviceFeatures2 features2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &supported
+    };
+    vkGetPhysicalDeviceFeatures2(self->physical_device, &features2);
+
+    // the material index is passed as the first instance of indirect draws
+    if (!features2.features.drawIndirectFirstInstance
+        || !supported.shaderSampledImageArrayNonUniformIndexing
+        || !supported.descriptorBindingSampledImageUpdateAfterBind
+        || !supported.descriptorBindingPartiallyBound
+        || !supported.runtimeDescriptorArray) {
+        LOG("Descriptor indexing features are missing!\n");
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT limits = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT,
+        .pNext = NULL
+    };
+    VkPhysicalDeviceProperties2 properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &limits
+    };
+    vkGetPhysicalDeviceProperties2(self->physical_device, &properties2);
+
+    // a combined image sampler counts as a sampler and a sampled image, the uniform buffer takes one more resource
+    self->texture_table_size = MIN(TEXTURE_TABLE_SIZE, limits.maxDescriptorSetUpdateAfterBindSampledImages);
+    self->texture_table_size = MIN(self->texture_table_size, limits.maxDescriptorSetUpdateAfterBindSamplers);
+    self->texture_table_size = MIN(self->texture_table_size, limits.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    self->texture_table_size = MIN(self->texture_table_size, limits.maxPerStageDescriptorUpdateAfterBindSamplers);
+    self->texture_table_size = MIN(self->texture_table_size, limits.maxPerStageUpdateAfterBindResources - 1);
+    if (self->texture_table_size <= self->texture_slot) {
+        LOG("Descriptor indexing limits are too low!\n");
+        return false;
+    }
+
+    memset(features, 0, sizeof(VkPhysicalDeviceDescriptorIndexingFeaturesEXT));
+    features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    features->shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features->descriptorBindingPartiallyBound = VK_TRUE;
+    features->runtimeDescriptorArray = VK_TRUE;
+    return true;
+}
+
 static bool find_queue_families(my_application *self, VkPhysicalDevice physical_device) {
     uint32_t queue_family_count = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &queue_family_count, NULL);
@@ -780,13 +1245,46 @@ static bool create_logic_device(my_application *self) {
         }
     };
 
+    VkPhysicalDeviceFeatures supported_features;
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceFeatures(self->physical_device, &supported_features);
+    vkGetPhysicalDeviceProperties(self->physical_device, &device_properties);
+
     VkPhysicalDeviceFeatures device_features = {VK_FALSE};
     device_features.samplerAnisotropy = VK_TRUE;
+    // culled meshlets leave many small draws, one indirect call issues them all where supported
+    device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+    self->max_draw_indirect_count = supported_features.multiDrawIndirect ? device_properties.limits.maxDrawIndirectCount : 1;
+    self->buffer_image_granularity = device_properties.limits.bufferImageGranularity;
+    self->min_uniform_buffer_offset_alignment = MAX(device_properties.limits.minUniformBufferOffsetAlignment, 1);
+    device_features.textureCompressionBC = supported_features.textureCompressionBC;
+    self->texture_compression_bc = supported_features.textureCompressionBC == VK_TRUE;
     //device_features.sampleRateShading = VK_TRUE;
 
+    const char *extension_names[3] = {NULL};
+    memcpy(extension_names, device_extension_names, device_extension_count * sizeof(const char *));
+    uint32_t extension_count = device_extension_count;
+    self->memory_budget = self->ext_funcs->f_vkGetPhysicalDeviceMemoryProperties2KHR
+        && is_device_extension_supported(self->physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (self->memory_budget) {
+        extension_names[extension_count ++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    } else {
+        LOG("Memory budget is not supported, heap usage is estimated!\n");
+    }
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexing_features;
+    // the virtual texture binds its page cache where the table would be
+    self->virtual_texturing = TEXTURE_VIRTUAL && TEXTURE_COOKED;
+    self->bindless = TEXTURE_BINDLESS && !self->virtual_texturing && check_descriptor_indexing_support(self, &indexing_features);
+    if (self->bindless) {
+        device_features.drawIndirectFirstInstance = VK_TRUE;
+        extension_names[extension_count ++] = VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME;
+    } else {
+        self->texture_table_size = 1;
+    }
+
     VkDeviceCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext = NULL,
+        .pNext = self->bindless ? &indexing_features : NULL,
 //        VkDeviceCreateFlags flags,
         .queueCreateInfoCount = (self->graphics_family == self->present_family ? 1 : 2),
         .pQueueCreateInfos = queue_create_info,
@@ -797,8 +1295,8 @@ static bool create_logic_device(my_application *self) {
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = NULL,
 #endif
-        .enabledExtensionCount = device_extension_count,
-        .ppEnabledExtensionNames = device_extension_names,
+        .enabledExtensionCount = extension_count,
+        .ppEnabledExtensionNames = extension_names,
         .pEnabledFeatures = &device_features
     };
 
@@ -1088,10 +1586,150 @@ static bool create_render_pass(my_application *self) {
         return false;
     }
 
+    if (self->virtual_texturing) {
+        return create_feedback_render_pass(self);
+    }
+    return true;
+}
+
+// one uint target of page ids and depth, the target is left for the copy into the feedback buffer of the image
+static bool create_feedback_render_pass(my_application *self) {
+    self->feedback_extent.width = MAX(self->swap_chain_extent.width / VIRTUAL_FEEDBACK_SCALE, 1);
+    self->feedback_extent.height = MAX(self->swap_chain_extent.height / VIRTUAL_FEEDBACK_SCALE, 1);
+
+    VkAttachmentDescription attachments[2] = {
+        {
+            .format = VK_FORMAT_R32_UINT,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        }, {
+            .format = find_depth_format(self),
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        }
+    };
+
+    VkAttachmentReference color_attachment_ref = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+    VkAttachmentReference depth_attachment_ref = {
+        .attachment = 1,
+        .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+    };
+    VkSubpassDescription subpass_desc = {
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment_ref,
+        .pResolveAttachments = NULL,
+        .pDepthStencilAttachment = &depth_attachment_ref
+    };
+
+    // the target and depth are shared by the frames in flight, the copy out of the last frame has to be done
+    // before this one clears them, and the pass before the copy after it
+    VkSubpassDependency subpass_dependencies[2] = {
+        {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+        }, {
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+        }
+    };
+
+    VkRenderPassCreateInfo render_pass_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = NULL,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
+        .subpassCount = 1,
+        .pSubpasses = &subpass_desc,
+        .dependencyCount = 2,
+        .pDependencies = subpass_dependencies
+    };
+
+    if (VK_SUCCESS != vkCreateRenderPass(self->device, &render_pass_info, MY_VK_ALLOCATOR, &(self->feedback_render_pass))) {
+        LOG("Feedback render pass create failed!\n");
+        return false;
+    }
+
     return true;
 }
 
 static bool create_graphics_pipeline(my_application *self) {
+    const char *frag_shader_path = FRAGMENT_SHADER_PATH;
+    if (self->bindless) {
+        frag_shader_path = BINDLESS_FRAGMENT_SHADER_PATH;
+    } else if (self->virtual_texturing) {
+        frag_shader_path = VIRTUAL_FRAGMENT_SHADER_PATH;
+    }
+
+    if (!create_pipeline_layout(self)
+        || !create_scene_pipeline(self, self->render_pass, self->swap_chain_extent, self->msaa_samplers, frag_shader_path, &(self->pipeline))) {
+        return false;
+    }
+
+    // same draws at a fraction of the size, writing the page each texel wants instead of its color
+    if (self->virtual_texturing) {
+        return create_scene_pipeline(self, self->feedback_render_pass, self->feedback_extent, VK_SAMPLE_COUNT_1_BIT, FEEDBACK_FRAGMENT_SHADER_PATH, &(self->feedback_pipeline));
+    }
+    return true;
+}
+
+static bool create_pipeline_layout(my_application *self) {
+    VkDescriptorSetLayout set_layouts[] = {self->uniform_set_layout, self->descriptor_set_layout};
+    VkPushConstantRange push_constant_ranges[2];
+    uint32_t push_constant_range_count = 0;
+    if (MODEL_PACKED_VERTICES) {
+        push_constant_ranges[push_constant_range_count ++] = (VkPushConstantRange){
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(mesh_push_constants)
+        };
+    }
+    if (self->virtual_texturing) {
+        push_constant_ranges[push_constant_range_count ++] = (VkPushConstantRange){
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .offset = sizeof(mesh_push_constants),
+            .size = sizeof(virtual_push_constants)
+        };
+    }
+    VkPipelineLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        //VkPipelineLayoutCreateFlags     flags;
+        .setLayoutCount = 2,
+        .pSetLayouts = set_layouts,
+        .pushConstantRangeCount = push_constant_range_count,
+        .pPushConstantRanges = push_constant_range_count ? push_constant_ranges : NULL
+    };
+    if (VK_SUCCESS != vkCreatePipelineLayout(self->device, &layout_info, MY_VK_ALLOCATOR, &(self->pipeline_layout))) {
+        LOG("Pipeline layout create failed!\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool create_scene_pipeline(my_application *self, VkRenderPass render_pass, VkExtent2D extent, VkSampleCountFlagBits samples, const char *frag_shader_path, VkPipeline *pipeline) {
     bool ret = true;
 
     // shader
@@ -1103,10 +1741,14 @@ static bool create_graphics_pipeline(my_application *self) {
     uint32_t frag_shader_length;
     VkShaderModule frag_shader_module;
 
-    read_file(VERTEX_SHADER_PATH, &vert_shader_code, &vert_shader_length);
+    const char *vert_shader_path = MODEL_PACKED_VERTICES ? PACKED_VERTEX_SHADER_PATH : VERTEX_SHADER_PATH;
+    if (self->bindless) {
+        vert_shader_path = MODEL_PACKED_VERTICES ? PACKED_BINDLESS_VERTEX_SHADER_PATH : BINDLESS_VERTEX_SHADER_PATH;
+    }
+    read_file(vert_shader_path, &vert_shader_code, &vert_shader_length);
     vert_shader_module = create_shader_module(self, vert_shader_code, vert_shader_length);
 
-    read_file(FRAGMENT_SHADER_PATH, &frag_shader_code, &frag_shader_length);
+    read_file(frag_shader_path, &frag_shader_code, &frag_shader_length);
     frag_shader_module = create_shader_module(self, frag_shader_code, frag_shader_length);
 
     if (!vert_shader_module || !frag_shader_module) {
@@ -1135,36 +1777,28 @@ static bool create_graphics_pipeline(my_application *self) {
     };
 
     // vertex input
+    const vertex_layout *layout = MODEL_PACKED_VERTICES ? &mesh_packed_vertex_layout : &mesh_vertex_layout;
     VkVertexInputBindingDescription vertex_binding_desc = {
         .binding = 0,
-        .stride = sizeof(vertex),
+        .stride = layout->stride,
         .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
     };
-    VkVertexInputAttributeDescription vertex_attr_descs[3] = {
-        {
-            .location = 0,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(vertex, position)
-        }, {
-            .location = 1,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32_SFLOAT,
-            .offset = offsetof(vertex, texcoord)
-        }, {
-            .location = 2,
+    VkVertexInputAttributeDescription vertex_attr_descs[MESH_MAX_VERTEX_ATTRIBUTES];
+    for (uint32_t i = 0; i < layout->attribute_count; ++i) {
+        vertex_attr_descs[i] = (VkVertexInputAttributeDescription){
+            .location = layout->attributes[i].location,
             .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(vertex, color)
-        }
-    };
+            .format = get_vertex_format(layout->attributes[i].format),
+            .offset = layout->attributes[i].offset
+        };
+    }
     VkPipelineVertexInputStateCreateInfo vertex_input_state_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .pNext = NULL,
         //VkPipelineVertexInputStateCreateFlags       flags;
         .vertexBindingDescriptionCount = 1,
         .pVertexBindingDescriptions = &vertex_binding_desc,
-        .vertexAttributeDescriptionCount = 3,
+        .vertexAttributeDescriptionCount = layout->attribute_count,
         .pVertexAttributeDescriptions = vertex_attr_descs
     };
 
@@ -1181,14 +1815,14 @@ static bool create_graphics_pipeline(my_application *self) {
     VkViewport viewport = {
         .x = 0.0f,
         .y = 0.0f,
-        .width = (float)self->swap_chain_extent.width,
-        .height = (float)self->swap_chain_extent.height,
+        .width = (float)extent.width,
+        .height = (float)extent.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f
     };
     VkRect2D scissor = {
         .offset = {0, 0},
-        .extent = self->swap_chain_extent
+        .extent = extent
     };
     VkPipelineViewportStateCreateInfo viewport_state_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -1222,7 +1856,7 @@ static bool create_graphics_pipeline(my_application *self) {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
         .pNext = NULL,
         //VkPipelineMultisampleStateCreateFlags    flags;
-        .rasterizationSamples = self->msaa_samplers,
+        .rasterizationSamples = samples,
         .sampleShadingEnable = VK_FALSE,
         .minSampleShading = 1.0f,
         .pSampleMask = NULL,
@@ -1273,22 +1907,6 @@ static bool create_graphics_pipeline(my_application *self) {
 
     // dynamic state
 
-    // pipeline layout
-    VkDescriptorSetLayout set_layouts[] = {self->descriptor_set_layout};
-    VkPipelineLayoutCreateInfo layout_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .pNext = NULL,
-        //VkPipelineLayoutCreateFlags     flags;
-        .setLayoutCount = 1,
-        .pSetLayouts = set_layouts,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = NULL
-    };
-    if (VK_SUCCESS != vkCreatePipelineLayout(self->device, &layout_info, MY_VK_ALLOCATOR, &(self->pipeline_layout))) {
-        LOG("Pipeline layout create failed!\n");
-        ret = false;
-    }
-
     // graphics pipeline
     VkGraphicsPipelineCreateInfo graphics_pipeline_info = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
@@ -1306,12 +1924,12 @@ static bool create_graphics_pipeline(my_application *self) {
         .pColorBlendState = &color_blend_state_info,
         //const VkPipelineDynamicStateCreateInfo*          pDynamicState;
         .layout = self->pipeline_layout,
-        .renderPass = self->render_pass,
+        .renderPass = render_pass,
         .subpass = 0,
         .basePipelineHandle = VK_NULL_HANDLE,
         .basePipelineIndex = -1
     };
-    if (VK_SUCCESS != vkCreateGraphicsPipelines(self->device, VK_NULL_HANDLE, 1, &graphics_pipeline_info, MY_VK_ALLOCATOR, &(self->pipeline))) {
+    if (VK_SUCCESS != vkCreateGraphicsPipelines(self->device, VK_NULL_HANDLE, 1, &graphics_pipeline_info, MY_VK_ALLOCATOR, pipeline)) {
         LOG("Pipeline create failed!\n");
         ret = false;
     }
@@ -1369,7 +1987,8 @@ static bool create_command_pool(my_application *self) {
     VkCommandPoolCreateInfo command_pool_info = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .pNext = NULL,
-        //VkCommandPoolCreateFlags    flags;
+        // streamed textures record the command buffers of a swap chain image again
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
         .queueFamilyIndex = self->graphics_family
     };
 
@@ -1381,80 +2000,236 @@ static bool create_command_pool(my_application *self) {
     return true;
 }
 
+static void record_draw_commands(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant) {
+    if (self->virtual_texturing) {
+        record_feedback_commands(self, command_buffer, image_index, variant);
+    }
+
+    // begin render pass
+    VkClearValue clear_value[2] = {
+        {
+            .color = {0.0f, 0.0f, 0.0f, 1.0f}
+            //VkClearDepthStencilValue    depthStencil;
+        }, {
+            //VkClearColorValue           color;
+            .depthStencil = {1.0f, 0}
+        }
+    };
+    VkRenderPassBeginInfo render_pass_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = NULL,
+        .renderPass = self->render_pass,
+        .framebuffer = self->swap_chain_frame_buffers[image_index],
+        .renderArea = {
+            .offset = {.x = 0, .y = 0},
+            .extent = self->swap_chain_extent
+        },
+        .clearValueCount = 2,
+        .pClearValues = clear_value
+    };
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    // draw commands
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, self->pipeline);
+    record_model_draws(self, command_buffer, image_index, variant, 0.0f);
+
+    // end render pass
+    vkCmdEndRenderPass(command_buffer);
+}
+
+// the model with the bound pipeline, lod_bias goes to the virtual texture shaders
+static void record_model_draws(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant, float lod_bias) {
+    const mesh *model = variant ? &(self->reference_model) : &(self->model);
+    VkBuffer vertex_buffers[] = {variant ? self->reference_vertex_buffer : self->vertex_buffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+    if (variant) {
+        vkCmdBindIndexBuffer(command_buffer, self->reference_index_buffer, 0, self->reference_index_type);
+    } else {
+        vkCmdBindIndexBuffer(command_buffer, self->index_buffer, 0, self->index_type);
+    }
+    // the ubo of the image, see update_uniform_buffer
+    VkDescriptorSet descriptor_sets[] = {self->uniform_set, self->descriptor_sets[image_index]};
+    uint32_t dynamic_offsets[] = {(uint32_t)(image_index * self->uniforms.partition_size)};
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, self->pipeline_layout, 0, 2, descriptor_sets, 1, dynamic_offsets);
+
+    if (MODEL_PACKED_VERTICES) {
+        mesh_push_constants constants;
+        for (uint32_t i = 0; i < 3; ++i) {
+            constants.position_offset[i] = model->bounds.min[i];
+            constants.position_scale[i] = model->bounds.max[i] - model->bounds.min[i];
+        }
+        constants.position_offset[3] = 0.0f;
+        constants.position_scale[3] = 0.0f;
+        vkCmdPushConstants(command_buffer, self->pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mesh_push_constants), &constants);
+    }
+
+    if (self->virtual_texturing) {
+        const virtual_texture *pages = &(self->paged.pages);
+        virtual_push_constants constants = {
+            .size = {
+                (float)pages->chain->mips[0].width,
+                (float)pages->chain->mips[0].height,
+                (float)virtual_texture_cache_width(pages),
+                (float)virtual_texture_cache_height(pages)
+            },
+            .page = {
+                (float)pages->settings.page_size,
+                (float)(pages->settings.page_size + 2 * pages->settings.border),
+                (float)pages->settings.border,
+                (float)pages->level_count
+            },
+            .lod = {lod_bias, 0.0f, 0.0f, 0.0f}
+        };
+        vkCmdPushConstants(command_buffer, self->pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(mesh_push_constants), sizeof(virtual_push_constants), &constants);
+    }
+
+    if (variant) {
+        const mesh_lod *lod = model->lods;
+        for (uint32_t j = lod->first_submesh; j < lod->first_submesh + lod->submesh_count; ++j) {
+            const submesh *part = model->submeshes + j;
+            vkCmdDrawIndexed(command_buffer, part->index_count, 1, part->first_index, part->vertex_offset, self->bindless ? self->texture_slot : 0);
+        }
+    } else {
+        // the lod and visible meshlets are picked per frame, so the draws come from the buffer update_draw_buffer fills
+        for (uint32_t j = 0; j < self->draw_slot_count; j += self->max_draw_indirect_count) {
+            uint32_t draw_count = MIN(self->draw_slot_count - j, self->max_draw_indirect_count);
+            vkCmdDrawIndexedIndirect(command_buffer, self->draw_buffers[image_index], j * sizeof(VkDrawIndexedIndirectCommand), draw_count, sizeof(VkDrawIndexedIndirectCommand));
+        }
+    }
+}
+
+// the pages the frame needs, copied out for update_virtual_texture to read once the frame is done
+static void record_feedback_commands(my_application *self, VkCommandBuffer command_buffer, uint32_t image_index, uint32_t variant) {
+    VkClearValue clear_value[2] = {
+        {
+            .color = {.uint32 = {VIRTUAL_TEXTURE_NO_PAGE, 0, 0, 0}}
+        }, {
+            .depthStencil = {1.0f, 0}
+        }
+    };
+    VkRenderPassBeginInfo render_pass_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = NULL,
+        .renderPass = self->feedback_render_pass,
+        .framebuffer = self->feedback_frame_buffer,
+        .renderArea = {
+            .offset = {.x = 0, .y = 0},
+            .extent = self->feedback_extent
+        },
+        .clearValueCount = 2,
+        .pClearValues = clear_value
+    };
+    vkCmdBeginRenderPass(command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, self->feedback_pipeline);
+    // derivatives grow with the scale, so the level the full size frame samples is this much finer
+    record_model_draws(self, command_buffer, image_index, variant, -log2f((float)VIRTUAL_FEEDBACK_SCALE));
+    vkCmdEndRenderPass(command_buffer);
+
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {self->feedback_extent.width, self->feedback_extent.height, 1}
+    };
+    vkCmdCopyImageToBuffer(command_buffer, self->feedback_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, self->feedback_buffers[image_index], 1, &region);
+
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
 static bool create_command_buffers(my_application *self) {
-    self->command_buffers = malloc(self->swap_chain_image_count * sizeof(VkCommandBuffer));
+    // the draw benchmark records a second set drawing the reference model
+    uint32_t variant_count = self->benchmark_frames ? 2 : 1;
+    self->command_buffer_count = self->swap_chain_image_count * variant_count;
+    self->command_buffers = malloc(self->command_buffer_count * sizeof(VkCommandBuffer));
     VkCommandBufferAllocateInfo command_buffer_allocate = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .pNext = NULL,
         .commandPool = self->command_pool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = self->swap_chain_image_count
+        .commandBufferCount = self->command_buffer_count
     };
     if (VK_SUCCESS != vkAllocateCommandBuffers(self->device, &command_buffer_allocate, self->command_buffers)) {
         LOG("Command buffers alloc failed!\n");
         return false;
     }
 
-    bool ret = true;
-    for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
-        // begin commands
-        VkCommandBufferBeginInfo cmd_begin_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(self->physical_device, &device_properties);
+    if (self->benchmark_frames && !device_properties.limits.timestampComputeAndGraphics) {
+        LOG("Timestamps are not supported, draw benchmark has no gpu times!\n");
+    } else if (self->benchmark_frames) {
+        self->timestamp_period = device_properties.limits.timestampPeriod;
+        VkQueryPoolCreateInfo query_pool_info = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
             .pNext = NULL,
-            .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-            .pInheritanceInfo = NULL
+            .flags = 0,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = 2 * self->command_buffer_count,
+            .pipelineStatistics = 0
         };
-        if (VK_SUCCESS != vkBeginCommandBuffer(self->command_buffers[i], &cmd_begin_info)) {
-            LOG("Begin command buffer %d failed!\n", i);
-            ret = false;
-            continue;
+        if (VK_SUCCESS != vkCreateQueryPool(self->device, &query_pool_info, MY_VK_ALLOCATOR, &(self->timestamp_query_pool))) {
+            LOG("Create timestamp query pool failed!\n");
+            return false;
         }
+    }
 
-        // begin render pass
-        VkClearValue clear_value[2] = {
-            {
-                .color = {0.0f, 0.0f, 0.0f, 1.0f}
-                //VkClearDepthStencilValue    depthStencil;
-            }, {
-                //VkClearColorValue           color;
-                .depthStencil = {1.0f, 0}
-            }
-        };
-        VkRenderPassBeginInfo render_pass_begin_info = {
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .pNext = NULL,
-            .renderPass = self->render_pass,
-            .framebuffer = self->swap_chain_frame_buffers[i],
-            .renderArea = {
-                .offset = {.x = 0, .y = 0},
-                .extent = self->swap_chain_extent
-            },
-            .clearValueCount = 2,
-            .pClearValues = clear_value
-        };
-        vkCmdBeginRenderPass(self->command_buffers[i], &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    self->image_fences = calloc(self->swap_chain_image_count, sizeof(VkFence));
+
+    bool ret = true;
+    for (uint32_t i = 0; i < self->command_buffer_count; ++i) {
+        ret = record_command_buffer(self, i) && ret;
+    }
+
+    return ret;
+}
 
-        // draw commands
-        vkCmdBindPipeline(self->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, self->pipeline);
+static bool record_command_buffer(my_application *self, uint32_t index) {
+    // begin commands
+    VkCommandBufferBeginInfo cmd_begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+        .pInheritanceInfo = NULL
+    };
+    if (VK_SUCCESS != vkBeginCommandBuffer(self->command_buffers[index], &cmd_begin_info)) {
+        LOG("Begin command buffer %d failed!\n", index);
+        return false;
+    }
 
-        VkBuffer vertex_buffers[] = {self->vertex_buffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(self->command_buffers[i], 0, 1, vertex_buffers, offsets);
-        vkCmdBindIndexBuffer(self->command_buffers[i], self->index_buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdBindDescriptorSets(self->command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, self->pipeline_layout, 0, 1, self->descriptor_sets + i, 0, NULL);
-        vkCmdDrawIndexed(self->command_buffers[i], self->index_count, 1, 0, 0, 0);
+    uint32_t image_index = index % self->swap_chain_image_count;
+    uint32_t variant = index / self->swap_chain_image_count;
+    if (self->timestamp_query_pool) {
+        vkCmdResetQueryPool(self->command_buffers[index], self->timestamp_query_pool, 2 * index, 2);
+        vkCmdWriteTimestamp(self->command_buffers[index], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, self->timestamp_query_pool, 2 * index);
+    }
 
-        // end render pass
-        vkCmdEndRenderPass(self->command_buffers[i]);
+    record_draw_commands(self, self->command_buffers[index], image_index, variant);
 
-        // end commands
-        if (VK_SUCCESS != vkEndCommandBuffer(self->command_buffers[i])) {
-            LOG("End command buffer %d failed!\n", i);
-            ret = false;
-        }
+    if (self->timestamp_query_pool) {
+        vkCmdWriteTimestamp(self->command_buffers[index], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, self->timestamp_query_pool, 2 * index + 1);
     }
 
-    return ret;
+    // end commands
+    if (VK_SUCCESS != vkEndCommandBuffer(self->command_buffers[index])) {
+        LOG("End command buffer %d failed!\n", index);
+        return false;
+    }
+
+    return true;
 }
 
 static bool create_sync_objects(my_application *self) {
@@ -1496,22 +2271,296 @@ static bool create_sync_objects(my_application *self) {
     return ret;
 }
 
-static int32_t find_memory_type(my_application *self, uint32_t type_filter, VkMemoryPropertyFlags property) {
-    int32_t mem_type = -1;
-    VkPhysicalDeviceMemoryProperties mem_props;
-    vkGetPhysicalDeviceMemoryProperties(self->physical_device, &mem_props);
-    for (uint32_t i = 0; i < mem_props.memoryTypeCount; ++i) {
-        if ((type_filter & (1 << i))
-            && ((mem_props.memoryTypes[i].propertyFlags & property) == property)){
-            mem_type = i;
-            break;
+static VkFormat get_vertex_format(uint32_t format) {
+    switch (format) {
+        case VERTEX_FORMAT_FLOAT2: return VK_FORMAT_R32G32_SFLOAT;
+        case VERTEX_FORMAT_FLOAT3: return VK_FORMAT_R32G32B32_SFLOAT;
+        case VERTEX_FORMAT_UNORM16X4: return VK_FORMAT_R16G16B16A16_UNORM;
+        case VERTEX_FORMAT_HALF2: return VK_FORMAT_R16G16_SFLOAT;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+// the type in type_filter that suits intent best, -1 when none can be used for it: types with the preferred flags rank first,
+// then those without the avoided ones, and the larger heap breaks ties, mapped memory is never flushed so it has to be coherent
+static int32_t find_memory_type(my_application *self, uint32_t type_filter, memory_usage intent) {
+    static const VkMemoryPropertyFlags required[] = {
+        0,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    static const VkMemoryPropertyFlags preferred[] = {
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        0,
+        VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    // device local host visible memory is left to dynamic data, it may be the small bar window
+    static const VkMemoryPropertyFlags avoided[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        VK_MEMORY_PROPERTY_HOST_CACHED_BIT
+    };
+
+    const VkPhysicalDeviceMemoryProperties *mem_props = &(self->memory_properties);
+    int32_t mem_type = -1;
+    uint32_t best_rank = 0;
+    VkDeviceSize best_heap_size = 0;
+    for (uint32_t i = 0; i < mem_props->memoryTypeCount; ++i) {
+        VkMemoryPropertyFlags flags = mem_props->memoryTypes[i].propertyFlags;
+        if (!(type_filter & (1u << i)) || (flags & required[intent]) != required[intent]
+            || (flags & (VK_MEMORY_PROPERTY_PROTECTED_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))) {
+            continue;
+        }
+
+        uint32_t rank = ((flags & preferred[intent]) == preferred[intent] ? 2 : 0) + ((flags & avoided[intent]) ? 0 : 1);
+        VkDeviceSize heap_size = mem_props->memoryHeaps[mem_props->memoryTypes[i].heapIndex].size;
+        if (mem_type < 0 || rank > best_rank || (rank == best_rank && heap_size > best_heap_size)) {
+            mem_type = (int32_t)i;
+            best_rank = rank;
+            best_heap_size = heap_size;
         }
     }
 
     return mem_type;
 }
 
-static bool create_buffer(my_application *self, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags property, VkBuffer *buffer, VkDeviceMemory *buffer_mempry) {
+// freeing the memory unmaps it
+static bool allocate_mapped_memory(my_application *self, uint32_t type, VkDeviceSize size, bool host_visible, VkDeviceMemory *memory, uint8_t **mapped) {
+    VkMemoryAllocateInfo mem_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = size,
+        .memoryTypeIndex = type
+    };
+    if (VK_SUCCESS != vkAllocateMemory(self->device, &mem_alloc_info, MY_VK_ALLOCATOR, memory)) {
+        LOG("Allocate device memory failed!\n");
+        *memory = VK_NULL_HANDLE;
+        return false;
+    }
+
+    *mapped = NULL;
+    if (host_visible && VK_SUCCESS != vkMapMemory(self->device, *memory, 0, VK_WHOLE_SIZE, 0, (void **)mapped)) {
+        LOG("Map device memory failed!\n");
+        vkFreeMemory(self->device, *memory, MY_VK_ALLOCATOR);
+        *memory = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+static uint32_t create_memory_block(my_application *self, uint32_t type, bool optimal, VkDeviceSize size, bool host_visible) {
+    uint32_t index = 0;
+    while (index < self->memory_block_count && self->memory_blocks[index]) {
+        ++ index;
+    }
+    if (index == self->memory_block_count) {
+        memory_block **blocks = realloc(self->memory_blocks, (index + 1) * sizeof(memory_block *));
+        if (!blocks) {
+            LOG("Allocate memory block list failed!\n");
+            return MEMORY_POOL_NO_RANGE;
+        }
+        blocks[index] = NULL;
+        self->memory_blocks = blocks;
+        ++ self->memory_block_count;
+    }
+
+    memory_block *block = calloc(1, sizeof(memory_block));
+    if (!block || !memory_pool_init(&(block->pool), size)) {
+        LOG("Allocate memory block failed!\n");
+        free(block);
+        return MEMORY_POOL_NO_RANGE;
+    }
+    if (!allocate_mapped_memory(self, type, size, host_visible, &(block->memory), &(block->mapped))) {
+        memory_pool_free(&(block->pool));
+        free(block);
+        return MEMORY_POOL_NO_RANGE;
+    }
+
+    block->type = type;
+    block->optimal = optimal;
+    self->memory_blocks[index] = block;
+    return index;
+}
+
+static void destroy_memory_block(my_application *self, uint32_t index) {
+    memory_block *block = self->memory_blocks[index];
+    vkFreeMemory(self->device, block->memory, MY_VK_ALLOCATOR);
+    memory_pool_free(&(block->pool));
+    free(block);
+    self->memory_blocks[index] = NULL;
+}
+
+// optimal for images with optimal tiling, dedicated for memory of its own whatever the size
+static bool allocate_device_memory(my_application *self, const VkMemoryRequirements *requirements, memory_usage intent, bool optimal, bool dedicated, device_memory *memory) {
+    memset(memory, 0, sizeof(device_memory));
+    memory->block = MEMORY_POOL_NO_RANGE;
+    memory->range = MEMORY_POOL_NO_RANGE;
+    memory->size = requirements->size;
+
+    int32_t mem_type = find_memory_type(self, requirements->memoryTypeBits, intent);
+    if (mem_type < 0) {
+        LOG("Find suitable memory type failed!\n");
+        return false;
+    }
+    memory->type = (uint32_t)mem_type;
+
+    const VkMemoryType *type = self->memory_properties.memoryTypes + mem_type;
+    bool host_visible = (type->propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    VkDeviceSize block_size = MIN(MEMORY_BLOCK_SIZE, self->memory_properties.memoryHeaps[type->heapIndex].size / 8);
+    // with a granularity of 1 a buffer and an image never alias a page, so they share blocks
+    optimal = optimal && self->buffer_image_granularity > 1;
+
+    if (!dedicated && requirements->size <= block_size / 2) {
+        // first fit over the blocks of the type, there are few of them
+        for (uint32_t i = 0; i < self->memory_block_count && memory->block == MEMORY_POOL_NO_RANGE; ++i) {
+            memory_block *block = self->memory_blocks[i];
+            if (block && block->type == memory->type && block->optimal == optimal) {
+                memory->range = memory_pool_allocate(&(block->pool), requirements->size, requirements->alignment, &(memory->offset));
+                memory->block = memory->range != MEMORY_POOL_NO_RANGE ? i : MEMORY_POOL_NO_RANGE;
+            }
+        }
+        if (memory->block == MEMORY_POOL_NO_RANGE) {
+            uint32_t index = create_memory_block(self, memory->type, optimal, block_size, host_visible);
+            if (index != MEMORY_POOL_NO_RANGE) {
+                memory->range = memory_pool_allocate(&(self->memory_blocks[index]->pool), requirements->size, requirements->alignment, &(memory->offset));
+                memory->block = index;
+            }
+        }
+        if (memory->range != MEMORY_POOL_NO_RANGE) {
+            memory_block *block = self->memory_blocks[memory->block];
+            memory->memory = block->memory;
+            memory->mapped = block->mapped ? block->mapped + memory->offset : NULL;
+            return true;
+        }
+        // no room for another block, an allocation of the exact size may still fit
+        memory->block = MEMORY_POOL_NO_RANGE;
+        memory->offset = 0;
+    }
+
+    if (!allocate_mapped_memory(self, memory->type, requirements->size, host_visible, &(memory->memory), &(memory->mapped))) {
+        return false;
+    }
+    ++ self->dedicated_counts[memory->type];
+    self->dedicated_bytes[memory->type] += requirements->size;
+    return true;
+}
+
+// give memory back to its block or free a dedicated allocation, an empty memory is left as it is
+static void free_device_memory(my_application *self, device_memory *memory) {
+    if (!memory->memory) {
+        return;
+    }
+
+    if (memory->block == MEMORY_POOL_NO_RANGE) {
+        vkFreeMemory(self->device, memory->memory, MY_VK_ALLOCATOR);
+        -- self->dedicated_counts[memory->type];
+        self->dedicated_bytes[memory->type] -= memory->size;
+    } else {
+        memory_block *block = self->memory_blocks[memory->block];
+        memory_pool_release(&(block->pool), memory->range);
+
+        // an empty block is given back unless it is the last of its kind, which spares the next allocation a new block
+        bool last = true;
+        for (uint32_t i = 0; i < self->memory_block_count && last && !block->pool.allocation_count; ++i) {
+            memory_block *other = self->memory_blocks[i];
+            last = !other || other == block || other->type != block->type || other->optimal != block->optimal;
+        }
+        if (!last) {
+            destroy_memory_block(self, memory->block);
+        }
+    }
+
+    memset(memory, 0, sizeof(device_memory));
+}
+
+static void destroy_memory_blocks(my_application *self) {
+    for (uint32_t i = 0; i < self->memory_block_count; ++i) {
+        if (self->memory_blocks[i]) {
+            if (self->memory_blocks[i]->pool.allocation_count) {
+                LOG("Memory block %d still holds %d allocations!\n", i, self->memory_blocks[i]->pool.allocation_count);
+            }
+            destroy_memory_block(self, i);
+        }
+    }
+    free(self->memory_blocks);
+    self->memory_blocks = NULL;
+    self->memory_block_count = 0;
+}
+
+// stats has an element for each of VK_MAX_MEMORY_TYPES
+static void get_memory_stats(my_application *self, memory_stats *stats) {
+    memset(stats, 0, VK_MAX_MEMORY_TYPES * sizeof(memory_stats));
+    for (uint32_t i = 0; i < self->memory_block_count; ++i) {
+        memory_block *block = self->memory_blocks[i];
+        if (block) {
+            memory_stats *type = stats + block->type;
+            ++ type->block_count;
+            type->block_bytes += block->pool.size;
+            type->used_bytes += block->pool.used;
+            type->largest_free = MAX(type->largest_free, memory_pool_largest_free(&(block->pool)));
+            type->allocation_count += block->pool.allocation_count;
+        }
+    }
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i) {
+        stats[i].dedicated_count = self->dedicated_counts[i];
+        stats[i].dedicated_bytes = self->dedicated_bytes[i];
+    }
+}
+
+// budgets has an element for each of VK_MAX_MEMORY_HEAPS, usage is that of the whole process where VK_EXT_memory_budget
+// is enabled, otherwise the blocks and dedicated allocations made here against a share of the heap
+static void get_memory_budget(my_application *self, heap_budget *budgets) {
+    const VkPhysicalDeviceMemoryProperties *mem_props = &(self->memory_properties);
+    memset(budgets, 0, VK_MAX_MEMORY_HEAPS * sizeof(heap_budget));
+    if (self->memory_budget) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_props = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+            .pNext = NULL
+        };
+        VkPhysicalDeviceMemoryProperties2KHR properties2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR,
+            .pNext = &budget_props
+        };
+        self->ext_funcs->f_vkGetPhysicalDeviceMemoryProperties2KHR(self->physical_device, &properties2);
+        for (uint32_t i = 0; i < mem_props->memoryHeapCount; ++i) {
+            budgets[i].usage = budget_props.heapUsage[i];
+            budgets[i].budget = budget_props.heapBudget[i];
+        }
+        return;
+    }
+
+    memory_stats stats[VK_MAX_MEMORY_TYPES];
+    get_memory_stats(self, stats);
+    for (uint32_t i = 0; i < mem_props->memoryTypeCount; ++i) {
+        budgets[mem_props->memoryTypes[i].heapIndex].usage += stats[i].block_bytes + stats[i].dedicated_bytes;
+    }
+    for (uint32_t i = 0; i < mem_props->memoryHeapCount; ++i) {
+        budgets[i].budget = (VkDeviceSize)(mem_props->memoryHeaps[i].size * MEMORY_BUDGET_FALLBACK_SHARE);
+    }
+}
+
+static void log_memory_stats(my_application *self) {
+    get_memory_budget(self, self->heap_budgets);
+    for (uint32_t i = 0; i < self->memory_properties.memoryHeapCount; ++i) {
+        LOG("Memory heap %d: %llu of %llu bytes budget used, %llu bytes in all\n", i, (unsigned long long)self->heap_budgets[i].usage,
+            (unsigned long long)self->heap_budgets[i].budget, (unsigned long long)self->memory_properties.memoryHeaps[i].size);
+    }
+
+    memory_stats stats[VK_MAX_MEMORY_TYPES];
+    get_memory_stats(self, stats);
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; ++i) {
+        if (stats[i].block_count || stats[i].dedicated_count) {
+            LOG("Memory type %d: %d allocations use %llu of %llu bytes in %d blocks, largest free range %llu bytes, %d dedicated allocations of %llu bytes\n",
+                i, stats[i].allocation_count, (unsigned long long)stats[i].used_bytes, (unsigned long long)stats[i].block_bytes, stats[i].block_count,
+                (unsigned long long)stats[i].largest_free, stats[i].dedicated_count, (unsigned long long)stats[i].dedicated_bytes);
+        }
+    }
+}
+
+static bool create_buffer(my_application *self, VkDeviceSize size, VkBufferUsageFlags usage, memory_usage intent, VkBuffer *buffer, device_memory *buffer_mempry) {
     VkBufferCreateInfo buffer_info = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .pNext = NULL,
@@ -1531,29 +2580,19 @@ static bool create_buffer(my_application *self, VkDeviceSize size, VkBufferUsage
     VkMemoryRequirements mem_reqs;
     vkGetBufferMemoryRequirements(self->device, *buffer, &mem_reqs);
 
-    int32_t mem_type = find_memory_type(self, mem_reqs.memoryTypeBits, property);
-    if (mem_type < 0) {
-        LOG("Find suitable memory type failed!n");
-        return false;
-    }
-
-    VkMemoryAllocateInfo mem_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type
-    };
-    if (VK_SUCCESS != vkAllocateMemory(self->device, &mem_alloc_info, MY_VK_ALLOCATOR, buffer_mempry)) {
+    if (false == allocate_device_memory(self, &mem_reqs, intent, false, false, buffer_mempry)) {
         LOG("Allocate buffer memory failed!\n");
         return false;
     }
 
-    vkBindBufferMemory(self->device, *buffer, *buffer_mempry, 0);
+    vkBindBufferMemory(self->device, *buffer, buffer_mempry->memory, buffer_mempry->offset);
 
     return true;
 }
 
-static VkCommandBuffer begin_single_time_commands(my_application *self) {
+static bool begin_upload_batch(my_application *self, upload_batch *batch) {
+    memset(batch, 0, sizeof(upload_batch));
+
     VkCommandBufferAllocateInfo command_buffer_allocate = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
         .pNext = NULL,
@@ -1561,11 +2600,21 @@ static VkCommandBuffer begin_single_time_commands(my_application *self) {
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
         .commandBufferCount = 1
     };
-
-    VkCommandBuffer command_buffer;
-    if (VK_SUCCESS != vkAllocateCommandBuffers(self->device, &command_buffer_allocate, &command_buffer)) {
+    if (VK_SUCCESS != vkAllocateCommandBuffers(self->device, &command_buffer_allocate, &(batch->command_buffer))) {
         LOG("Allocate command buffer failed!\n");
-        return VK_NULL_HANDLE;
+        batch->command_buffer = VK_NULL_HANDLE;
+        return false;
+    }
+
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0
+    };
+    if (VK_SUCCESS != vkCreateFence(self->device, &fence_info, MY_VK_ALLOCATOR, &(batch->fence))) {
+        LOG("Create upload fence failed!\n");
+        batch->fence = VK_NULL_HANDLE;
+        return false;
     }
 
     VkCommandBufferBeginInfo command_begin = {
@@ -1574,171 +2623,238 @@ static VkCommandBuffer begin_single_time_commands(my_application *self) {
         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
         //const VkCommandBufferInheritanceInfo*    pInheritanceInfo;
     };
-    vkBeginCommandBuffer(command_buffer, &command_begin);
+    return VK_SUCCESS == vkBeginCommandBuffer(batch->command_buffer, &command_begin);
+}
+
+// room in a host visible block owned by the batch, returned mapped for the caller to fill before the batch is submitted
+static void * stage_upload(my_application *self, upload_batch *batch, VkDeviceSize size, VkBuffer *buffer, VkDeviceSize *offset) {
+    VkDeviceSize aligned = (batch->staging_used + UPLOAD_STAGING_ALIGNMENT - 1) & ~(UPLOAD_STAGING_ALIGNMENT - 1);
+    if (batch->staging_mapped && aligned + size <= batch->staging_size) {
+        batch->staging_used = aligned + size;
+        ++ batch->upload_count;
+        *buffer = batch->staging_buffers[batch->staging_count - 1];
+        *offset = aligned;
+        return batch->staging_mapped + aligned;
+    }
+
+    if (batch->staging_count == batch->staging_capacity) {
+        uint32_t capacity = batch->staging_capacity ? batch->staging_capacity * 2 : 16;
+        VkBuffer *buffers = realloc(batch->staging_buffers, capacity * sizeof(VkBuffer));
+        if (buffers) {
+            batch->staging_buffers = buffers;
+        }
+        device_memory *memories = realloc(batch->staging_memories, capacity * sizeof(device_memory));
+        if (memories) {
+            batch->staging_memories = memories;
+        }
+        if (!buffers || !memories) {
+            LOG("Allocate staging buffer list failed!\n");
+            return NULL;
+        }
+        batch->staging_capacity = capacity;
+    }
+
+    VkDeviceSize block_size = MAX(size, UPLOAD_STAGING_BLOCK_SIZE);
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    device_memory staging_buffer_memory = {VK_NULL_HANDLE};
+    if (false == create_buffer(self, block_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_UPLOAD, &staging_buffer, &staging_buffer_memory)) {
+        LOG("Staging buffer create failed!\n");
+        if (staging_buffer) {
+            vkDestroyBuffer(self->device, staging_buffer, MY_VK_ALLOCATOR);
+        }
+        free_device_memory(self, &staging_buffer_memory);
+        return NULL;
+    }
 
-    return command_buffer;
+    batch->staging_buffers[batch->staging_count] = staging_buffer;
+    batch->staging_memories[batch->staging_count] = staging_buffer_memory;
+    ++ batch->staging_count;
+
+    // host visible memory stays mapped
+    uint8_t *mapped = staging_buffer_memory.mapped;
+    batch->staging_mapped = mapped;
+    batch->staging_used = size;
+    batch->staging_size = block_size;
+    ++ batch->upload_count;
+    *buffer = staging_buffer;
+    *offset = 0;
+    return mapped;
 }
 
-static void end_single_time_commands(my_application *self, VkCommandBuffer command_buffer) {
-    vkEndCommandBuffer(command_buffer);
+static bool submit_upload_batch(my_application *self, upload_batch *batch) {
+    // buffer copies become visible to vertex input once, here, images carry their own barriers
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+    };
+    vkCmdPipelineBarrier(batch->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+
+    if (VK_SUCCESS != vkEndCommandBuffer(batch->command_buffer)) {
+        LOG("Record upload commands failed!\n");
+        return false;
+    }
 
     VkSubmitInfo submit = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
         .pNext = NULL,
-        //uint32_t                       waitSemaphoreCount;
-        //const VkSemaphore*             pWaitSemaphores;
-        //const VkPipelineStageFlags*    pWaitDstStageMask;
         .commandBufferCount = 1,
-        .pCommandBuffers = &command_buffer,
-        //uint32_t                       signalSemaphoreCount;
-        //const VkSemaphore*             pSignalSemaphores;
+        .pCommandBuffers = &(batch->command_buffer),
     };
-    vkQueueSubmit(self->graphics_queue, 1, &submit, VK_NULL_HANDLE);
-    vkQueueWaitIdle(self->graphics_queue);
-
-    vkFreeCommandBuffers(self->device, self->command_pool, 1, &command_buffer);
-}
-
-static bool copy_buffer(my_application *self, VkBuffer src, VkBuffer dst, VkDeviceSize size) {
-    VkCommandBuffer command_buffer = begin_single_time_commands(self);
-    if (VK_NULL_HANDLE == command_buffer) {
+    if (VK_SUCCESS != vkQueueSubmit(self->graphics_queue, 1, &submit, batch->fence)) {
+        LOG("Submit upload commands failed!\n");
         return false;
     }
 
-    VkBufferCopy buffer_region = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size
-    };
-    vkCmdCopyBuffer(command_buffer, src, dst, 1, &buffer_region);
-
-    end_single_time_commands(self, command_buffer);
-
+    batch->submitted = true;
     return true;
 }
 
-static bool create_vertex_buffer(my_application *self) {
-    VkDeviceSize buffer_size = self->vertex_count * sizeof(vertex);
-
+// wait for a submitted batch and release it, a batch that was never submitted is only released
+static bool finish_upload_batch(my_application *self, upload_batch *batch) {
     bool ret = true;
-    VkBuffer staging_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
-
-    do {
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer, &staging_buffer_memory)) {
-            LOG("Staging buffer create failed!\n");
-            ret = false;
-            break;
-        }
-
-        void *data = NULL;
-        if (VK_SUCCESS != vkMapMemory(self->device, staging_buffer_memory, 0, buffer_size, 0, &data)) {
-            LOG("Map staging buffer memory failed!\n");
-            ret = false;
-            break;
-        }
-
-        memcpy(data, self->vertices, (size_t)buffer_size);
-        vkUnmapMemory(self->device, staging_buffer_memory);
-
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(self->vertex_buffer), &(self->vertex_buffer_memory))) {
-            LOG("Vertex buffer create failed!\n");
-            ret = false;
-            break;
-        }
-
-        if (false == copy_buffer(self, staging_buffer, self->vertex_buffer, buffer_size)) {
-            LOG("Copy to vertex buffer failed!\n");
-            ret = false;
-            break;
-        }
-
-    } while(false);
+    if (batch->submitted) {
+        ret = VK_SUCCESS == vkWaitForFences(self->device, 1, &(batch->fence), VK_TRUE, UINT64_MAX);
+    }
 
-    if (staging_buffer) {
-        vkDestroyBuffer(self->device, staging_buffer, MY_VK_ALLOCATOR);
+    for (uint32_t i = 0; i < batch->staging_count; ++i) {
+        vkDestroyBuffer(self->device, batch->staging_buffers[i], MY_VK_ALLOCATOR);
+        free_device_memory(self, batch->staging_memories + i);
     }
+    free(batch->staging_buffers);
+    free(batch->staging_memories);
 
-    if (staging_buffer_memory) {
-        vkFreeMemory(self->device, staging_buffer_memory, MY_VK_ALLOCATOR);
+    if (batch->fence) {
+        vkDestroyFence(self->device, batch->fence, MY_VK_ALLOCATOR);
+    }
+    if (batch->command_buffer) {
+        vkFreeCommandBuffers(self->device, self->command_pool, 1, &(batch->command_buffer));
     }
 
+    memset(batch, 0, sizeof(upload_batch));
     return ret;
 }
 
-static bool create_index_buffer(my_application *self) {
-    VkDeviceSize buffer_size = self->index_count * sizeof(uint32_t);
-
-    bool ret = true;
-    VkBuffer staging_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
-
-    do {
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer, &staging_buffer_memory)) {
-            LOG("Staging buffer create failed!\n");
-            ret = false;
-            break;
-        }
+static void copy_buffer(VkCommandBuffer command_buffer, VkBuffer src, VkDeviceSize src_offset, VkBuffer dst, VkDeviceSize size) {
+    VkBufferCopy buffer_region = {
+        .srcOffset = src_offset,
+        .dstOffset = 0,
+        .size = size
+    };
+    vkCmdCopyBuffer(command_buffer, src, dst, 1, &buffer_region);
+}
 
-        void *data = NULL;
-        if (VK_SUCCESS != vkMapMemory(self->device, staging_buffer_memory, 0, buffer_size, 0, &data)) {
-            LOG("Map staging buffer memory failed!\n");
-            ret = false;
-            break;
-        }
+static bool create_device_local_buffer(my_application *self, const void *data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer *buffer, device_memory *buffer_memory) {
+    if (false == create_buffer(self, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, MEMORY_USAGE_GPU_ONLY, buffer, buffer_memory)) {
+        LOG("Device local buffer create failed!\n");
+        return false;
+    }
 
-        memcpy(data, self->indices, (size_t)buffer_size);
-        vkUnmapMemory(self->device, staging_buffer_memory);
+    // where all device local memory is host visible, as on integrated gpus, the data goes straight in,
+    // the submit of the batch makes the host write visible
+    if (buffer_memory->mapped) {
+        memcpy(buffer_memory->mapped, data, (size_t)size);
+        return true;
+    }
 
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(self->index_buffer), &(self->index_buffer_memory))) {
-            LOG("Index buffer create failed!\n");
-            ret = false;
-            break;
-        }
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceSize staging_offset = 0;
+    void *mapped = stage_upload(self, &(self->upload), size, &staging_buffer, &staging_offset);
+    if (!mapped) {
+        return false;
+    }
+    memcpy(mapped, data, (size_t)size);
 
-        if (false == copy_buffer(self, staging_buffer, self->index_buffer, buffer_size)) {
-            LOG("Copy to index buffer failed!\n");
-            ret = false;
-            break;
-        }
+    // the data is copied into staging now, so the caller may release it before the batch is submitted
+    copy_buffer(self->upload.command_buffer, staging_buffer, staging_offset, *buffer, size);
 
-    } while(false);
+    return true;
+}
 
-    if (staging_buffer) {
-        vkDestroyBuffer(self->device, staging_buffer, MY_VK_ALLOCATOR);
-    }
+static bool create_vertex_buffer(my_application *self) {
+    const mesh *model = &(self->model);
+    const void *vertices = model->packed_vertices ? (const void *)model->packed_vertices : (const void *)model->vertices;
+    VkDeviceSize buffer_size = (VkDeviceSize)model->vertex_count * mesh_get_vertex_layout(model)->stride;
+    return create_device_local_buffer(self, vertices, buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &(self->vertex_buffer), &(self->vertex_buffer_memory));
+}
 
-    if (staging_buffer_memory) {
-        vkFreeMemory(self->device, staging_buffer_memory, MY_VK_ALLOCATOR);
-    }
+static bool create_index_buffer(my_application *self) {
+    const mesh *model = &(self->model);
+    const void *indices = model->short_indices ? (const void *)model->short_indices : (const void *)model->indices;
+    VkDeviceSize buffer_size = (VkDeviceSize)model->index_count * mesh_get_index_size(model);
+    self->index_type = model->short_indices ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    return create_device_local_buffer(self, indices, buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &(self->index_buffer), &(self->index_buffer_memory));
+}
 
+static bool create_reference_buffers(my_application *self) {
+    const mesh *model = &(self->reference_model);
+    const void *vertices = model->packed_vertices ? (const void *)model->packed_vertices : (const void *)model->vertices;
+    VkDeviceSize vertex_buffer_size = (VkDeviceSize)model->vertex_count * mesh_get_vertex_layout(model)->stride;
+    self->reference_index_type = VK_INDEX_TYPE_UINT32;
+    bool ret = create_device_local_buffer(self, vertices, vertex_buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &(self->reference_vertex_buffer), &(self->reference_vertex_buffer_memory))
+        && create_device_local_buffer(self, model->indices, model->index_count * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &(self->reference_index_buffer), &(self->reference_index_buffer_memory));
+    mesh_release_data(&(self->reference_model));
     return ret;
 }
 
 static bool create_descriptor_set_layout(my_application *self) {
+    // ubo, a set of its own as dynamic uniform buffers are not allowed in an update after bind pool
+    VkDescriptorSetLayoutBinding uniform_binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .pImmutableSamplers = NULL,
+    };
+    VkDescriptorSetLayoutCreateInfo uniform_set_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .bindingCount = 1,
+        .pBindings = &uniform_binding
+    };
+    if (VK_SUCCESS != vkCreateDescriptorSetLayout(self->device, &uniform_set_layout_info, MY_VK_ALLOCATOR, &(self->uniform_set_layout))) {
+        LOG("Create uniform set layout failed!\n");
+        return false;
+    }
+
     VkDescriptorSetLayoutBinding layout_bindings[2] = {
         {
-            // ubo
-            .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            // sampler, the texture table indexed by the material of the draw or the virtual texture page cache
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = self->texture_table_size,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
             .pImmutableSamplers = NULL,
         }, {
-            // sampler
-            .binding = 1,
+            // virtual texture page table
+            .binding = 2,
             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             .descriptorCount = 1,
             .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
             .pImmutableSamplers = NULL,
         }
     };
+    uint32_t binding_count = self->virtual_texturing ? 2 : 1;
+
+    // unused table elements stay unwritten, and a texture written into a bound set leaves its command buffers valid
+    VkDescriptorBindingFlagsEXT binding_flags[2] = {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+        0
+    };
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+        .pNext = NULL,
+        .bindingCount = binding_count,
+        .pBindingFlags = binding_flags
+    };
 
     VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .pNext = NULL,
-        //VkDescriptorSetLayoutCreateFlags       flags;
-        .bindingCount = 2,
+        .pNext = self->bindless ? &binding_flags_info : NULL,
+        .flags = self->bindless ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT : 0,
+        .bindingCount = binding_count,
         .pBindings = layout_bindings
     };
 
@@ -1750,15 +2866,43 @@ static bool create_descriptor_set_layout(my_application *self) {
     return true;
 }
 
-static bool create_uniform_buffers(my_application *self) {
-    VkDeviceSize buffer_size = sizeof(uniform_buffer_object);
-    self->uniform_buffers = malloc(self->swap_chain_image_count * sizeof(VkBuffer));
-    self->uniform_buffer_memories = malloc(self->swap_chain_image_count * sizeof(VkDeviceMemory));
+static bool create_uniform_partitions(my_application *self) {
+    uniform_partitions *uniforms = &(self->uniforms);
+    VkDeviceSize alignment = self->min_uniform_buffer_offset_alignment;
+    uniforms->partition_size = (sizeof(uniform_buffer_object) + alignment - 1) / alignment * alignment;
+
+    if (false == create_buffer(self, uniforms->partition_size * self->swap_chain_image_count, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MEMORY_USAGE_DYNAMIC, &(uniforms->buffer), &(uniforms->memory))) {
+        LOG("Create uniform buffer failed!\n");
+        return false;
+    }
+
+    return true;
+}
+
+static bool create_draw_buffers(my_application *self) {
+    // enough slots for every meshlet of the largest level drawn on its own, unused slots draw nothing
+    self->draw_slot_count = 1;
+    for (uint32_t i = 0; i < self->model.lod_count; ++i) {
+        const mesh_lod *lod = self->model.lods + i;
+        uint32_t slot_count = 0;
+        for (uint32_t j = lod->first_submesh; j < lod->first_submesh + lod->submesh_count; ++j) {
+            slot_count += MAX(self->model.submeshes[j].meshlet_count, 1);
+        }
+        self->draw_slot_count = MAX(self->draw_slot_count, slot_count);
+    }
+
+    VkDeviceSize buffer_size = self->draw_slot_count * sizeof(VkDrawIndexedIndirectCommand);
+    self->draw_buffers = calloc(self->swap_chain_image_count, sizeof(VkBuffer));
+    self->draw_buffer_memories = calloc(self->swap_chain_image_count, sizeof(device_memory));
+    if (!self->draw_buffers || !self->draw_buffer_memories) {
+        LOG("Allocate draw buffer list failed!\n");
+        return false;
+    }
 
     bool ret = true;
     for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, self->uniform_buffers + i, self->uniform_buffer_memories + i)) {
-            LOG("Create uniform buffer %d failed!\n", i);
+        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, MEMORY_USAGE_DYNAMIC, self->draw_buffers + i, self->draw_buffer_memories + i)) {
+            LOG("Create draw buffer %d failed!\n", i);
             ret = false;
         }
     }
@@ -1769,19 +2913,19 @@ static bool create_uniform_buffers(my_application *self) {
 static bool create_descriptor_pool(my_application *self) {
     VkDescriptorPoolSize pool_size[2] = {
         {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = self->swap_chain_image_count
+            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .descriptorCount = 1
         }, {
             .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = self->swap_chain_image_count
+            .descriptorCount = self->swap_chain_image_count * (self->texture_table_size + (self->virtual_texturing ? 1 : 0))
         }
     };
 
     VkDescriptorPoolCreateInfo pool_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
         .pNext = NULL,
-        //VkDescriptorPoolCreateFlags    flags;
-        .maxSets = self->swap_chain_image_count,
+        .flags = self->bindless ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0,
+        .maxSets = self->swap_chain_image_count + 1,
         .poolSizeCount = 2,
         .pPoolSizes = pool_size
     };
@@ -1809,51 +2953,85 @@ static bool create_descriptor_set(my_application *self) {
         .pSetLayouts = layouts
     };
 
+    VkDescriptorSetAllocateInfo uniform_set_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+        .descriptorPool = self->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &(self->uniform_set_layout)
+    };
+    if (VK_SUCCESS != vkAllocateDescriptorSets(self->device, &uniform_set_alloc_info, &(self->uniform_set))) {
+        LOG("Allocate uniform set failed!\n");
+        free(layouts);
+        return false;
+    }
+
+    // every swap chain image reads its partition of the ring through the same descriptor, the offset comes with the bind
+    VkDescriptorBufferInfo buffer_info = {
+        .buffer = self->uniforms.buffer,
+        .offset = 0,
+        .range = sizeof(uniform_buffer_object)
+    };
+    VkWriteDescriptorSet uniform_write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+        .dstSet = self->uniform_set,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pImageInfo = NULL,
+        .pBufferInfo = &buffer_info,
+        .pTexelBufferView = NULL
+    };
+    vkUpdateDescriptorSets(self->device, 1, &uniform_write, 0, NULL);
+
     bool ret = true;
     self->descriptor_sets = malloc(layout_count * sizeof(VkDescriptorSet));
+    self->descriptor_generations = calloc(layout_count, sizeof(uint64_t));
     if (VK_SUCCESS != vkAllocateDescriptorSets(self->device, &desc_set_alloc_info, self->descriptor_sets)) {
         LOG("Allocate descriptor sets failed!\n");
         ret = false;
     } else {
         for (uint32_t i = 0; i < layout_count; ++i) {
-            VkDescriptorBufferInfo buffer_info = {
-                .buffer = self->uniform_buffers[i],
-                .offset = 0,
-                .range = sizeof(uniform_buffer_object)
-            };
-
             VkDescriptorImageInfo image_info = {
                 .sampler = self->texture_sampler,
-                .imageView = self->texture_image_view,
+                .imageView = self->virtual_texturing ? self->paged.cache_view : self->texture.view,
                 .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
             };
+            VkDescriptorImageInfo table_info = {
+                .sampler = self->paged.table_sampler,
+                .imageView = self->paged.table_view,
+                .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            };
+            self->descriptor_generations[i] = self->texture_generation;
 
             VkWriteDescriptorSet write_desc_set[2] = {
                 {
                     .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
                     .pNext = NULL,
                     .dstSet = self->descriptor_sets[i],
-                    .dstBinding = 0,
-                    .dstArrayElement = 0,
+                    .dstBinding = 1,
+                    .dstArrayElement = self->texture_slot,
                     .descriptorCount = 1,
-                    .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .pImageInfo = NULL,
-                    .pBufferInfo = &buffer_info,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &image_info,
+                    .pBufferInfo = NULL,
                     .pTexelBufferView = NULL
                 }, {
                     .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
                     .pNext = NULL,
                     .dstSet = self->descriptor_sets[i],
-                    .dstBinding = 1,
+                    .dstBinding = 2,
                     .dstArrayElement = 0,
                     .descriptorCount = 1,
                     .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .pImageInfo = &image_info,
+                    .pImageInfo = &table_info,
                     .pBufferInfo = NULL,
                     .pTexelBufferView = NULL
                 }
             };
-            vkUpdateDescriptorSets(self->device, 2, write_desc_set, 0, NULL);
+            vkUpdateDescriptorSets(self->device, self->virtual_texturing ? 2 : 1, write_desc_set, 0, NULL);
         }
     }
 
@@ -1861,7 +3039,9 @@ static bool create_descriptor_set(my_application *self) {
     return ret;
 }
 
-static bool create_image_2d(my_application *self, uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits samplers, VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage *image, VkDeviceMemory *image_memory) {
+// dedicated for memory of its own, attachments come and go with the swap chain and streamed texture levels with the budget,
+// in a block they would leave holes whose memory is never given back
+static bool create_image_2d(my_application *self, uint32_t width, uint32_t height, uint32_t mip_levels, VkSampleCountFlagBits samplers, VkFormat format, VkImageUsageFlags usage, memory_usage intent, bool dedicated, VkImage *image, device_memory *image_memory) {
     VkImageCreateInfo image_info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = NULL,
@@ -1892,34 +3072,17 @@ static bool create_image_2d(my_application *self, uint32_t width, uint32_t heigh
     VkMemoryRequirements mem_reqs;
     vkGetImageMemoryRequirements(self->device, *image, &mem_reqs);
 
-    int32_t mem_type = find_memory_type(self, mem_reqs.memoryTypeBits, properties);
-    if (mem_type < 0) {
-        LOG("Find suitable memory type failed!\n");
-        return false;
-    }
-
-    VkMemoryAllocateInfo mem_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = mem_type
-    };
-    if (VK_SUCCESS != vkAllocateMemory(self->device, &mem_alloc_info, MY_VK_ALLOCATOR, image_memory)) {
+    if (false == allocate_device_memory(self, &mem_reqs, intent, true, dedicated, image_memory)) {
         LOG("Allocate texture memory failed!\n");
         return false;
     }
 
-    vkBindImageMemory(self->device, *image, *image_memory, 0);
+    vkBindImageMemory(self->device, *image, image_memory->memory, image_memory->offset);
 
     return true;
 }
 
-static void transition_image_layout(my_application *self, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels) {
-    VkCommandBuffer command_buffer = begin_single_time_commands(self);
-    if (VK_NULL_HANDLE == command_buffer) {
-        return;
-    }
-
+static void transition_image_layout(VkCommandBuffer command_buffer, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t mip_levels) {
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext = NULL,
@@ -1952,6 +3115,12 @@ static void transition_image_layout(my_application *self, VkImage image, VkForma
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
         dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    } else if (old_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+        // earlier frames sampling the image are done before the copy overwrites it, the contents stay
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        source_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
     } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
@@ -1970,11 +3139,9 @@ static void transition_image_layout(my_application *self, VkImage image, VkForma
     }
 
     vkCmdPipelineBarrier(command_buffer, source_stage, dest_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
-
-    end_single_time_commands(self, command_buffer);
 }
 
-static bool generate_mipmaps(my_application *self, VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels) {
+static bool generate_mipmaps(my_application *self, VkCommandBuffer command_buffer, VkImage image, VkFormat format, int32_t width, int32_t height, uint32_t mip_levels) {
     //VkFormatProperties props;
     //vkGetPhysicalDeviceFormatProperties(self->physical_device, format, &props);
     //if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
@@ -1986,11 +3153,6 @@ static bool generate_mipmaps(my_application *self, VkImage image, VkFormat forma
         return false;
     }
 
-    VkCommandBuffer command_buffer = begin_single_time_commands(self);
-    if (VK_NULL_HANDLE == command_buffer) {
-        return false;
-    }
-
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .pNext = NULL,
@@ -2064,102 +3226,216 @@ static bool generate_mipmaps(my_application *self, VkImage image, VkFormat forma
 
     vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
 
-    end_single_time_commands(self, command_buffer);
-
     return true;
 }
 
-static void copy_buffer_to_image(my_application *self, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer command_buffer = begin_single_time_commands(self);
-    if (VK_NULL_HANDLE == command_buffer) {
-        return;
+static void copy_buffer_to_image(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize buffer_offset, VkImage image, const texture_mip *mips, uint32_t mip_count) {
+    // one region per level, all in a single copy
+    VkBufferImageCopy regions[TEXTURE_MAX_MIPS];
+    for (uint32_t i = 0; i < mip_count; ++i) {
+        regions[i] = (VkBufferImageCopy){
+            .bufferOffset = buffer_offset + mips[i].offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = i,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {
+                .x = 0,
+                .y = 0,
+                .z = 0
+            },
+            .imageExtent = {
+                .width = mips[i].width,
+                .height = mips[i].height,
+                .depth = 1
+            }
+        };
     }
+    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_count, regions);
+}
 
-    VkBufferImageCopy region = {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        },
-        .imageOffset = {
-            .x = 0,
-            .y = 0,
-            .z = 0
-        },
-        .imageExtent = {
-            .width = width,
-            .height = height,
-            .depth = 1    
+static bool create_decoded_texture_image(my_application *self) {
+    mapped_file source;
+    uint32_t width, height;
+    uint8_t *pixels = map_file(TEXTURE_PATH, &source) ? texture_decode(&source, &width, &height) : NULL;
+    unmap_file(&source);
+    if (!pixels) {
+        LOG("Load image file failed!\n");
+        return false;
+    }
+
+    texture_mip mips[TEXTURE_MAX_MIPS];
+    uint32_t mip_levels = texture_mip_count(width, height);
+    size_t chain_size = texture_mip_layout(TEXTURE_FORMAT_RGBA8, width, height, mip_levels, mips);
+    self->mip_levels = mip_levels;
+
+    // blitting needs linear filtering support for the format, without it every level is built on the cpu and uploaded at once
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    self->texture.format = format;
+    bool cpu_mips = TEXTURE_CPU_MIPS || VK_FORMAT_UNDEFINED == find_supported_format(self, &format, 1, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+    VkDeviceSize buffer_size = cpu_mips ? chain_size : mips[0].size;
+    VkCommandBuffer command_buffer = self->upload.command_buffer;
+
+    bool ret = true;
+    do {
+        VkBuffer staging_buffer = VK_NULL_HANDLE;
+        VkDeviceSize staging_offset = 0;
+        void *data = stage_upload(self, &(self->upload), buffer_size, &staging_buffer, &staging_offset);
+        if (!data) {
+            ret = false;
+            break;
         }
-    };
-    vkCmdCopyBufferToImage(command_buffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-    end_single_time_commands(self, command_buffer);
-}
+        float start = high_resolution_clock_now();
+        ret = texture_build_mips(pixels, mips, cpu_mips ? mip_levels : 1, TEXTURE_SRGB_CONTENT, self->workers, data);
+        if (!ret) {
+            LOG("Build texture mips failed!\n");
+            break;
+        }
+        if (cpu_mips) {
+            LOG("Texture mips built on the cpu in %f seconds\n", high_resolution_clock_now() - start);
+        }
+
+        if (false == create_image_2d(self, width, height, mip_levels, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, MEMORY_USAGE_GPU_ONLY, false, &(self->texture.image), &(self->texture.memory))) {
+            LOG("Create a 2d image failed!\n");
+            ret = false;
+            break;
+        }
+
+        transition_image_layout(command_buffer, self->texture.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels);
+        copy_buffer_to_image(command_buffer, staging_buffer, staging_offset, self->texture.image, mips, cpu_mips ? mip_levels : 1);
+        if (cpu_mips) {
+            transition_image_layout(command_buffer, self->texture.image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_levels);
+        } else if (!generate_mipmaps(self, command_buffer, self->texture.image, format, (int32_t)width, (int32_t)height, mip_levels)) {
+            LOG("Generate texture mips failed!\n");
+            ret = false;
+            break;
+        }
+    } while(false);
+
+    texture_decode_free(pixels);
+
+    return ret;
+}
+
+// an image of the levels from first_level down, its level 0 is first_level of the chain,
+// dedicated so a level dropped under memory pressure gives its memory back to the heap
+static bool upload_texture_levels(my_application *self, upload_batch *batch, const texture_chain *chain, uint32_t first_level, VkFormat format, VkImage *image, device_memory *image_memory) {
+    texture_mip mips[TEXTURE_MAX_MIPS];
+    uint32_t mip_count = chain->mip_count - first_level;
+    size_t base = chain->mips[first_level].offset;
+    for (uint32_t i = 0; i < mip_count; ++i) {
+        mips[i] = chain->mips[first_level + i];
+        mips[i].offset -= base;
+    }
+    size_t size = mips[mip_count - 1].offset + mips[mip_count - 1].size;
+
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceSize staging_offset = 0;
+    void *data = stage_upload(self, batch, size, &staging_buffer, &staging_offset);
+    if (!data) {
+        return false;
+    }
+    memcpy(data, chain->data + base, size);
 
-static bool create_texture_image(my_application *self) {
-    int width, height, channels;
-    stbi_uc *pixels = stbi_load(TEXTURE_PATH, &width, &height, &channels, STBI_rgb_alpha);
-    if (!pixels) {
-        LOG("Load image file failed!\n");
+    if (false == create_image_2d(self, mips[0].width, mips[0].height, mip_count, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, MEMORY_USAGE_GPU_ONLY, true, image, image_memory)) {
+        LOG("Create a 2d image failed!\n");
         return false;
     }
 
-    float length = (float)(width > height ? width : height);
-    uint32_t mip_levels = (uint32_t)floorf(log2f(length)) + 1;
-    self->mip_levels = mip_levels;
+    VkCommandBuffer command_buffer = batch->command_buffer;
+    transition_image_layout(command_buffer, *image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_count);
+    copy_buffer_to_image(command_buffer, staging_buffer, staging_offset, *image, mips, mip_count);
+    transition_image_layout(command_buffer, *image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_count);
 
-    VkDeviceSize buffer_size = width * height * 4;
-    VkBuffer staging_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory staging_buffer_memory = VK_NULL_HANDLE;
+    return true;
+}
 
-    bool ret = true;
-    do {
-        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &staging_buffer, &staging_buffer_memory)) {
-            LOG("Staging buffer create failed!\n");
-            ret = false;
-            break;
-        }
+static bool create_cooked_texture_image(my_application *self) {
+    // the cooker defaults, see MODEL_SRC_PATH
+    texture_cook_settings settings = texture_cook_default_settings;
+    settings.srgb = TEXTURE_SRGB_CONTENT;
+    settings.block_compress = TEXTURE_BLOCK_COMPRESSION && self->texture_compression_bc;
 
-        void *data = NULL;
-        if (VK_SUCCESS != vkMapMemory(self->device, staging_buffer_memory, 0, buffer_size, 0, &data)) {
-            LOG("Map staging buffer memory failed!\n");
-            ret = false;
-            break;
-        }
+    texture_load loads[] = {
+        {.source_path = TEXTURE_PATH, .bin_path = TEXTURE_BIN_PATH}
+    };
+    uint32_t load_count = sizeof(loads) / sizeof(texture_load);
 
-        memcpy(data, pixels, (size_t)buffer_size);
-        vkUnmapMemory(self->device, staging_buffer_memory);
+    float start = high_resolution_clock_now();
+    texture_loader *loader = texture_loader_start(self->workers, &settings, loads, load_count);
+    if (!loader) {
+        return false;
+    }
 
-        if (false == create_image_2d(self, (uint32_t)width, (uint32_t)height, mip_levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(self->texture_image), &(self->texture_image_memory))) {
-            LOG("Create a 2d image failed!\n");
+    // textures are staged in the order they finish loading, while the workers go on with the rest
+    bool ret = true;
+    texture_load *load = NULL;
+    while ((load = texture_loader_next(loader)) != NULL) {
+        float upload_start = high_resolution_clock_now();
+        bool kept = false;
+        if (!load->loaded) {
+            LOG("Load texture %s failed!\n", load->source_path);
             ret = false;
-            break;
+        } else if (load->chain.layer_count != 1) {
+            // there is no 2d array path, an atlas has to fit one layer, see --atlas-size of the cooker
+            LOG("Texture %s has %d atlas layers, only a single layer loads as a 2d texture!\n", load->source_path, load->chain.layer_count);
+            ret = false;
+        } else if (ret) {
+            // only the mip tail goes up with the startup batch, the load stays with the texture for the levels streamed in later
+            VkFormat formats[] = {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC3_UNORM_BLOCK}; // by texture_format
+            streamed_texture *texture = &(self->texture);
+            texture->load = *load;
+            kept = true;
+            texture->format = formats[load->chain.format];
+            self->mip_levels = load->chain.mip_count;
+            if (self->virtual_texturing) {
+                // the pages are cut from the mapped levels as the feedback asks for them
+                ret = create_paged_texture(self, &(self->paged), &(texture->load.chain), texture->format);
+            } else {
+                texture_residency_init(&(texture->residency), &(load->chain), TEXTURE_STREAM_TAIL_SIZE);
+                texture->streaming = true;
+                ret = upload_texture_levels(self, &(self->upload), &(load->chain), texture->residency.resident_level, texture->format, &(texture->image), &(texture->memory));
+                LOG("Texture %s starts with levels from %d, %d bytes\n", load->source_path, texture->residency.resident_level, (uint32_t)texture_residency_size(&(texture->residency), texture->residency.resident_level));
+            }
         }
 
-        transition_image_layout(self, self->texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_levels);
-        copy_buffer_to_image(self, staging_buffer, self->texture_image, (uint32_t)width, (uint32_t)height);
-        //transition_image_layout(self, self->texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mip_levels);
-        if (generate_mipmaps(self, self->texture_image, VK_FORMAT_R8G8B8A8_UNORM, width, height, mip_levels)) {
-            // generate mipmaps here 
+        float upload_seconds = high_resolution_clock_now() - upload_start;
+        LOG("Texture %s %s in %f seconds, staged in %f seconds\n", load->source_path, load->cooked ? "cooked" : "read", load->load_seconds, upload_seconds);
+        if (!kept) {
+            texture_load_release(load);
         }
+    }
+    texture_loader_delete(loader);
 
-        vkDestroyBuffer(self->device, staging_buffer, MY_VK_ALLOCATOR);
-        vkFreeMemory(self->device, staging_buffer_memory, MY_VK_ALLOCATOR);
-    } while(false);
+    if (ret) {
+        LOG("%d textures loaded in %f seconds on %d workers\n", load_count, high_resolution_clock_now() - start, thread_pool_size(self->workers));
+    }
+    return ret;
+}
 
-    stbi_image_free(pixels);
+static bool create_texture_image(my_application *self) {
+    // no decode and no blits, block compressed levels also take a quarter or an eighth of the rgba8 size in memory and on the bus
+    if (TEXTURE_COOKED) {
+        return create_cooked_texture_image(self);
+    }
 
-    return ret;
+    return create_decoded_texture_image(self);
 }
 
 static bool create_texture_image_view(my_application *self) {
-    self->texture_image_view = create_image_view_2d(self, self->texture_image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, self->mip_levels);
-    if (VK_NULL_HANDLE == self->texture_image_view) {
+    // the page cache and table got their views with them
+    if (self->virtual_texturing) {
+        return true;
+    }
+
+    // a streamed texture holds the levels from its resident level down
+    self->texture.view = create_image_view_2d(self, self->texture.image, self->texture.format, VK_IMAGE_ASPECT_COLOR_BIT, self->mip_levels - self->texture.residency.resident_level);
+    if (VK_NULL_HANDLE == self->texture.view) {
         LOG("Texture image view create failed!\n");
         return false;
     }
@@ -2197,6 +3473,355 @@ static bool create_texture_sampler(my_application *self) {
     return true;
 }
 
+// upload an image of the levels from level down and submit it, update_texture_streaming swaps it in once it is done
+static bool begin_texture_change(my_application *self, streamed_texture *texture, uint32_t level) {
+    upload_batch *batch = &(texture->batch);
+    bool ret = begin_upload_batch(self, batch)
+        && upload_texture_levels(self, batch, &(texture->load.chain), level, texture->format, &(texture->pending_image), &(texture->pending_memory))
+        && submit_upload_batch(self, batch);
+    if (ret) {
+        texture->pending_view = create_image_view_2d(self, texture->pending_image, texture->format, VK_IMAGE_ASPECT_COLOR_BIT, texture->residency.mip_count - level);
+        ret = VK_NULL_HANDLE != texture->pending_view;
+    }
+    texture->pending_level = level;
+
+    if (!ret) {
+        LOG("Stream texture %s to level %d failed!\n", texture->load.source_path, level);
+        finish_upload_batch(self, batch);
+        if (texture->pending_image) {
+            vkDestroyImage(self->device, texture->pending_image, MY_VK_ALLOCATOR);
+        }
+        free_device_memory(self, &(texture->pending_memory));
+        texture->pending_image = VK_NULL_HANDLE;
+    }
+    return ret;
+}
+
+// called once a frame before update_texture_streaming, every MEMORY_BUDGET_INTERVAL frames the budgets are read again and
+// the stream budget follows the heap of the texture: past the high water mark the texture gives the overshoot back level by level,
+// below the low one it may grow into the room left under it, in between the budget stays as it is,
+// every change allocates the new image before the old one is retired, so even a drop raises the usage for a few frames
+static void update_memory_residency(my_application *self) {
+    if (self->frame_number % MEMORY_BUDGET_INTERVAL) {
+        return;
+    }
+    get_memory_budget(self, self->heap_budgets);
+
+    // a change in flight holds the old and the new image, the usage read now would overstate the overshoot
+    streamed_texture *texture = &(self->texture);
+    if (!texture->streaming || !texture->memory.memory || texture->batch.submitted || texture->retired_image) {
+        return;
+    }
+
+    const heap_budget *heap = self->heap_budgets + self->memory_properties.memoryTypes[texture->memory.type].heapIndex;
+    VkDeviceSize high = (VkDeviceSize)(heap->budget * MEMORY_BUDGET_HIGH_WATER);
+    VkDeviceSize low = (VkDeviceSize)(heap->budget * MEMORY_BUDGET_LOW_WATER);
+    VkDeviceSize resident = texture_residency_size(&(texture->residency), texture->residency.resident_level);
+    if (heap->usage > high) {
+        VkDeviceSize over = heap->usage - high;
+        self->texture_stream_budget = (size_t)(resident > over ? resident - over : 0);
+        if (!self->memory_pressure) {
+            LOG("Heap usage %llu is past %llu at frame %d, texture budget lowered to %llu bytes\n", (unsigned long long)heap->usage,
+                (unsigned long long)high, (uint32_t)self->frame_number, (unsigned long long)self->texture_stream_budget);
+        }
+        self->memory_pressure = true;
+    } else if (heap->usage < low) {
+        self->texture_stream_budget = (size_t)MIN(TEXTURE_STREAM_BUDGET, resident + (low - heap->usage));
+        if (self->memory_pressure) {
+            LOG("Heap usage %llu is below %llu at frame %d, texture budget raised to %llu bytes\n", (unsigned long long)heap->usage,
+                (unsigned long long)low, (uint32_t)self->frame_number, (unsigned long long)self->texture_stream_budget);
+        }
+        self->memory_pressure = false;
+    }
+}
+
+// called once a frame after its flight fence is waited on, moves at most one step:
+// drop the image retired last, swap in a finished upload or start the next residency change
+static void update_texture_streaming(my_application *self) {
+    streamed_texture *texture = &(self->texture);
+    texture->residency.last_used_frame = self->frame_number;
+
+    // frames submitted before the swap may still sample the old image until both flight fences have come around
+    if (texture->retired_image) {
+        if (self->frame_number < texture->retired_frame + MAX_FRAMES_IN_FLIGHT) {
+            return;
+        }
+        vkDestroyImageView(self->device, texture->retired_view, MY_VK_ALLOCATOR);
+        vkDestroyImage(self->device, texture->retired_image, MY_VK_ALLOCATOR);
+        free_device_memory(self, &(texture->retired_memory));
+        texture->retired_image = VK_NULL_HANDLE;
+        texture->retired_view = VK_NULL_HANDLE;
+    }
+
+    if (texture->batch.submitted) {
+        if (VK_SUCCESS != vkGetFenceStatus(self->device, texture->batch.fence)) {
+            return;
+        }
+        finish_upload_batch(self, &(texture->batch));
+
+        texture->retired_image = texture->image;
+        texture->retired_memory = texture->memory;
+        texture->retired_view = texture->view;
+        texture->retired_frame = self->frame_number;
+        texture->image = texture->pending_image;
+        texture->memory = texture->pending_memory;
+        texture->view = texture->pending_view;
+        texture->pending_image = VK_NULL_HANDLE;
+        memset(&(texture->pending_memory), 0, sizeof(device_memory));
+        texture->pending_view = VK_NULL_HANDLE;
+        texture->residency.resident_level = texture->pending_level;
+        ++ self->texture_generation;
+
+        LOG("Texture %s has levels from %d at frame %d, %d bytes\n", texture->load.source_path, texture->residency.resident_level, (uint32_t)self->frame_number, (uint32_t)texture_residency_size(&(texture->residency), texture->residency.resident_level));
+        return;
+    }
+
+    uint32_t index = 0;
+    uint32_t level = 0;
+    if (texture->streaming && texture_residency_next(&(texture->residency), 1, self->texture_stream_budget, self->frame_number, TEXTURE_STREAM_IDLE_FRAMES, &index, &level)) {
+        texture->streaming = begin_texture_change(self, texture, level);
+    }
+}
+
+// point the descriptor set of a swap chain image at the current texture image and record its command buffers again
+// unless the set is bindless, the last frame drawn to the image has to be done
+static void update_texture_descriptor(my_application *self, uint32_t image_index) {
+    VkDescriptorImageInfo image_info = {
+        .sampler = self->texture_sampler,
+        .imageView = self->texture.view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+
+    VkWriteDescriptorSet write_desc_set = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+        .dstSet = self->descriptor_sets[image_index],
+        .dstBinding = 1,
+        .dstArrayElement = self->texture_slot,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &image_info,
+        .pBufferInfo = NULL,
+        .pTexelBufferView = NULL
+    };
+    vkUpdateDescriptorSets(self->device, 1, &write_desc_set, 0, NULL);
+    self->descriptor_generations[image_index] = self->texture_generation;
+
+    // writing a bound set invalidates the command buffers using it, update after bind elements are the exception
+    if (self->bindless) {
+        return;
+    }
+    for (uint32_t i = image_index; i < self->command_buffer_count; i += self->swap_chain_image_count) {
+        record_command_buffer(self, i);
+    }
+}
+
+static void destroy_streamed_texture(my_application *self, streamed_texture *texture) {
+    finish_upload_batch(self, &(texture->batch));
+
+    VkImageView views[] = {texture->view, texture->pending_view, texture->retired_view};
+    VkImage images[] = {texture->image, texture->pending_image, texture->retired_image};
+    device_memory *memories[] = {&(texture->memory), &(texture->pending_memory), &(texture->retired_memory)};
+    for (uint32_t i = 0; i < 3; ++i) {
+        if (views[i]) {
+            vkDestroyImageView(self->device, views[i], MY_VK_ALLOCATOR);
+        }
+        if (images[i]) {
+            vkDestroyImage(self->device, images[i], MY_VK_ALLOCATOR);
+        }
+        free_device_memory(self, memories[i]);
+    }
+
+    texture_load_release(&(texture->load));
+    memset(texture, 0, sizeof(streamed_texture));
+}
+
+// the cache and table images with the coarsest level mapped, recorded into the startup batch,
+// chain has to stay mapped while the texture is in use
+static bool create_paged_texture(my_application *self, paged_texture *texture, const texture_chain *chain, VkFormat format) {
+    virtual_texture *pages = &(texture->pages);
+    texture->format = format;
+    if (!virtual_texture_init(pages, chain, &virtual_texture_default_settings)) {
+        return false;
+    }
+
+    if (false == create_image_2d(self, virtual_texture_cache_width(pages), virtual_texture_cache_height(pages), 1, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, MEMORY_USAGE_GPU_ONLY, false, &(texture->cache_image), &(texture->cache_memory))
+        || false == create_image_2d(self, pages->page_columns[0], pages->page_rows[0], pages->level_count, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, MEMORY_USAGE_GPU_ONLY, false, &(texture->table_image), &(texture->table_memory))) {
+        LOG("Create page cache images failed!\n");
+        return false;
+    }
+
+    texture->cache_view = create_image_view_2d(self, texture->cache_image, format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    texture->table_view = create_image_view_2d(self, texture->table_image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_ASPECT_COLOR_BIT, pages->level_count);
+    if (VK_NULL_HANDLE == texture->cache_view || VK_NULL_HANDLE == texture->table_view) {
+        LOG("Create page cache image views failed!\n");
+        return false;
+    }
+
+    // entries are fetched, never filtered
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = pages->level_count - 1.0f,
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+        .unnormalizedCoordinates = VK_FALSE
+    };
+    if (VK_SUCCESS != vkCreateSampler(self->device, &sampler_info, MY_VK_ALLOCATOR, &(texture->table_sampler))) {
+        LOG("Create page table sampler failed!\n");
+        return false;
+    }
+
+    uint32_t page_count = 0;
+    virtual_texture_request_tail(pages);
+    if (!upload_pages(self, texture, &(self->upload), UINT32_MAX, true, &page_count)) {
+        return false;
+    }
+    // a startup batch that fails stops init
+    virtual_texture_commit(pages);
+
+    LOG("Virtual texture of %dx%d has %d levels of %d pages, cache of %d pages\n", chain->mips[0].width, chain->mips[0].height, pages->level_count, pages->page_count, pages->slot_count);
+    return true;
+}
+
+// copy up to max_pages requested pages into their cache slots and the page table after them, recorded into batch,
+// first for the images still undefined at startup
+static bool upload_pages(my_application *self, paged_texture *texture, upload_batch *batch, uint32_t max_pages, bool first, uint32_t *page_count) {
+    virtual_texture *pages = &(texture->pages);
+    VkCommandBuffer command_buffer = batch->command_buffer;
+    VkImageLayout old_layout = first ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    size_t page_bytes = virtual_texture_page_bytes(pages);
+    uint32_t stride = pages->settings.page_size + 2 * pages->settings.border;
+
+    transition_image_layout(command_buffer, texture->cache_image, texture->format, old_layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+    uint32_t level, x, y, slot;
+    *page_count = 0;
+    while (*page_count < max_pages && virtual_texture_next(pages, self->frame_number, &level, &x, &y, &slot)) {
+        VkBuffer staging_buffer = VK_NULL_HANDLE;
+        VkDeviceSize staging_offset = 0;
+        void *data = stage_upload(self, batch, page_bytes, &staging_buffer, &staging_offset);
+        if (!data) {
+            return false;
+        }
+        virtual_texture_copy_page(pages, level, x, y, data);
+
+        VkBufferImageCopy region = {
+            .bufferOffset = staging_offset,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {
+                .x = (int32_t)(slot % pages->settings.cache_columns * stride),
+                .y = (int32_t)(slot / pages->settings.cache_columns * stride),
+                .z = 0
+            },
+            .imageExtent = {stride, stride, 1}
+        };
+        vkCmdCopyBufferToImage(command_buffer, staging_buffer, texture->cache_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        ++ *page_count;
+    }
+    transition_image_layout(command_buffer, texture->cache_image, texture->format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+
+    // the whole table goes up with the pages it points at, a level of it is a level of the table image
+    if (!virtual_texture_update_table(pages)) {
+        return true;
+    }
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    VkDeviceSize staging_offset = 0;
+    void *data = stage_upload(self, batch, pages->table_size * sizeof(uint32_t), &staging_buffer, &staging_offset);
+    if (!data) {
+        return false;
+    }
+    memcpy(data, pages->table, pages->table_size * sizeof(uint32_t));
+
+    texture_mip mips[TEXTURE_MAX_MIPS];
+    for (uint32_t i = 0; i < pages->level_count; ++i) {
+        mips[i].width = pages->page_columns[i];
+        mips[i].height = pages->page_rows[i];
+        mips[i].offset = pages->first_page[i] * sizeof(uint32_t);
+        mips[i].size = pages->page_columns[i] * pages->page_rows[i] * sizeof(uint32_t);
+    }
+    transition_image_layout(command_buffer, texture->table_image, VK_FORMAT_R8G8B8A8_UINT, old_layout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, pages->level_count);
+    copy_buffer_to_image(command_buffer, staging_buffer, staging_offset, texture->table_image, mips, pages->level_count);
+    transition_image_layout(command_buffer, texture->table_image, VK_FORMAT_R8G8B8A8_UINT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, pages->level_count);
+    return true;
+}
+
+// called once the last frame drawn to a swap chain image is done, the pages its feedback asks for go up in a batch
+// submitted ahead of this frame, one batch at a time, so texture memory stays the size of the cache
+static void update_virtual_texture(my_application *self, uint32_t image_index) {
+    paged_texture *texture = &(self->paged);
+    if (texture->batch.submitted) {
+        if (VK_SUCCESS != vkGetFenceStatus(self->device, texture->batch.fence)) {
+            return;
+        }
+        finish_upload_batch(self, &(texture->batch));
+    }
+
+    const uint32_t *feedback = (const uint32_t *)self->feedback_buffer_memories[image_index].mapped;
+    virtual_texture_feedback(&(texture->pages), feedback, self->feedback_extent.width * self->feedback_extent.height, self->frame_number);
+    if (texture->pages.request_count == 0) {
+        return;
+    }
+
+    uint32_t page_count = 0;
+    bool ret = begin_upload_batch(self, &(texture->batch))
+        && upload_pages(self, texture, &(texture->batch), VIRTUAL_PAGES_PER_FRAME, false, &page_count);
+    if (ret && page_count) {
+        ret = submit_upload_batch(self, &(texture->batch));
+    }
+    if (ret) {
+        virtual_texture_commit(&(texture->pages));
+    } else {
+        // the pages of the failed batch have no texels, they are requested again
+        LOG("Upload of %d pages failed!\n", page_count);
+        virtual_texture_cancel(&(texture->pages));
+    }
+    if (!ret || !page_count) {
+        finish_upload_batch(self, &(texture->batch));
+    }
+}
+
+static void destroy_paged_texture(my_application *self, paged_texture *texture) {
+    finish_upload_batch(self, &(texture->batch));
+
+    if (texture->table_sampler) {
+        vkDestroySampler(self->device, texture->table_sampler, MY_VK_ALLOCATOR);
+    }
+
+    VkImageView views[] = {texture->cache_view, texture->table_view};
+    VkImage images[] = {texture->cache_image, texture->table_image};
+    device_memory *memories[] = {&(texture->cache_memory), &(texture->table_memory)};
+    for (uint32_t i = 0; i < 2; ++i) {
+        if (views[i]) {
+            vkDestroyImageView(self->device, views[i], MY_VK_ALLOCATOR);
+        }
+        if (images[i]) {
+            vkDestroyImage(self->device, images[i], MY_VK_ALLOCATOR);
+        }
+        free_device_memory(self, memories[i]);
+    }
+
+    virtual_texture_free(&(texture->pages));
+    memset(texture, 0, sizeof(paged_texture));
+}
+
 static VkFormat find_supported_format(my_application *self, VkFormat *formats, uint32_t count, VkImageTiling tiling, VkFormatFeatureFlags features) {
     for (uint32_t i = 0; i < count; ++i) {
         VkFormat format = formats[i];
@@ -2232,7 +3857,7 @@ static bool create_depth_resources(my_application *self) {
     uint32_t width = self->swap_chain_extent.width;
     uint32_t height = self->swap_chain_extent.height;
 
-    if (false == create_image_2d(self, width, height, 1, self->msaa_samplers, format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(self->depth_image), &(self->depth_image_memory))) {
+    if (false == create_image_2d(self, width, height, 1, self->msaa_samplers, format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, MEMORY_USAGE_GPU_ONLY, true, &(self->depth_image), &(self->depth_image_memory))) {
         LOG("Create depth image failed!\n");
         return false;
     }
@@ -2243,7 +3868,7 @@ static bool create_depth_resources(my_application *self) {
         return false;
     }
 
-    transition_image_layout(self, self->depth_image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+    transition_image_layout(self->upload.command_buffer, self->depth_image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
 
     self->depth_image_view = image_view;
     self->depth_format = format;
@@ -2251,123 +3876,66 @@ static bool create_depth_resources(my_application *self) {
     return true;
 }
 
-static bool load_model_source(my_application *self) {
-    char *obj_content = NULL;
-    uint32_t obj_size = 0;
-
-    if (!read_file(MODEL_SRC_PATH, &obj_content, &obj_size)) {
-        LOG("Read model file failed!\n");
+static bool load_model_source(my_application *self, const mapped_file *source, const model_cook_settings *settings, uint64_t source_hash) {
+    if (!model_cook(source, self->workers, settings, &(self->model))) {
+        LOG("Cook model failed!\n");
         return false;
     }
 
-    tinyobj_attrib_t obj_attrib;
-    tinyobj_shape_t *obj_shapes = NULL;
-    size_t shape_count = 0;
-    tinyobj_material_t *obj_materials = NULL;
-    size_t material_count = 0;
-    if (TINYOBJ_SUCCESS == tinyobj_parse_obj(&obj_attrib, &obj_shapes, &shape_count, &obj_materials, &material_count, obj_content, obj_size, TINYOBJ_FLAG_TRIANGULATE)) {
-        uint32_t face_count = 0;
-        for (size_t i = 0; i < shape_count; ++i) {
-            face_count += obj_shapes[i].length;
-        }
-        uint32_t vertex_count = 3 * face_count;
-        vertex *vertices = malloc(vertex_count * sizeof(vertex));
-        uint32_t index_count = vertex_count;
-        uint32_t *indices = malloc(index_count * sizeof(uint32_t));
-        uint32_t next_vertex_index = 0;
-        for (size_t i = 0; i < shape_count; ++i) {
-            for (uint32_t j = obj_shapes[i].face_offset; j < obj_shapes[i].face_offset + obj_shapes[i].length; ++j) {
-                for (uint32_t m = 0; m < 3; ++m) {
-                    uint32_t index = 3 * j + m;
-                    float *position = obj_attrib.vertices + obj_attrib.faces[index].v_idx * 3;
-                    float *texcoord = obj_attrib.texcoords + obj_attrib.faces[index].vt_idx * 2;
-                    vertex v = {
-                        {position[0], position[1], position[2]},
-                        {texcoord[0], 1.0f - texcoord[1]},
-                        {1.0f, 1.0f, 1.0f}
-                    };
-                    uint32_t vertex_index = next_vertex_index;
-                    for (uint32_t n = 0; n < next_vertex_index; ++n) {
-                        if (vertices[n].position[0] == v.position[0]
-                            && vertices[n].position[1] == v.position[1]
-                            && vertices[n].position[2] == v.position[2]
-                            && vertices[n].texcoord[0] == v.texcoord[0]
-                            && vertices[n].texcoord[1] == v.texcoord[1]) {
-                            vertex_index = n;
-                            break;
-                        }
-                    }
-                    if (vertex_index == next_vertex_index) {
-                        vertex *vert = vertices + vertex_index;
-                        *vert = v;
-                        ++ next_vertex_index;
-                    }
-                    indices[index] = vertex_index;
-                }
-            }
-        }
-
-        uint32_t final_vertex_count = next_vertex_index;
-        self->vertex_count = final_vertex_count;
-        self->vertices = malloc(final_vertex_count * sizeof(vertex));
-        memcpy(self->vertices, vertices, final_vertex_count * sizeof(vertex));
-        free(vertices);
-
-        self->indices = indices;
-        self->index_count = index_count;
-
-        // write to file
-        FILE *binFile = fopen(MODEL_BIN_PATH, "wb");
-        if (binFile) {
-            fwrite(&(self->vertex_count), sizeof(uint32_t), 1, binFile);
-            fwrite(&(self->index_count), sizeof(uint32_t), 1, binFile);
-            fwrite(self->vertices, sizeof(vertex), (size_t)self->vertex_count, binFile);
-            fwrite(self->indices, sizeof(uint32_t), (size_t)self->index_count, binFile);
-            fclose(binFile);
-        }
-
-        tinyobj_attrib_free(&obj_attrib);
-        tinyobj_shapes_free(obj_shapes, shape_count);
-        tinyobj_materials_free(obj_materials, material_count);
-
-        return true;
+    // write to file
+    if (!mesh_file_write(MODEL_BIN_PATH, source_hash, &(self->model), 1)) {
+        LOG("Write model binary file failed!\n");
     }
 
-    LOG("Load model file failed!\n");
-    free(obj_content);
-    return false;
+    return true;
 }
 
-static bool load_model_binary(my_application *self) {
-    char *content = NULL;
-    uint32_t size = 0;
-
-    if (!read_file(MODEL_BIN_PATH, &content, &size)) {
+static bool load_model_binary(my_application *self, const mapped_file *source, uint64_t source_hash) {
+    if (!mesh_file_open(MODEL_BIN_PATH, &(self->model_file))) {
         LOG("Read model binary file failed!\n");
         return false;
     }
 
-    char *buffer = content;
-    size_t count_size = sizeof(uint32_t);
+    // without the source there is nothing to compare against, so any valid binary is used
+    if ((source->data && self->model_file.header->source_hash != source_hash)
+        || !mesh_file_get_mesh(&(self->model_file), 0, &(self->model))
+        || (self->model.packed_vertices != NULL) != MODEL_PACKED_VERTICES) {
+        LOG("Model binary file is stale!\n");
+        mesh_free(&(self->model));
+        mesh_file_close(&(self->model_file));
+        return false;
+    }
+
+    return true;
+}
 
-    self->vertex_count = *((uint32_t *)buffer);
-    buffer += count_size;
+static bool load_model(my_application *self) {
+    // the cooker defaults, see MODEL_SRC_PATH
+    model_cook_settings settings = model_cook_default_settings;
+    settings.packed_vertices = MODEL_PACKED_VERTICES;
 
-    self->index_count = *((uint32_t *)buffer);
-    buffer += count_size;
+    mapped_file source = {0};
+    uint64_t source_hash = 0;
+    if (map_file(MODEL_SRC_PATH, &source)) {
+        source_hash = model_cook_source_hash(&source, &settings);
+    }
 
-    size_t vertex_buffer_size = self->vertex_count * sizeof(vertex);
-    self->vertices = malloc(vertex_buffer_size);
-    memcpy(self->vertices, buffer, vertex_buffer_size);
-    buffer += vertex_buffer_size;
+    bool ret = load_model_binary(self, &source, source_hash);
+    if (!ret && source.data) {
+        ret = load_model_source(self, &source, &settings, source_hash);
+    }
 
-    size_t index_buffer_size = self->index_count * sizeof(uint32_t);
-    self->indices = malloc(index_buffer_size);
-    memcpy(self->indices, buffer, index_buffer_size);
-    buffer += index_buffer_size;
+    // the benchmark compares against the source as imported, without the optimization passes
+    if (ret && self->benchmark_frames) {
+        ret = source.data && mesh_parse_obj(source.data, source.size, self->workers, &(self->reference_model))
+            && (!MODEL_PACKED_VERTICES || mesh_pack_vertices(&(self->reference_model)));
+        if (!ret) {
+            LOG("Draw benchmark needs the model source!\n");
+        }
+    }
 
-    free(content);
-    return true;
+    unmap_file(&source);
+    return ret;
 }
 
 static VkSampleCountFlagBits get_max_usable_sample_count(my_application *self) {
@@ -2390,7 +3958,7 @@ static bool create_color_resources(my_application *self) {
     uint32_t width = self->swap_chain_extent.width;
     uint32_t height = self->swap_chain_extent.height;
 
-    if (false == create_image_2d(self, width, height, 1, self->msaa_samplers, color_format, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &(self->color_image), &(self->color_image_memory))) {
+    if (false == create_image_2d(self, width, height, 1, self->msaa_samplers, color_format, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, MEMORY_USAGE_GPU_ONLY, true, &(self->color_image), &(self->color_image_memory))) {
         LOG("Create msaa image failed!\n");
         return false;
     }
@@ -2402,12 +3970,88 @@ static bool create_color_resources(my_application *self) {
     }
 
     self->color_image_view = image_view;
-    transition_image_layout(self, self->color_image, color_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+    transition_image_layout(self->upload.command_buffer, self->color_image, color_format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
 
     return true;
 }
 
+// target, depth and framebuffer of the feedback pass and a host visible copy of the target per swap chain image
+static bool create_feedback_resources(my_application *self) {
+    uint32_t width = self->feedback_extent.width;
+    uint32_t height = self->feedback_extent.height;
+    if (false == create_image_2d(self, width, height, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_UINT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_GPU_ONLY, true, &(self->feedback_image), &(self->feedback_image_memory))
+        || false == create_image_2d(self, width, height, 1, VK_SAMPLE_COUNT_1_BIT, self->depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, MEMORY_USAGE_GPU_ONLY, true, &(self->feedback_depth_image), &(self->feedback_depth_image_memory))) {
+        LOG("Create feedback images failed!\n");
+        return false;
+    }
+
+    self->feedback_image_view = create_image_view_2d(self, self->feedback_image, VK_FORMAT_R32_UINT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    self->feedback_depth_image_view = create_image_view_2d(self, self->feedback_depth_image, self->depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+    if (VK_NULL_HANDLE == self->feedback_image_view || VK_NULL_HANDLE == self->feedback_depth_image_view) {
+        LOG("Create feedback image views failed!\n");
+        return false;
+    }
+
+    VkImageView attachments[2] = {self->feedback_image_view, self->feedback_depth_image_view};
+    VkFramebufferCreateInfo frame_buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .renderPass = self->feedback_render_pass,
+        .attachmentCount = 2,
+        .pAttachments = attachments,
+        .width = width,
+        .height = height,
+        .layers = 1
+    };
+    if (VK_SUCCESS != vkCreateFramebuffer(self->device, &frame_buffer_info, MY_VK_ALLOCATOR, &(self->feedback_frame_buffer))) {
+        LOG("Feedback frame buffer create failed!\n");
+        return false;
+    }
+
+    VkDeviceSize buffer_size = (VkDeviceSize)width * height * sizeof(uint32_t);
+    self->feedback_buffers = calloc(self->swap_chain_image_count, sizeof(VkBuffer));
+    self->feedback_buffer_memories = calloc(self->swap_chain_image_count, sizeof(device_memory));
+    bool ret = true;
+    for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
+        if (false == create_buffer(self, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_USAGE_READBACK, self->feedback_buffers + i, self->feedback_buffer_memories + i)) {
+            LOG("Create feedback buffer %d failed!\n", i);
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
 static void cleanup_swap_chain(my_application *self) {
+    if (self->feedback_buffers && self->feedback_buffer_memories) {
+        for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
+            vkDestroyBuffer(self->device, self->feedback_buffers[i], MY_VK_ALLOCATOR);
+            free_device_memory(self, self->feedback_buffer_memories + i);
+        }
+        free(self->feedback_buffers);
+        free(self->feedback_buffer_memories);
+        self->feedback_buffers = NULL;
+        self->feedback_buffer_memories = NULL;
+    }
+
+    if (self->feedback_frame_buffer) {
+        vkDestroyFramebuffer(self->device, self->feedback_frame_buffer, MY_VK_ALLOCATOR);
+    }
+
+    VkImageView feedback_views[] = {self->feedback_image_view, self->feedback_depth_image_view};
+    VkImage feedback_images[] = {self->feedback_image, self->feedback_depth_image};
+    device_memory *feedback_memories[] = {&(self->feedback_image_memory), &(self->feedback_depth_image_memory)};
+    for (uint32_t i = 0; i < 2; ++i) {
+        if (feedback_views[i]) {
+            vkDestroyImageView(self->device, feedback_views[i], MY_VK_ALLOCATOR);
+        }
+        if (feedback_images[i]) {
+            vkDestroyImage(self->device, feedback_images[i], MY_VK_ALLOCATOR);
+        }
+        free_device_memory(self, feedback_memories[i]);
+    }
+
+
     if (self->color_image_view) {
         vkDestroyImageView(self->device, self->color_image_view, MY_VK_ALLOCATOR);
     }
@@ -2416,9 +4060,7 @@ static void cleanup_swap_chain(my_application *self) {
         vkDestroyImage(self->device, self->color_image, MY_VK_ALLOCATOR);
     }
 
-    if (self->color_image_memory) {
-        vkFreeMemory(self->device, self->color_image_memory, MY_VK_ALLOCATOR);
-    }
+    free_device_memory(self, &(self->color_image_memory));
 
     if (self->depth_image_view) {
         vkDestroyImageView(self->device, self->depth_image_view, MY_VK_ALLOCATOR);
@@ -2428,9 +4070,7 @@ static void cleanup_swap_chain(my_application *self) {
         vkDestroyImage(self->device, self->depth_image, MY_VK_ALLOCATOR);
     }
 
-    if (self->depth_image_memory) {
-        vkFreeMemory(self->device, self->depth_image_memory, MY_VK_ALLOCATOR);
-    }
+    free_device_memory(self, &(self->depth_image_memory));
 
     if (self->swap_chain_frame_buffers) {
         for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
@@ -2440,14 +4080,28 @@ static void cleanup_swap_chain(my_application *self) {
     }
 
     if (self->command_buffers) {
-        vkFreeCommandBuffers(self->device, self->command_pool, self->swap_chain_image_count, self->command_buffers);
+        vkFreeCommandBuffers(self->device, self->command_pool, self->command_buffer_count, self->command_buffers);
         free(self->command_buffers);
     }
 
+    if (self->image_fences) {
+        free(self->image_fences);
+        self->image_fences = NULL;
+    }
+
+    if (self->timestamp_query_pool) {
+        vkDestroyQueryPool(self->device, self->timestamp_query_pool, MY_VK_ALLOCATOR);
+        self->timestamp_query_pool = VK_NULL_HANDLE;
+    }
+
     if (self->pipeline) {
         vkDestroyPipeline(self->device, self->pipeline, MY_VK_ALLOCATOR);
     }
 
+    if (self->feedback_pipeline) {
+        vkDestroyPipeline(self->device, self->feedback_pipeline, MY_VK_ALLOCATOR);
+    }
+
     if (self->pipeline_layout) {
         vkDestroyPipelineLayout(self->device, self->pipeline_layout, MY_VK_ALLOCATOR);
     }
@@ -2456,6 +4110,10 @@ static void cleanup_swap_chain(my_application *self) {
         vkDestroyRenderPass(self->device, self->render_pass, MY_VK_ALLOCATOR);
     }
 
+    if (self->feedback_render_pass) {
+        vkDestroyRenderPass(self->device, self->feedback_render_pass, MY_VK_ALLOCATOR);
+    }
+
     if (self->swap_chain_image_views) {
         for (uint32_t i = 0; i < self->swap_chain_image_count; ++i) {
             vkDestroyImageView(self->device, self->swap_chain_image_views[i], MY_VK_ALLOCATOR);
@@ -2488,15 +4146,22 @@ static void recreate_swap_chain(my_application *self) {
     create_swap_chain_image_views(self);
     create_render_pass(self);
     create_graphics_pipeline(self);
+    begin_upload_batch(self, &(self->upload));
     create_color_resources(self);
     create_depth_resources(self);
+    submit_upload_batch(self, &(self->upload));
+    finish_upload_batch(self, &(self->upload));
     create_frame_buffers(self);
+    if (self->virtual_texturing) {
+        create_feedback_resources(self);
+    }
     create_command_buffers(self);
 }
 
 static void draw_frame(my_application *self) {
     vkWaitForFences(self->device, 1, &(self->flight_fences[self->current_frame]), VK_TRUE, UINT64_MAX);
-    vkResetFences(self->device, 1, &(self->flight_fences[self->current_frame]));
+    update_memory_residency(self);
+    update_texture_streaming(self);
 
     uint32_t image_index;
     VkResult ret = vkAcquireNextImageKHR(self->device, self->swap_chain, UINT64_MAX, self->image_available_semaphores[self->current_frame], VK_NULL_HANDLE, &image_index);
@@ -2508,7 +4173,25 @@ static void draw_frame(my_application *self) {
         return;
     }
 
-    update_uniform_buffer(self, image_index);
+    // the image may still be in use by a frame from the other flight slot
+    if (self->image_fences[image_index]) {
+        vkWaitForFences(self->device, 1, self->image_fences + image_index, VK_TRUE, UINT64_MAX);
+        if (self->virtual_texturing) {
+            update_virtual_texture(self, image_index);
+        }
+    }
+    self->image_fences[image_index] = self->flight_fences[self->current_frame];
+    if (self->descriptor_generations[image_index] != self->texture_generation) {
+        update_texture_descriptor(self, image_index);
+    }
+
+    uniform_buffer_object ubo;
+    compute_uniform_buffer_object(self, &ubo);
+    update_uniform_buffer(self, image_index, &ubo);
+    update_draw_buffer(self, image_index, &ubo);
+
+    uint32_t variant = self->benchmark_frames ? self->frame_count % 2 : 0;
+    uint32_t command_index = variant * self->swap_chain_image_count + image_index;
 
     VkSemaphore wait_semaphores[] = {self->image_available_semaphores[self->current_frame]};
     VkPipelineStageFlags wait_stage_flags[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
@@ -2521,15 +4204,22 @@ static void draw_frame(my_application *self) {
         .pWaitSemaphores = wait_semaphores,
         .pWaitDstStageMask = wait_stage_flags,
         .commandBufferCount = 1,
-        .pCommandBuffers = self->command_buffers + image_index,
+        .pCommandBuffers = self->command_buffers + command_index,
         .signalSemaphoreCount = 1,
         .pSignalSemaphores = signal_semaphores
     };
 
+    // reset only now, an early return above leaves it signaled for the next wait
+    vkResetFences(self->device, 1, &(self->flight_fences[self->current_frame]));
     if (VK_SUCCESS != vkQueueSubmit(self->graphics_queue, 1, &submit_info, self->flight_fences[self->current_frame])) {
         LOG("Graphics queue submit failed!\n");
         return;
     }
+    ++ self->frame_number;
+
+    if (self->benchmark_frames) {
+        collect_benchmark_sample(self, command_index, variant);
+    }
 
     VkSwapchainKHR swap_chains[] = {self->swap_chain};
     VkPresentInfoKHR present_info = {
@@ -2553,39 +4243,137 @@ static void draw_frame(my_application *self) {
     self->current_frame = (self->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
 }
 
-static void update_uniform_buffer(my_application *self, uint32_t index) {
+static void collect_benchmark_sample(my_application *self, uint32_t command_index, uint32_t variant) {
+    // waiting here serializes cpu and gpu, which is fine since only gpu time is measured
+    uint64_t timestamps[2];
+    if (self->timestamp_query_pool && self->frame_count >= BENCHMARK_WARMUP_FRAMES
+        && VK_SUCCESS == vkGetQueryPoolResults(self->device, self->timestamp_query_pool, 2 * command_index, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT)) {
+        self->benchmark_gpu_time[variant] += (double)(timestamps[1] - timestamps[0]) * self->timestamp_period * 1e-6;
+        ++ self->benchmark_samples[variant];
+    }
+
+    if (++ self->frame_count == BENCHMARK_WARMUP_FRAMES) {
+        vk_allocator_snapshot(&(self->benchmark_allocations));
+    }
+    if (self->frame_count < self->benchmark_frames) {
+        return;
+    }
+
+    const char *names[2] = {"optimized", "original"};
+    const mesh *models[2] = {&(self->model), &(self->reference_model)};
+    printf("%-12s %12s %10s %14s\n", "mesh", "triangles", "frames", "gpu time(ms)");
+    for (uint32_t i = 0; i < 2; ++i) {
+        double average = self->benchmark_samples[i] ? self->benchmark_gpu_time[i] / self->benchmark_samples[i] : 0.0;
+        printf("%-12s %12u %10u %14.4f\n", names[i], models[i]->index_count / 3, self->benchmark_samples[i], average);
+    }
+
+    // driver heap churn of the measured frames, live counts are what they left behind
+    vk_allocator_stats now, churn;
+    vk_allocator_snapshot(&now);
+    vk_allocator_difference(&now, &(self->benchmark_allocations), &churn);
+    printf("driver host allocations over %u frames\n", self->benchmark_frames - BENCHMARK_WARMUP_FRAMES);
+    vk_allocator_print(&churn);
+    glfwSetWindowShouldClose(self->window, GLFW_TRUE);
+}
+
+static void compute_uniform_buffer_object(my_application *self, uniform_buffer_object *ubo) {
     float time = high_resolution_clock_now();
-    uniform_buffer_object ubo;
-    glm_mat4_identity(ubo.model);
-    glm_rotate(ubo.model, time * glm_rad(30.0f), (vec3){0.0f, 0.0f, 1.0f});
-    glm_lookat((vec3){2.0f, 2.0f, 2.0f}, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 0.0f, 1.0f}, ubo.view);
+    glm_mat4_identity(ubo->model);
+    glm_rotate(ubo->model, time * glm_rad(30.0f), (vec3){0.0f, 0.0f, 1.0f});
+    glm_lookat((vec3){2.0f, 2.0f, 2.0f}, (vec3){0.0f, 0.0f, 0.0f}, (vec3){0.0f, 0.0f, 1.0f}, ubo->view);
     float aspect = (float)self->swap_chain_extent.width / (float) self->swap_chain_extent.height;
-    glm_perspective_zto(glm_rad(45.0f), aspect, 0.1f, 10.0f, ubo.proj);
-    ubo.proj[1][1] *= -1;
+    glm_perspective_zto(glm_rad(45.0f), aspect, 0.1f, 10.0f, ubo->proj);
+    ubo->proj[1][1] *= -1;
+}
 
-    size_t buffer_size = sizeof(uniform_buffer_object);
-    void *data = NULL;
-    vkMapMemory(self->device, self->uniform_buffer_memories[index], 0, buffer_size, 0, &data);
-    memcpy(data, &ubo, buffer_size);
-    vkUnmapMemory(self->device, self->uniform_buffer_memories[index]);
+// the memory stays mapped, the fence of the image already waited for the frame that read the partition last
+static void update_uniform_buffer(my_application *self, uint32_t index, const uniform_buffer_object *ubo) {
+    memcpy(self->uniforms.memory.mapped + index * self->uniforms.partition_size, ubo, sizeof(uniform_buffer_object));
 }
 
-static bool read_file(const char *file_name, void **content, uint32_t *length) {
-    FILE *file = fopen(file_name, "rb");
-    if (!file) {
-        return false;
+static void update_draw_buffer(my_application *self, uint32_t index, const uniform_buffer_object *ubo) {
+    const mesh *model = &(self->model);
+
+    // distance from the eye to the bounding sphere of the model, the draw benchmark always compares full detail
+    if (self->benchmark_frames) {
+        self->model_lod = 0;
+    } else {
+        vec4 center = {
+            (model->bounds.min[0] + model->bounds.max[0]) * 0.5f,
+            (model->bounds.min[1] + model->bounds.max[1]) * 0.5f,
+            (model->bounds.min[2] + model->bounds.max[2]) * 0.5f,
+            1.0f
+        };
+        vec3 extent = {
+            model->bounds.max[0] - model->bounds.min[0],
+            model->bounds.max[1] - model->bounds.min[1],
+            model->bounds.max[2] - model->bounds.min[2]
+        };
+        mat4 model_view;
+        vec4 view_center;
+        glm_mat4_mul((vec4 *)ubo->view, (vec4 *)ubo->model, model_view);
+        glm_mat4_mulv(model_view, center, view_center);
+        float distance = glm_vec_norm(view_center) - glm_vec_norm(extent) * 0.5f;
+
+        // pixels per unit at distance 1, proj[1][1] is 1 / tan(fov_y / 2) with the y flip
+        float projection_scale = fabsf(ubo->proj[1][1]) * self->swap_chain_extent.height * 0.5f;
+        self->model_lod = mesh_select_lod(model, distance, projection_scale, MODEL_LOD_PIXEL_ERROR);
     }
 
-    fseek(file, 0, SEEK_END);
-    long len = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    // frustum planes and eye in model space, the draw benchmark keeps every meshlet
+    mat4 model_view_proj;
+    mat4 inverse_model_view;
+    vec4 planes[6];
+    glm_mat4_mul((vec4 *)ubo->view, (vec4 *)ubo->model, inverse_model_view);
+    glm_mat4_mul((vec4 *)ubo->proj, inverse_model_view, model_view_proj);
+    glm_mat4_inv(inverse_model_view, inverse_model_view);
+    glm_frustum_planes(model_view_proj, planes);
+    float *eye = inverse_model_view[3];
+    bool cull = !self->benchmark_frames;
+
+    const mesh_lod *lod = model->lods + self->model_lod;
+    VkDeviceSize buffer_size = self->draw_slot_count * sizeof(VkDrawIndexedIndirectCommand);
+    VkDrawIndexedIndirectCommand *commands = (VkDrawIndexedIndirectCommand *)self->draw_buffer_memories[index].mapped;
+    memset(commands, 0, (size_t)buffer_size);
+
+    uint32_t draw_count = 0;
+    self->visible_meshlet_count = 0;
+    for (uint32_t i = lod->first_submesh; i < lod->first_submesh + lod->submesh_count; ++i) {
+        const submesh *part = model->submeshes + i;
+        if (part->meshlet_count == 0) {
+            commands[draw_count ++] = (VkDrawIndexedIndirectCommand){
+                .indexCount = part->index_count,
+                .instanceCount = 1,
+                .firstIndex = part->first_index,
+                .vertexOffset = part->vertex_offset,
+                .firstInstance = self->bindless ? self->texture_slot : 0
+            };
+            continue;
+        }
 
-    void *con = malloc(len * sizeof(char));
-    fread(con, sizeof(char), len, file);
-    fclose(file);
+        // neighbouring visible meshlets are adjacent in the index buffer and share one draw
+        VkDrawIndexedIndirectCommand *command = NULL;
+        for (uint32_t j = part->first_meshlet; j < part->first_meshlet + part->meshlet_count; ++j) {
+            const meshlet *cluster = model->meshlets + j;
+            if (cull && !meshlet_is_visible(cluster, planes, eye)) {
+                command = NULL;
+                continue;
+            }
 
-    *content = con;
-    *length = len;
-    return true;
+            ++ self->visible_meshlet_count;
+            if (command && command->firstIndex + command->indexCount == cluster->first_index) {
+                command->indexCount += cluster->index_count;
+                continue;
+            }
+            command = commands + draw_count ++;
+            *command = (VkDrawIndexedIndirectCommand){
+                .indexCount = cluster->index_count,
+                .instanceCount = 1,
+                .firstIndex = cluster->first_index,
+                .vertexOffset = part->vertex_offset,
+                .firstInstance = self->bindless ? self->texture_slot : 0
+            };
+        }
+    }
 }
 
@@ -1,6 +1,9 @@
 #ifndef VK_EXAMPLE_APPLICATION_H
 #define VK_EXAMPLE_APPLICATION_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 typedef struct my_application my_application;
 
 extern my_application * my_application_new(void);
@@ -9,4 +12,19 @@ extern void my_application_delete(my_application *app);
 
 extern void my_application_run(my_application *app);
 
+// alternate the cooked model with its plain import for frame_count frames, print gpu times and quit
+extern void my_application_run_draw_benchmark(my_application *app, uint32_t frame_count);
+
+// device memory of a heap as of the last budget query, usage is that of the whole process where VK_EXT_memory_budget
+// is supported, otherwise an estimate from the allocations of the application against a share of the heap
+typedef struct my_application_heap_usage {
+    uint64_t size;
+    uint64_t usage;
+    uint64_t budget;
+    bool device_local;
+} my_application_heap_usage;
+
+// fills the first capacity heaps and returns the heap count, 0 before the device is picked
+extern uint32_t my_application_get_heap_usage(const my_application *app, my_application_heap_usage *heaps, uint32_t capacity);
+
 #endif //VK_EXAMPLE_APPLICATION_H
@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "example.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "thread_pool.h"
+#include "benchmark.h"
+
+static const uint32_t GRID_SIZES[] = {32, 64, 128, 256, 512};
+static const uint32_t GRID_SIZE_COUNT = sizeof(GRID_SIZES) / sizeof(uint32_t);
+
+// a (size x size) quad grid, every quad is split into two triangles
+static char * generate_grid_obj(uint32_t size, size_t *length) {
+    uint32_t side = size + 1;
+    size_t capacity = (size_t)side * side * 64 + (size_t)size * size * 96 + 1;
+    char *content = malloc(capacity);
+    if (!content) {
+        return NULL;
+    }
+
+    size_t offset = 0;
+    for (uint32_t y = 0; y < side; ++y) {
+        for (uint32_t x = 0; x < side; ++x) {
+            float u = (float)x / (float)size;
+            float v = (float)y / (float)size;
+            offset += sprintf(content + offset, "v %f %f 0.0\nvt %f %f\n", u, v, u, v);
+        }
+    }
+
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            uint32_t i0 = y * side + x + 1;
+            uint32_t i1 = i0 + 1;
+            uint32_t i2 = i0 + side;
+            uint32_t i3 = i2 + 1;
+            offset += sprintf(content + offset, "f %u/%u %u/%u %u/%u\nf %u/%u %u/%u %u/%u\n",
+                              i0, i0, i1, i1, i3, i3, i0, i0, i3, i3, i2, i2);
+        }
+    }
+
+    // the obj parser expects a terminating character after the last line
+    content[offset ++] = '\0';
+    *length = offset;
+    return content;
+}
+
+static void report_import(const char *name, const char *content, size_t length, thread_pool *pool) {
+    mesh model = {0};
+    float start = high_resolution_clock_now();
+    bool loaded = mesh_parse_obj(content, length, pool, &model);
+    float elapsed = high_resolution_clock_now() - start;
+
+    const char *mode = pool ? "parallel" : "serial";
+    if (!loaded) {
+        printf("%-24s %-8s import failed\n", name, mode);
+        return;
+    }
+
+    double per_million = model.index_count ? elapsed * 1000000.0 / model.index_count : 0.0;
+    printf("%-24s %-8s %12u %12u %10.3f %14.3f %12.1f\n",
+           name, mode, model.vertex_count, model.index_count / 3, elapsed * 1000.0f, per_million * 1000.0,
+           (double)peak_memory_usage() / (1024.0 * 1024.0));
+
+    mesh_free(&model);
+}
+
+static void report_vertex_cache(const char *name, const char *content, size_t length) {
+    mesh model = {0};
+    if (!mesh_parse_obj(content, length, NULL, &model)) {
+        printf("%-24s import failed\n", name);
+        return;
+    }
+
+    vertex_cache_stats before = mesh_analyze_vertex_cache(&model, VERTEX_CACHE_REPORT_SIZE);
+    float start = high_resolution_clock_now();
+    bool optimized = mesh_optimize_vertex_cache(&model);
+    float elapsed = high_resolution_clock_now() - start;
+    vertex_cache_stats after = mesh_analyze_vertex_cache(&model, VERTEX_CACHE_REPORT_SIZE);
+
+    if (optimized) {
+        printf("%-24s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+               name, before.acmr, after.acmr, before.atvr, after.atvr, elapsed * 1000.0f);
+    } else {
+        printf("%-24s optimize failed\n", name);
+    }
+
+    mesh_free(&model);
+}
+
+void run_import_benchmark(const char *file_name) {
+    thread_pool *pool = thread_pool_new(0);
+    printf("import threads: %u\n", thread_pool_size(pool));
+    printf("%-24s %-8s %12s %12s %10s %14s %12s\n", "mesh", "mode", "vertices", "triangles", "time(ms)", "ms/M corners", "peak(MiB)");
+
+    // sizes grow monotonically so the process peak belongs to the latest row
+    char name[32];
+    for (uint32_t i = 0; i < GRID_SIZE_COUNT; ++i) {
+        size_t length = 0;
+        char *content = generate_grid_obj(GRID_SIZES[i], &length);
+        if (!content) {
+            printf("Generate grid %u failed!\n", GRID_SIZES[i]);
+            break;
+        }
+
+        snprintf(name, sizeof(name), "grid %ux%u", GRID_SIZES[i], GRID_SIZES[i]);
+        report_import(name, content, length, NULL);
+        report_import(name, content, length, pool);
+        free(content);
+    }
+
+    char *file_content = NULL;
+    uint32_t file_length = 0;
+    if (file_name) {
+        if (read_file(file_name, (void **)&file_content, &file_length)) {
+            report_import(file_name, file_content, file_length, NULL);
+            report_import(file_name, file_content, file_length, pool);
+        } else {
+            printf("Read %s failed!\n", file_name);
+        }
+    }
+
+    thread_pool_delete(pool);
+
+    printf("\nvertex cache, fifo %u\n", VERTEX_CACHE_REPORT_SIZE);
+    printf("%-24s %10s %10s %10s %10s %10s\n", "mesh", "acmr", "acmr opt", "atvr", "atvr opt", "time(ms)");
+    for (uint32_t i = 0; i < GRID_SIZE_COUNT; ++i) {
+        size_t length = 0;
+        char *content = generate_grid_obj(GRID_SIZES[i], &length);
+        if (!content) {
+            break;
+        }
+
+        snprintf(name, sizeof(name), "grid %ux%u", GRID_SIZES[i], GRID_SIZES[i]);
+        report_vertex_cache(name, content, length);
+        free(content);
+    }
+
+    if (file_content) {
+        report_vertex_cache(file_name, file_content, file_length);
+        free(file_content);
+    }
+}
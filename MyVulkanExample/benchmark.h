@@ -0,0 +1,7 @@
+#ifndef VK_EXAMPLE_BENCHMARK_H
+#define VK_EXAMPLE_BENCHMARK_H
+
+// import synthetic grids of growing size (and file_name if not NULL), report time and peak memory
+extern void run_import_benchmark(const char *file_name);
+
+#endif //VK_EXAMPLE_BENCHMARK_H
@@ -1,8 +1,11 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "example.h"
 
 #ifdef WIN32
 #include <Windows.h>
+#include <Psapi.h>
 #endif
 
 static LARGE_INTEGER s_frequency;
@@ -26,6 +29,111 @@ float high_resolution_clock_now(void) {
     return (float)((double)elapsed_time.QuadPart / 1000000.0);
 }
 
+size_t peak_memory_usage(void) {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+bool read_file(const char *file_name, void **content, uint32_t *length) {
+    FILE *file = fopen(file_name, "rb");
+    if (!file) {
+        return false;
+    }
+
+    _fseeki64(file, 0, SEEK_END);
+    __int64 len = _ftelli64(file);
+    _fseeki64(file, 0, SEEK_SET);
+    // the length is returned in 32 bits
+    if (len < 0 || len > UINT32_MAX) {
+        fclose(file);
+        return false;
+    }
+
+    void *con = malloc(len * sizeof(char));
+    fread(con, sizeof(char), len, file);
+    fclose(file);
+
+    *content = con;
+    *length = (uint32_t)len;
+    return true;
+}
+
+bool map_file(const char *file_name, mapped_file *out) {
+    memset(out, 0, sizeof(mapped_file));
+
+    HANDLE file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    // empty files can not be mapped
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+    // the view keeps the file and the mapping object alive
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+
+    if (!data) {
+        return false;
+    }
+
+    out->data = data;
+    out->size = (size_t)size.QuadPart;
+    return true;
+}
+
+void unmap_file(mapped_file *file) {
+    if (file->data) {
+        UnmapViewOfFile(file->data);
+    }
+    memset(file, 0, sizeof(mapped_file));
+}
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+    const unsigned char *bytes = data;
+
+    uint64_t hash = seed ^ (size * m);
+
+    size_t block_count = size / 8;
+    for (size_t i = 0; i < block_count; ++i) {
+        uint64_t k;
+        memcpy(&k, bytes + i * 8, sizeof(uint64_t));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        hash ^= k;
+        hash *= m;
+    }
+
+    const unsigned char *tail = bytes + block_count * 8;
+    size_t tail_size = size & 7;
+    if (tail_size) {
+        for (size_t i = tail_size; i > 0; --i) {
+            hash ^= (uint64_t)tail[i - 1] << (8 * (i - 1));
+        }
+        hash *= m;
+    }
+
+    hash ^= hash >> r;
+    hash *= m;
+    hash ^= hash >> r;
+    return hash;
+}
+
 #if defined(_DEBUG) || defined(DEBUG)
 void runtime_log(const char *fmt, ...) {
     static char out[512];
@@ -8,14 +8,39 @@
 #endif
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
-#define MY_VK_ALLOCATOR NULL
+// host allocations of the vulkan driver go through vk_allocator.c, which counts them per scope,
+// declared here without the vulkan headers for the modules that do not use them
+struct VkAllocationCallbacks;
+extern const struct VkAllocationCallbacks * vk_allocator_callbacks(void);
+#define MY_VK_ALLOCATOR vk_allocator_callbacks()
 
 extern void example_init(void);
 
 // start 0.0 from application launch
 extern float high_resolution_clock_now(void);
 
+// peak working set of the process in bytes
+extern size_t peak_memory_usage(void);
+
+extern bool read_file(const char *file_name, void **content, uint32_t *length);
+
+// read-only view of a whole file, pages are faulted in on first touch
+typedef struct mapped_file {
+    const void *data;
+    size_t size;
+} mapped_file;
+
+extern bool map_file(const char *file_name, mapped_file *out);
+
+extern void unmap_file(mapped_file *file);
+
+// 64-bit murmur2 hash, used for content hashes and file checksums
+extern uint64_t hash_bytes(const void *data, size_t size, uint64_t seed);
+
 #if defined(_DEBUG) || defined(DEBUG)
 extern void runtime_log(const char *format, ...);
 #define LOG runtime_log
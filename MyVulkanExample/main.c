@@ -1,11 +1,24 @@
 #include <stdlib.h>
+#include <string.h>
 #include "example.h"
 #include "application.h"
+#include "benchmark.h"
 
 int main(int argc, char *argv[]) {
     example_init();
+
+    if (argc > 1 && !strcmp(argv[1], "--benchmark-import")) {
+        run_import_benchmark(argc > 2 ? argv[2] : NULL);
+        return EXIT_SUCCESS;
+    }
+
     my_application *app = my_application_new();
-    my_application_run(app);
+    if (argc > 1 && !strcmp(argv[1], "--benchmark-draw")) {
+        uint32_t frame_count = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 0;
+        my_application_run_draw_benchmark(app, frame_count ? frame_count : 1000);
+    } else {
+        my_application_run(app);
+    }
     my_application_delete(app);
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,277 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "example.h"
+#include "memory_pool.h"
+
+static uint32_t lowest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return (uint32_t)__builtin_ctzll(value);
+#endif
+}
+
+static uint32_t highest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+// class of a free range of size bytes, sizes below MEMORY_POOL_SECOND_LEVELS get a class each
+static void get_class(uint64_t size, uint32_t *first, uint32_t *second) {
+    if (size < MEMORY_POOL_SECOND_LEVELS) {
+        *first = 0;
+        *second = (uint32_t)size;
+        return;
+    }
+    uint32_t log = highest_bit(size);
+    *first = log - MEMORY_POOL_SECOND_LEVEL_BITS + 1;
+    *second = (uint32_t)(size >> (log - MEMORY_POOL_SECOND_LEVEL_BITS)) - MEMORY_POOL_SECOND_LEVELS;
+}
+
+static bool grow_ranges(memory_pool *pool) {
+    uint32_t capacity = pool->range_capacity ? pool->range_capacity * 2 : 16;
+    memory_range *ranges = realloc(pool->ranges, capacity * sizeof(memory_range));
+    if (!ranges) {
+        LOG("Allocate memory ranges failed!\n");
+        return false;
+    }
+
+    for (uint32_t i = pool->range_capacity; i < capacity; ++i) {
+        ranges[i].next_free = i + 1 < capacity ? i + 1 : pool->unused;
+    }
+    pool->unused = pool->range_capacity;
+    pool->ranges = ranges;
+    pool->range_capacity = capacity;
+    return true;
+}
+
+static uint32_t take_record(memory_pool *pool) {
+    uint32_t index = pool->unused;
+    pool->unused = pool->ranges[index].next_free;
+    return index;
+}
+
+static void give_record(memory_pool *pool, uint32_t index) {
+    pool->ranges[index].next_free = pool->unused;
+    pool->unused = index;
+}
+
+static void insert_free(memory_pool *pool, uint32_t index) {
+    memory_range *range = pool->ranges + index;
+    uint32_t first, second;
+    get_class(range->size, &first, &second);
+
+    uint32_t head = pool->free_lists[first][second];
+    range->free = true;
+    range->previous_free = MEMORY_POOL_NO_RANGE;
+    range->next_free = head;
+    if (head != MEMORY_POOL_NO_RANGE) {
+        pool->ranges[head].previous_free = index;
+    }
+    pool->free_lists[first][second] = index;
+    pool->first_level_map |= 1ull << first;
+    pool->second_level_maps[first] |= 1u << second;
+}
+
+static void remove_free(memory_pool *pool, uint32_t index) {
+    memory_range *range = pool->ranges + index;
+    uint32_t first, second;
+    get_class(range->size, &first, &second);
+
+    if (range->previous_free != MEMORY_POOL_NO_RANGE) {
+        pool->ranges[range->previous_free].next_free = range->next_free;
+    } else {
+        pool->free_lists[first][second] = range->next_free;
+        if (range->next_free == MEMORY_POOL_NO_RANGE) {
+            pool->second_level_maps[first] &= ~(1u << second);
+            if (!pool->second_level_maps[first]) {
+                pool->first_level_map &= ~(1ull << first);
+            }
+        }
+    }
+    if (range->next_free != MEMORY_POOL_NO_RANGE) {
+        pool->ranges[range->next_free].previous_free = range->previous_free;
+    }
+    range->free = false;
+}
+
+// a free range of at least size bytes from the first class whose ranges are all large enough
+static uint32_t find_free(const memory_pool *pool, uint64_t size) {
+    if (size >= MEMORY_POOL_SECOND_LEVELS) {
+        uint64_t round = (1ull << (highest_bit(size) - MEMORY_POOL_SECOND_LEVEL_BITS)) - 1;
+        if (size > UINT64_MAX - round) {
+            return MEMORY_POOL_NO_RANGE;
+        }
+        size += round;
+    }
+
+    uint32_t first, second;
+    get_class(size, &first, &second);
+    uint32_t second_map = pool->second_level_maps[first] & (UINT32_MAX << second);
+    if (!second_map) {
+        uint64_t first_map = first + 1 < MEMORY_POOL_FIRST_LEVELS ? pool->first_level_map & (UINT64_MAX << (first + 1)) : 0;
+        if (!first_map) {
+            return MEMORY_POOL_NO_RANGE;
+        }
+        first = lowest_bit(first_map);
+        second_map = pool->second_level_maps[first];
+    }
+    return pool->free_lists[first][lowest_bit(second_map)];
+}
+
+static uint64_t get_padding(const memory_range *range, uint64_t alignment) {
+    return ((range->offset + alignment - 1) & ~(alignment - 1)) - range->offset;
+}
+
+static bool fits(const memory_range *range, uint64_t size, uint64_t alignment) {
+    uint64_t padding = get_padding(range, alignment);
+    return padding <= range->size && size <= range->size - padding;
+}
+
+// a new range for the part of index from offset on, linked after it
+static uint32_t split_range(memory_pool *pool, uint32_t index, uint64_t offset) {
+    uint32_t split = take_record(pool);
+    memory_range *range = pool->ranges + index;
+    memory_range *after = pool->ranges + split;
+    after->offset = range->offset + offset;
+    after->size = range->size - offset;
+    after->previous = index;
+    after->next = range->next;
+    after->free = false;
+    if (range->next != MEMORY_POOL_NO_RANGE) {
+        pool->ranges[range->next].previous = split;
+    }
+    range->size = offset;
+    range->next = split;
+    return split;
+}
+
+bool memory_pool_init(memory_pool *pool, uint64_t size) {
+    memset(pool, 0, sizeof(memory_pool));
+    memset(pool->free_lists, 0xff, sizeof(pool->free_lists));
+    pool->unused = MEMORY_POOL_NO_RANGE;
+    pool->size = size;
+    if (!size || !grow_ranges(pool)) {
+        return false;
+    }
+
+    uint32_t index = take_record(pool);
+    memory_range *range = pool->ranges + index;
+    range->offset = 0;
+    range->size = size;
+    range->previous = MEMORY_POOL_NO_RANGE;
+    range->next = MEMORY_POOL_NO_RANGE;
+    insert_free(pool, index);
+    return true;
+}
+
+void memory_pool_free(memory_pool *pool) {
+    free(pool->ranges);
+    memset(pool, 0, sizeof(memory_pool));
+}
+
+uint32_t memory_pool_allocate(memory_pool *pool, uint64_t size, uint64_t alignment, uint64_t *offset) {
+    size = MAX(size, 1);
+    alignment = MAX(alignment, 1);
+    if (size > pool->size) {
+        return MEMORY_POOL_NO_RANGE;
+    }
+
+    // the first range large enough may hold an aligned one, otherwise any range large enough for the worst padding does
+    uint32_t index = find_free(pool, size);
+    if (index == MEMORY_POOL_NO_RANGE || !fits(pool->ranges + index, size, alignment)) {
+        index = alignment - 1 <= pool->size - size ? find_free(pool, size + alignment - 1) : MEMORY_POOL_NO_RANGE;
+        if (index == MEMORY_POOL_NO_RANGE) {
+            return MEMORY_POOL_NO_RANGE;
+        }
+    }
+
+    // the padding before the range and the rest after it may need a record each
+    for (uint32_t i = 0, record = pool->unused; i < 2; ++i) {
+        if (record == MEMORY_POOL_NO_RANGE) {
+            if (!grow_ranges(pool)) {
+                return MEMORY_POOL_NO_RANGE;
+            }
+            break;
+        }
+        record = pool->ranges[record].next_free;
+    }
+    remove_free(pool, index);
+
+    // neighbors of a free range are never free, so the padding and the rest stay ranges of their own
+    uint64_t padding = get_padding(pool->ranges + index, alignment);
+    if (padding) {
+        uint32_t aligned = split_range(pool, index, padding);
+        insert_free(pool, index);
+        index = aligned;
+    }
+    if (pool->ranges[index].size > size) {
+        insert_free(pool, split_range(pool, index, size));
+    }
+
+    pool->used += size;
+    ++ pool->allocation_count;
+    *offset = pool->ranges[index].offset;
+    return index;
+}
+
+void memory_pool_release(memory_pool *pool, uint32_t index) {
+    memory_range *range = pool->ranges + index;
+    pool->used -= range->size;
+    -- pool->allocation_count;
+
+    uint32_t previous = range->previous;
+    if (previous != MEMORY_POOL_NO_RANGE && pool->ranges[previous].free) {
+        remove_free(pool, previous);
+        pool->ranges[previous].size += range->size;
+        pool->ranges[previous].next = range->next;
+        if (range->next != MEMORY_POOL_NO_RANGE) {
+            pool->ranges[range->next].previous = previous;
+        }
+        give_record(pool, index);
+        index = previous;
+        range = pool->ranges + index;
+    }
+
+    uint32_t next = range->next;
+    if (next != MEMORY_POOL_NO_RANGE && pool->ranges[next].free) {
+        remove_free(pool, next);
+        range->size += pool->ranges[next].size;
+        range->next = pool->ranges[next].next;
+        if (range->next != MEMORY_POOL_NO_RANGE) {
+            pool->ranges[range->next].previous = index;
+        }
+        give_record(pool, next);
+    }
+
+    insert_free(pool, index);
+}
+
+uint64_t memory_pool_largest_free(const memory_pool *pool) {
+    if (!pool->first_level_map) {
+        return 0;
+    }
+
+    // sizes of a class differ, so the list of the highest one is searched
+    uint32_t first = highest_bit(pool->first_level_map);
+    uint32_t second = highest_bit(pool->second_level_maps[first]);
+    uint64_t largest = 0;
+    for (uint32_t index = pool->free_lists[first][second]; index != MEMORY_POOL_NO_RANGE; index = pool->ranges[index].next_free) {
+        largest = MAX(largest, pool->ranges[index].size);
+    }
+    return largest;
+}
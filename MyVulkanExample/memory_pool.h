@@ -0,0 +1,54 @@
+#ifndef VK_EXAMPLE_MEMORY_POOL_H
+#define VK_EXAMPLE_MEMORY_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// first level classes cover a power of two each, split into MEMORY_POOL_SECOND_LEVELS linear classes
+#define MEMORY_POOL_FIRST_LEVELS 64
+#define MEMORY_POOL_SECOND_LEVEL_BITS 5
+#define MEMORY_POOL_SECOND_LEVELS (1 << MEMORY_POOL_SECOND_LEVEL_BITS)
+#define MEMORY_POOL_NO_RANGE UINT32_MAX
+
+// a used or free part of the pool, its neighbors in offset order and in its free list are indices into the range array
+typedef struct memory_range {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t previous;      // the range ending at offset
+    uint32_t next;          // the range starting at offset + size
+    uint32_t previous_free; // in the free list of its class, or in the list of unused records
+    uint32_t next_free;
+    bool free;
+} memory_range;
+
+// two level segregated fit over the offsets of one block of memory, nothing is stored in the block itself,
+// finding and releasing a range take constant time whatever the number of ranges
+typedef struct memory_pool {
+    uint64_t size;
+    memory_range *ranges;
+    uint32_t range_capacity;
+    uint32_t unused;        // first record no range uses
+    uint64_t first_level_map;
+    uint32_t second_level_maps[MEMORY_POOL_FIRST_LEVELS];
+    uint32_t free_lists[MEMORY_POOL_FIRST_LEVELS][MEMORY_POOL_SECOND_LEVELS];
+    uint64_t used;
+    uint32_t allocation_count;
+} memory_pool;
+
+// the whole of size free
+extern bool memory_pool_init(memory_pool *pool, uint64_t size);
+
+extern void memory_pool_free(memory_pool *pool);
+
+// size bytes at a multiple of alignment, a power of two, MEMORY_POOL_NO_RANGE when no free range is large enough,
+// the range returned stays valid until it is released
+extern uint32_t memory_pool_allocate(memory_pool *pool, uint64_t size, uint64_t alignment, uint64_t *offset);
+
+// give the range back, merged with free neighbors
+extern void memory_pool_release(memory_pool *pool, uint32_t range);
+
+// bytes of the largest free range, a measure of fragmentation next to size - used
+extern uint64_t memory_pool_largest_free(const memory_pool *pool);
+
+#endif //VK_EXAMPLE_MEMORY_POOL_H
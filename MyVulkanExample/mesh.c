@@ -0,0 +1,522 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+
+#include "tinyobj_loader_c.h"
+
+#include "example.h"
+#include "mesh.h"
+
+static const uint32_t WELD_EMPTY_SLOT = UINT32_MAX;
+// keeps the doubled slot count a power of two within 32 bits, indices stay below the empty slot
+static const uint32_t WELD_MAX_CORNERS = 1u << 30;
+
+// smaller chunks are not worth a task
+static const size_t OBJ_MIN_CHUNK_SIZE = 64 * 1024;
+static const size_t OBJ_CHUNKS_PER_THREAD = 4;
+
+const vertex_layout mesh_vertex_layout = {
+    .stride = sizeof(vertex),
+    .attribute_count = 3,
+    .attributes = {
+        {.location = 0, .format = VERTEX_FORMAT_FLOAT3, .offset = offsetof(vertex, position)},
+        {.location = 1, .format = VERTEX_FORMAT_FLOAT2, .offset = offsetof(vertex, texcoord)},
+        {.location = 2, .format = VERTEX_FORMAT_FLOAT3, .offset = offsetof(vertex, color)}
+    }
+};
+
+const vertex_layout mesh_packed_vertex_layout = {
+    .stride = sizeof(packed_vertex),
+    .attribute_count = 2,
+    .attributes = {
+        {.location = 0, .format = VERTEX_FORMAT_UNORM16X4, .offset = offsetof(packed_vertex, position)},
+        {.location = 1, .format = VERTEX_FORMAT_HALF2, .offset = offsetof(packed_vertex, texcoord)}
+    }
+};
+
+// -0.0f and 0.0f compare equal, so they have to land in the same bucket too
+static uint32_t weld_key_bits(float value) {
+    float canonical = value + 0.0f;
+    uint32_t bits;
+    memcpy(&bits, &canonical, sizeof(uint32_t));
+    return bits;
+}
+
+static uint32_t weld_hash(const vertex *v) {
+    uint32_t keys[5] = {
+        weld_key_bits(v->position[0]),
+        weld_key_bits(v->position[1]),
+        weld_key_bits(v->position[2]),
+        weld_key_bits(v->texcoord[0]),
+        weld_key_bits(v->texcoord[1])
+    };
+
+    // fnv-1a over the key words, then murmur3 finalizer to spread low bits
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < 5; ++i) {
+        hash ^= keys[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static bool weld_equal(const vertex *a, const vertex *b) {
+    return a->position[0] == b->position[0]
+        && a->position[1] == b->position[1]
+        && a->position[2] == b->position[2]
+        && a->texcoord[0] == b->texcoord[0]
+        && a->texcoord[1] == b->texcoord[1];
+}
+
+bool mesh_weld(const vertex *corners, uint32_t corner_count, mesh *out) {
+    if (!corners || !out) {
+        return false;
+    }
+
+    if (corner_count > WELD_MAX_CORNERS || corner_count > SIZE_MAX / 2 / sizeof(vertex)) {
+        LOG("Weld %u corners too many!\n", corner_count);
+        return false;
+    }
+
+    // load factor stays under 0.5 even if no corner is shared
+    size_t slot_count = 16;
+    while (slot_count < corner_count * 2ull) {
+        slot_count <<= 1;
+    }
+    uint32_t slot_mask = (uint32_t)(slot_count - 1);
+
+    uint32_t *slots = malloc(slot_count * sizeof(uint32_t));
+    vertex *vertices = malloc(MAX(corner_count, 1) * sizeof(vertex));
+    uint32_t *indices = malloc(MAX(corner_count, 1) * sizeof(uint32_t));
+    if (!slots || !vertices || !indices) {
+        LOG("Allocate weld buffers failed!\n");
+        free(slots);
+        free(vertices);
+        free(indices);
+        return false;
+    }
+    memset(slots, 0xff, slot_count * sizeof(uint32_t));
+
+    uint32_t vertex_count = 0;
+    for (uint32_t i = 0; i < corner_count; ++i) {
+        const vertex *v = corners + i;
+        uint32_t slot = weld_hash(v) & slot_mask;
+        while (slots[slot] != WELD_EMPTY_SLOT && !weld_equal(vertices + slots[slot], v)) {
+            slot = (slot + 1) & slot_mask;
+        }
+
+        if (slots[slot] == WELD_EMPTY_SLOT) {
+            slots[slot] = vertex_count;
+            vertices[vertex_count] = *v;
+            ++ vertex_count;
+        }
+        indices[i] = slots[slot];
+    }
+
+    free(slots);
+
+    vertex *shrunk = realloc(vertices, MAX(vertex_count, 1) * sizeof(vertex));
+    out->vertices = shrunk ? shrunk : vertices;
+    out->vertex_count = vertex_count;
+    out->indices = indices;
+    out->index_count = corner_count;
+
+    return true;
+}
+
+static void obj_parallel_for(void *user_data, size_t count, tinyobj_task_func task, void *task_data) {
+    thread_pool_parallel_for(user_data, count, task, task_data);
+}
+
+bool mesh_parse_obj(const char *content, size_t size, thread_pool *pool, mesh *out) {
+    tinyobj_attrib_t obj_attrib;
+    tinyobj_shape_t *obj_shapes = NULL;
+    size_t shape_count = 0;
+    tinyobj_material_t *obj_materials = NULL;
+    size_t material_count = 0;
+
+    int result;
+    size_t chunk_count = MIN(thread_pool_size(pool) * OBJ_CHUNKS_PER_THREAD, size / OBJ_MIN_CHUNK_SIZE + 1);
+    if (chunk_count > 1) {
+        result = tinyobj_parse_obj_parallel(&obj_attrib, &obj_shapes, &shape_count, &obj_materials, &material_count, content, size, TINYOBJ_FLAG_TRIANGULATE, chunk_count, obj_parallel_for, pool);
+    } else {
+        result = tinyobj_parse_obj(&obj_attrib, &obj_shapes, &shape_count, &obj_materials, &material_count, content, size, TINYOBJ_FLAG_TRIANGULATE);
+    }
+
+    if (TINYOBJ_SUCCESS != result) {
+        LOG("Parse obj content failed!\n");
+        return false;
+    }
+
+    // shape ranges count source 'f' lines, not triangles, so walk the triangulated faces directly
+    uint32_t corner_count = obj_attrib.num_faces;
+    vertex *corners = malloc(MAX(corner_count, 1) * sizeof(vertex));
+    if (!corners) {
+        LOG("Allocate obj corners failed!\n");
+        tinyobj_attrib_free(&obj_attrib);
+        tinyobj_shapes_free(obj_shapes, shape_count);
+        tinyobj_materials_free(obj_materials, material_count);
+        return false;
+    }
+    for (uint32_t i = 0; i < corner_count; ++i) {
+        tinyobj_vertex_index_t face = obj_attrib.faces[i];
+        float *position = obj_attrib.vertices + face.v_idx * 3;
+        float texcoord[2] = {0.0f, 0.0f};
+        if (obj_attrib.num_texcoords) {
+            texcoord[0] = obj_attrib.texcoords[face.vt_idx * 2];
+            texcoord[1] = obj_attrib.texcoords[face.vt_idx * 2 + 1];
+        }
+        vertex v = {
+            {position[0], position[1], position[2]},
+            {texcoord[0], 1.0f - texcoord[1]},
+            {1.0f, 1.0f, 1.0f}
+        };
+        corners[i] = v;
+    }
+
+    // one submesh per run of triangles sharing a material
+    uint32_t triangle_count = corner_count / 3;
+    uint32_t run_count = 0;
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        if (i == 0 || obj_attrib.material_ids[i] != obj_attrib.material_ids[i - 1]) {
+            ++ run_count;
+        }
+    }
+
+    submesh *submeshes = calloc(MAX(run_count, 1), sizeof(submesh));
+    mesh_lod *lods = calloc(1, sizeof(mesh_lod));
+    uint32_t submesh_count = 0;
+    for (uint32_t i = 0; i < triangle_count && submeshes; ++i) {
+        if (i == 0 || obj_attrib.material_ids[i] != obj_attrib.material_ids[i - 1]) {
+            submeshes[submesh_count ++].first_index = 3 * i;
+        }
+        submeshes[submesh_count - 1].index_count += 3;
+    }
+
+    tinyobj_attrib_free(&obj_attrib);
+    tinyobj_shapes_free(obj_shapes, shape_count);
+    tinyobj_materials_free(obj_materials, material_count);
+
+    bool ret = submeshes && lods && mesh_weld(corners, corner_count, out);
+    free(corners);
+    if (!ret) {
+        free(submeshes);
+        free(lods);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < submesh_count; ++i) {
+        submeshes[i].vertex_count = out->vertex_count;
+    }
+    lods[0].submesh_count = submesh_count;
+
+    out->submeshes = submeshes;
+    out->submesh_count = submesh_count;
+    out->lods = lods;
+    out->lod_count = 1;
+    out->borrowed = false;
+    mesh_update_bounds(out);
+
+    return true;
+}
+
+bool mesh_load_obj(const char *file_name, thread_pool *pool, mesh *out) {
+    char *content = NULL;
+    uint32_t size = 0;
+
+    if (!read_file(file_name, (void **)&content, &size)) {
+        LOG("Read obj file %s failed!\n", file_name);
+        return false;
+    }
+
+    bool ret = mesh_parse_obj(content, size, pool, out);
+    free(content);
+    return ret;
+}
+
+static void bounds_reset(mesh_bounds *bounds) {
+    for (uint32_t i = 0; i < 3; ++i) {
+        bounds->min[i] = FLT_MAX;
+        bounds->max[i] = -FLT_MAX;
+    }
+}
+
+static void bounds_add(mesh_bounds *bounds, const float *point) {
+    for (uint32_t i = 0; i < 3; ++i) {
+        bounds->min[i] = MIN(bounds->min[i], point[i]);
+        bounds->max[i] = MAX(bounds->max[i], point[i]);
+    }
+}
+
+void mesh_update_bounds(mesh *m) {
+    bounds_reset(&(m->bounds));
+    for (uint32_t i = 0; i < m->submesh_count; ++i) {
+        submesh *part = m->submeshes + i;
+        bounds_reset(&(part->bounds));
+        for (uint32_t j = part->first_index; j < part->first_index + part->index_count; ++j) {
+            bounds_add(&(part->bounds), m->vertices[part->vertex_offset + m->indices[j]].position);
+        }
+        bounds_add(&(m->bounds), part->bounds.min);
+        bounds_add(&(m->bounds), part->bounds.max);
+    }
+}
+
+static uint16_t quantize_unorm16(float value, float min, float extent) {
+    if (extent <= 0.0f) {
+        return 0;
+    }
+    float normalized = (value - min) / extent;
+    normalized = MIN(MAX(normalized, 0.0f), 1.0f);
+    return (uint16_t)(normalized * 65535.0f + 0.5f);
+}
+
+// round to nearest even, out of range values become infinity, tiny ones denormals or zero
+static uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(uint32_t));
+
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t mantissa = bits & 0x7fffffu;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xffu) - 127 + 15;
+
+    if (((bits >> 23) & 0xffu) == 0xffu) {
+        return (uint16_t)(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7c00u);
+    }
+
+    uint32_t shift = 13;
+    uint32_t half = 0;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000u;
+        shift = (uint32_t)(14 - exponent);
+    } else {
+        half = (uint32_t)exponent << 10;
+    }
+
+    // a carry out of the mantissa bumps the exponent, which is still the right rounding
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    half |= mantissa >> shift;
+    if (rest > halfway || (rest == halfway && (half & 1u))) {
+        ++ half;
+    }
+    return (uint16_t)(sign | half);
+}
+
+bool mesh_pack_vertices(mesh *m) {
+    // a mesh borrowed from a file is read only
+    if (!m->vertices || m->borrowed) {
+        return false;
+    }
+
+    packed_vertex *packed = malloc(MAX(m->vertex_count, 1) * sizeof(packed_vertex));
+    if (!packed) {
+        return false;
+    }
+
+    float extent[3];
+    for (uint32_t i = 0; i < 3; ++i) {
+        extent[i] = m->bounds.max[i] - m->bounds.min[i];
+    }
+
+    for (uint32_t i = 0; i < m->vertex_count; ++i) {
+        const vertex *v = m->vertices + i;
+        packed_vertex *p = packed + i;
+        for (uint32_t j = 0; j < 3; ++j) {
+            p->position[j] = quantize_unorm16(v->position[j], m->bounds.min[j], extent[j]);
+        }
+        p->position[3] = 0;
+        p->texcoord[0] = float_to_half(v->texcoord[0]);
+        p->texcoord[1] = float_to_half(v->texcoord[1]);
+    }
+
+    free(m->vertices);
+    m->vertices = NULL;
+    m->packed_vertices = packed;
+    return true;
+}
+
+// appends an empty piece starting at first_index with its vertices after vertex_count
+static submesh * push_piece(submesh **pieces, uint32_t *piece_count, uint32_t *piece_capacity, uint32_t first_index, uint32_t vertex_count) {
+    if (*piece_count == *piece_capacity) {
+        uint32_t capacity = MAX(*piece_capacity * 2, 16);
+        submesh *grown = realloc(*pieces, capacity * sizeof(submesh));
+        if (!grown) {
+            return NULL;
+        }
+        *pieces = grown;
+        *piece_capacity = capacity;
+    }
+
+    submesh *piece = *pieces + (*piece_count) ++;
+    memset(piece, 0, sizeof(submesh));
+    piece->first_index = first_index;
+    piece->vertex_offset = (int32_t)vertex_count;
+    return piece;
+}
+
+// cut every submesh into runs of triangles touching at most MESH_MAX_SHORT_INDEX_VERTICES vertices,
+// each run gets a copy of its vertices in first use order and indices relative to them
+static bool split_submeshes(mesh *m) {
+    // a piece adds at most one vertex per index
+    vertex *vertices = malloc(MAX(m->index_count, 1) * sizeof(vertex));
+    uint32_t *piece_of = malloc(MAX(m->vertex_count, 1) * sizeof(uint32_t));
+    uint32_t *local = malloc(MAX(m->vertex_count, 1) * sizeof(uint32_t));
+    uint32_t *first_piece = malloc((m->submesh_count + 1) * sizeof(uint32_t));
+    submesh *pieces = NULL;
+    uint32_t piece_count = 0;
+    uint32_t piece_capacity = 0;
+    uint32_t vertex_count = 0;
+
+    bool ret = vertices && piece_of && local && first_piece;
+    if (ret) {
+        memset(piece_of, 0xff, MAX(m->vertex_count, 1) * sizeof(uint32_t));
+    }
+
+    for (uint32_t i = 0; ret && i < m->submesh_count; ++i) {
+        const submesh part = m->submeshes[i];
+        first_piece[i] = piece_count;
+
+        // empty submeshes stay so lods keep their shape
+        submesh *piece = part.index_count ? NULL : push_piece(&pieces, &piece_count, &piece_capacity, part.first_index, vertex_count);
+        ret = part.index_count || piece;
+
+        for (uint32_t j = 0; ret && j + 3 <= part.index_count; j += 3) {
+            uint32_t *triangle = m->indices + part.first_index + j;
+            uint32_t piece_id = piece_count - 1;
+
+            uint32_t added = 0;
+            for (uint32_t k = 0; piece && k < 3; ++k) {
+                added += piece_of[part.vertex_offset + triangle[k]] != piece_id;
+            }
+            if (!piece || piece->vertex_count + added > MESH_MAX_SHORT_INDEX_VERTICES) {
+                piece = push_piece(&pieces, &piece_count, &piece_capacity, part.first_index + j, vertex_count);
+                piece_id = piece_count - 1;
+                ret = piece != NULL;
+            }
+
+            for (uint32_t k = 0; ret && k < 3; ++k) {
+                uint32_t v = part.vertex_offset + triangle[k];
+                if (piece_of[v] != piece_id) {
+                    piece_of[v] = piece_id;
+                    local[v] = piece->vertex_count ++;
+                    vertices[vertex_count ++] = m->vertices[v];
+                }
+                triangle[k] = local[v];
+            }
+            if (ret) {
+                piece->index_count += 3;
+            }
+        }
+    }
+
+    if (ret) {
+        first_piece[m->submesh_count] = piece_count;
+        for (uint32_t i = 0; i < m->lod_count; ++i) {
+            mesh_lod *lod = m->lods + i;
+            uint32_t first = first_piece[lod->first_submesh];
+            lod->submesh_count = first_piece[lod->first_submesh + lod->submesh_count] - first;
+            lod->first_submesh = first;
+        }
+
+        vertex *shrunk = realloc(vertices, MAX(vertex_count, 1) * sizeof(vertex));
+        free(m->vertices);
+        free(m->submeshes);
+        m->vertices = shrunk ? shrunk : vertices;
+        m->vertex_count = vertex_count;
+        m->submeshes = pieces;
+        m->submesh_count = piece_count;
+        mesh_update_bounds(m);
+
+        // clusters may straddle the cuts, they have to be built again
+        free(m->meshlets);
+        m->meshlets = NULL;
+        m->meshlet_count = 0;
+    } else {
+        free(vertices);
+        free(pieces);
+    }
+
+    free(piece_of);
+    free(local);
+    free(first_piece);
+    return ret;
+}
+
+bool mesh_pack_indices(mesh *m) {
+    if (!m->vertices || !m->indices || m->borrowed) {
+        return false;
+    }
+
+    bool split = false;
+    for (uint32_t i = 0; i < m->submesh_count; ++i) {
+        split = split || m->submeshes[i].vertex_count > MESH_MAX_SHORT_INDEX_VERTICES;
+    }
+    if (split && !split_submeshes(m)) {
+        LOG("Split mesh for 16 bit indices failed!\n");
+        return false;
+    }
+
+    uint16_t *short_indices = malloc(MAX(m->index_count, 1) * sizeof(uint16_t));
+    if (!short_indices) {
+        return false;
+    }
+    for (uint32_t i = 0; i < m->index_count; ++i) {
+        short_indices[i] = (uint16_t)m->indices[i];
+    }
+
+    free(m->indices);
+    m->indices = NULL;
+    m->short_indices = short_indices;
+    return true;
+}
+
+uint32_t mesh_get_index_size(const mesh *m) {
+    return m->short_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+const vertex_layout * mesh_get_vertex_layout(const mesh *m) {
+    return m->packed_vertices ? &mesh_packed_vertex_layout : &mesh_vertex_layout;
+}
+
+void mesh_release_data(mesh *m) {
+    if (!m) {
+        return;
+    }
+
+    if (!m->borrowed) {
+        free(m->vertices);
+        free(m->packed_vertices);
+        free(m->indices);
+        free(m->short_indices);
+    }
+    m->vertices = NULL;
+    m->packed_vertices = NULL;
+    m->indices = NULL;
+    m->short_indices = NULL;
+    m->borrowed = false;
+}
+
+void mesh_free(mesh *m) {
+    if (!m) {
+        return;
+    }
+
+    mesh_release_data(m);
+    free(m->submeshes);
+    free(m->lods);
+    free(m->meshlets);
+    memset(m, 0, sizeof(mesh));
+}
@@ -0,0 +1,139 @@
+#ifndef VK_EXAMPLE_MESH_H
+#define VK_EXAMPLE_MESH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cglm/cglm.h"
+#include "example.h"
+#include "thread_pool.h"
+
+typedef struct vertex {
+    vec3 position;
+    vec2 texcoord;
+    vec3 color;
+} vertex;
+
+// compact vertex, positions are unorm16 within the mesh bounds and texcoords are half floats,
+// the color stream is dropped since the importer only ever writes white
+typedef struct packed_vertex {
+    uint16_t position[4]; // w is padding, three 16 bit components are not a widely supported vertex format
+    uint16_t texcoord[2];
+} packed_vertex;
+
+typedef enum vertex_format {
+    VERTEX_FORMAT_FLOAT2 = 1,
+    VERTEX_FORMAT_FLOAT3 = 2,
+    VERTEX_FORMAT_UNORM16X4 = 3,
+    VERTEX_FORMAT_HALF2 = 4
+} vertex_format;
+
+typedef struct vertex_attribute {
+    uint32_t location;
+    uint32_t format; // vertex_format
+    uint32_t offset;
+} vertex_attribute;
+
+#define MESH_MAX_VERTEX_ATTRIBUTES 4
+// vertices a submesh may span to be drawn with 16 bit indices, 0xffff stays free since it means primitive restart
+#define MESH_MAX_SHORT_INDEX_VERTICES 65535
+
+typedef struct vertex_layout {
+    uint32_t stride;
+    uint32_t attribute_count;
+    vertex_attribute attributes[MESH_MAX_VERTEX_ATTRIBUTES];
+} vertex_layout;
+
+// layout of the vertex struct above as this build compiles it
+extern const vertex_layout mesh_vertex_layout;
+// layout of packed_vertex
+extern const vertex_layout mesh_packed_vertex_layout;
+
+typedef struct mesh_bounds {
+    float min[3];
+    float max[3];
+} mesh_bounds;
+
+// a run of triangles small enough to be culled as a whole, the sphere bounds its vertices and
+// every triangle faces away from an eye inside the cone around -cone_axis, cone_cutoff is the sine of its spread
+typedef struct meshlet {
+    uint32_t first_index;
+    uint32_t index_count;
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+} meshlet;
+
+// a range of indices drawn with one vkCmdDrawIndexed, or cluster by cluster once it has meshlets
+typedef struct submesh {
+    uint32_t first_index;
+    uint32_t index_count;
+    int32_t vertex_offset;
+    uint32_t vertex_count;
+    mesh_bounds bounds;
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+} submesh;
+
+// a detail level is a range of submeshes, level 0 is the full mesh
+typedef struct mesh_lod {
+    uint32_t first_submesh;
+    uint32_t submesh_count;
+    float error;
+} mesh_lod;
+
+typedef struct mesh {
+    vertex *vertices;
+    // replaces vertices once mesh_pack_vertices ran, positions dequantize with bounds
+    packed_vertex *packed_vertices;
+    uint32_t vertex_count;
+    uint32_t *indices;
+    // replaces indices once mesh_pack_indices ran
+    uint16_t *short_indices;
+    uint32_t index_count;
+
+    submesh *submeshes;
+    uint32_t submesh_count;
+    mesh_lod *lods;
+    uint32_t lod_count;
+    meshlet *meshlets;
+    uint32_t meshlet_count;
+    mesh_bounds bounds;
+
+    // vertices and indices point into a mesh_file mapping instead of the heap
+    bool borrowed;
+} mesh;
+
+// parse wavefront obj text and build an indexed triangle mesh, the text is parsed in chunks on pool if not NULL
+extern bool mesh_parse_obj(const char *content, size_t size, thread_pool *pool, mesh *out);
+
+extern bool mesh_load_obj(const char *file_name, thread_pool *pool, mesh *out);
+
+// merge corners with exactly the same position and texcoord, corners are consumed in order, fails past 2^30 corners
+extern bool mesh_weld(const vertex *corners, uint32_t corner_count, mesh *out);
+
+// recompute submesh bounds from the vertices they reference, and the mesh bounds from those
+extern void mesh_update_bounds(mesh *m);
+
+// convert vertices to packed_vertices and free them, bounds must be up to date and are not recomputed after this
+extern bool mesh_pack_vertices(mesh *m);
+
+// split submeshes spanning more than MESH_MAX_SHORT_INDEX_VERTICES vertices into pieces with their own vertex range,
+// then convert indices to short_indices, lods are remapped to the pieces, submeshes must not share indices
+// and the mesh must not be packed yet
+extern bool mesh_pack_indices(mesh *m);
+
+// 2 or 4 bytes, whichever index stream the mesh holds
+extern uint32_t mesh_get_index_size(const mesh *m);
+
+// layout of whichever vertex stream the mesh holds
+extern const vertex_layout * mesh_get_vertex_layout(const mesh *m);
+
+// drop vertex and index data once it lives on the gpu, counts, submeshes, lods and meshlets are kept for drawing
+extern void mesh_release_data(mesh *m);
+
+extern void mesh_free(mesh *m);
+
+#endif // VK_EXAMPLE_MESH_H
@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "example.h"
+#include "mesh_cluster.h"
+
+static uint32_t read_index(const mesh *m, uint32_t i) {
+    return m->indices ? m->indices[i] : m->short_indices[i];
+}
+
+// unit normal of the triangle starting at index i, false if it has no area
+static bool meshlet_triangle_normal(const mesh *m, const submesh *part, uint32_t i, float *normal) {
+    const float *p0 = m->vertices[part->vertex_offset + read_index(m, i)].position;
+    const float *p1 = m->vertices[part->vertex_offset + read_index(m, i + 1)].position;
+    const float *p2 = m->vertices[part->vertex_offset + read_index(m, i + 2)].position;
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+    float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (length <= 0.0f) {
+        return false;
+    }
+    normal[0] /= length;
+    normal[1] /= length;
+    normal[2] /= length;
+    return true;
+}
+
+static void compute_meshlet_bounds(const mesh *m, const submesh *part, meshlet *cluster) {
+    // sphere around the box of the vertices, a little loose but cheap
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint32_t i = cluster->first_index; i < cluster->first_index + cluster->index_count; ++i) {
+        const float *p = m->vertices[part->vertex_offset + read_index(m, i)].position;
+        for (uint32_t k = 0; k < 3; ++k) {
+            min[k] = MIN(min[k], p[k]);
+            max[k] = MAX(max[k], p[k]);
+        }
+    }
+
+    float radius = 0.0f;
+    for (uint32_t k = 0; k < 3; ++k) {
+        cluster->center[k] = (min[k] + max[k]) * 0.5f;
+    }
+    for (uint32_t i = cluster->first_index; i < cluster->first_index + cluster->index_count; ++i) {
+        const float *p = m->vertices[part->vertex_offset + read_index(m, i)].position;
+        float dx = p[0] - cluster->center[0];
+        float dy = p[1] - cluster->center[1];
+        float dz = p[2] - cluster->center[2];
+        radius = MAX(radius, dx * dx + dy * dy + dz * dz);
+    }
+    cluster->radius = sqrtf(radius);
+
+    // the axis is the mean normal, the spread is set by the normal furthest from it
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    float normal[3];
+    for (uint32_t i = cluster->first_index; i + 3 <= cluster->first_index + cluster->index_count; i += 3) {
+        if (meshlet_triangle_normal(m, part, i, normal)) {
+            axis[0] += normal[0];
+            axis[1] += normal[1];
+            axis[2] += normal[2];
+        }
+    }
+
+    float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float min_dot = length > 0.0f ? 1.0f : -1.0f;
+    for (uint32_t k = 0; k < 3; ++k) {
+        cluster->cone_axis[k] = length > 0.0f ? axis[k] / length : 0.0f;
+    }
+    for (uint32_t i = cluster->first_index; length > 0.0f && i + 3 <= cluster->first_index + cluster->index_count; i += 3) {
+        if (meshlet_triangle_normal(m, part, i, normal)) {
+            min_dot = MIN(min_dot, normal[0] * cluster->cone_axis[0] + normal[1] * cluster->cone_axis[1] + normal[2] * cluster->cone_axis[2]);
+        }
+    }
+
+    // normals spread over a half space or more can not all face away at once
+    cluster->cone_cutoff = min_dot <= 0.0f ? 1.0f : sqrtf(1.0f - min_dot * min_dot);
+}
+
+bool mesh_build_meshlets(mesh *m) {
+    if (!m->vertices || (!m->indices && !m->short_indices)) {
+        return false;
+    }
+
+    // a meshlet holds at least one triangle, so there are never more meshlets than triangles
+    uint32_t *stamps = malloc(MAX(m->vertex_count, 1) * sizeof(uint32_t));
+    meshlet *meshlets = malloc(MAX(m->index_count / 3 + m->submesh_count, 1) * sizeof(meshlet));
+    if (!stamps || !meshlets) {
+        LOG("Allocate meshlet buffers failed!\n");
+        free(stamps);
+        free(meshlets);
+        return false;
+    }
+    memset(stamps, 0xff, MAX(m->vertex_count, 1) * sizeof(uint32_t));
+
+    uint32_t meshlet_count = 0;
+    for (uint32_t i = 0; i < m->submesh_count; ++i) {
+        submesh *part = m->submeshes + i;
+        part->first_meshlet = meshlet_count;
+
+        meshlet *cluster = NULL;
+        uint32_t cluster_vertex_count = 0;
+        for (uint32_t j = part->first_index; j + 3 <= part->first_index + part->index_count; j += 3) {
+            uint32_t triangle[3];
+            uint32_t added = 0;
+            for (uint32_t k = 0; k < 3; ++k) {
+                triangle[k] = part->vertex_offset + read_index(m, j + k);
+                added += !cluster || stamps[triangle[k]] != meshlet_count - 1;
+            }
+
+            if (!cluster || cluster->index_count == 3 * MESHLET_MAX_TRIANGLES || cluster_vertex_count + added > MESHLET_MAX_VERTICES) {
+                cluster = meshlets + meshlet_count ++;
+                memset(cluster, 0, sizeof(meshlet));
+                cluster->first_index = j;
+                cluster_vertex_count = 0;
+            }
+
+            for (uint32_t k = 0; k < 3; ++k) {
+                if (stamps[triangle[k]] != meshlet_count - 1) {
+                    stamps[triangle[k]] = meshlet_count - 1;
+                    ++ cluster_vertex_count;
+                }
+            }
+            cluster->index_count += 3;
+        }
+
+        part->meshlet_count = meshlet_count - part->first_meshlet;
+        for (uint32_t j = part->first_meshlet; j < meshlet_count; ++j) {
+            compute_meshlet_bounds(m, part, meshlets + j);
+        }
+    }
+
+    meshlet *shrunk = realloc(meshlets, MAX(meshlet_count, 1) * sizeof(meshlet));
+    free(m->meshlets);
+    m->meshlets = shrunk ? shrunk : meshlets;
+    m->meshlet_count = meshlet_count;
+
+    free(stamps);
+    return true;
+}
+
+bool meshlet_is_visible(const meshlet *cluster, vec4 planes[6], const float *eye) {
+    for (uint32_t i = 0; i < 6; ++i) {
+        if (glm_vec_dot(planes[i], (float *)cluster->center) + planes[i][3] < -cluster->radius) {
+            return false;
+        }
+    }
+
+    float view[3] = {
+        cluster->center[0] - eye[0],
+        cluster->center[1] - eye[1],
+        cluster->center[2] - eye[2]
+    };
+    float distance = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+    float along_axis = view[0] * cluster->cone_axis[0] + view[1] * cluster->cone_axis[1] + view[2] * cluster->cone_axis[2];
+    return along_axis < cluster->cone_cutoff * distance + cluster->radius;
+}
@@ -0,0 +1,22 @@
+#ifndef VK_EXAMPLE_MESH_CLUSTER_H
+#define VK_EXAMPLE_MESH_CLUSTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cglm/cglm.h"
+#include "mesh.h"
+
+// limits of one meshlet, the ones mesh shading hardware prefers so the same clusters can feed it later
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// cut the triangles of every submesh into meshlets in their current order, so cache and overdraw ordering survive,
+// needs float vertices, indices may be short, run it after the last pass that moves triangles
+extern bool mesh_build_meshlets(mesh *m);
+
+// false if the meshlet lies outside one of the frustum planes or all its triangles face away from eye,
+// planes and eye are in the space of the mesh
+extern bool meshlet_is_visible(const meshlet *cluster, vec4 planes[6], const float *eye);
+
+#endif //VK_EXAMPLE_MESH_CLUSTER_H
@@ -0,0 +1,366 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "mesh_file.h"
+
+static const uint64_t CHECKSUM_SEED = 0x6d657368ull;
+
+typedef struct chunk_source {
+    uint32_t type;
+    uint32_t mesh_index;
+    const void *data;
+    uint64_t size;
+} chunk_source;
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t chunk_table_offset(void) {
+    return align_up(sizeof(mesh_file_header), MESH_FILE_ALIGNMENT);
+}
+
+static bool write_padding(FILE *file, uint64_t *offset, uint64_t alignment) {
+    static const char zeros[MESH_FILE_ALIGNMENT] = {0};
+    uint64_t padding = align_up(*offset, alignment) - *offset;
+    *offset += padding;
+    return padding == 0 || fwrite(zeros, 1, (size_t)padding, file) == padding;
+}
+
+bool mesh_file_write(const char *file_name, uint64_t source_hash, const mesh *meshes, uint32_t mesh_count) {
+    uint32_t chunk_count = 0;
+    for (uint32_t i = 0; i < mesh_count; ++i) {
+        chunk_count += 4 + (meshes[i].lod_count ? 1 : 0) + (meshes[i].meshlet_count ? 1 : 0);
+    }
+
+    chunk_source *sources = malloc(MAX(chunk_count, 1) * sizeof(chunk_source));
+    mesh_file_info *infos = calloc(MAX(mesh_count, 1), sizeof(mesh_file_info));
+    mesh_file_chunk *chunks = calloc(MAX(chunk_count, 1), sizeof(mesh_file_chunk));
+    FILE *file = NULL;
+
+    bool ret = false;
+    do {
+        if (!sources || !infos || !chunks) {
+            LOG("Allocate mesh file chunk table failed!\n");
+            break;
+        }
+
+        uint32_t next_chunk = 0;
+        for (uint32_t i = 0; i < mesh_count; ++i) {
+            const mesh *m = meshes + i;
+            const vertex_layout *layout = mesh_get_vertex_layout(m);
+            const void *vertices = m->packed_vertices ? (const void *)m->packed_vertices : (const void *)m->vertices;
+            const void *indices = m->short_indices ? (const void *)m->short_indices : (const void *)m->indices;
+            infos[i].vertex_count = m->vertex_count;
+            infos[i].index_count = m->index_count;
+            infos[i].submesh_count = m->submesh_count;
+            infos[i].lod_count = m->lod_count;
+            infos[i].index_size = mesh_get_index_size(m);
+            infos[i].meshlet_count = m->meshlet_count;
+            infos[i].bounds = m->bounds;
+            infos[i].layout = *layout;
+
+            sources[next_chunk ++] = (chunk_source){MESH_CHUNK_INFO, i, infos + i, sizeof(mesh_file_info)};
+            sources[next_chunk ++] = (chunk_source){MESH_CHUNK_VERTICES, i, vertices, (uint64_t)m->vertex_count * layout->stride};
+            sources[next_chunk ++] = (chunk_source){MESH_CHUNK_INDICES, i, indices, (uint64_t)m->index_count * infos[i].index_size};
+            sources[next_chunk ++] = (chunk_source){MESH_CHUNK_SUBMESHES, i, m->submeshes, (uint64_t)m->submesh_count * sizeof(submesh)};
+            if (m->lod_count) {
+                sources[next_chunk ++] = (chunk_source){MESH_CHUNK_LODS, i, m->lods, (uint64_t)m->lod_count * sizeof(mesh_lod)};
+            }
+            if (m->meshlet_count) {
+                sources[next_chunk ++] = (chunk_source){MESH_CHUNK_MESHLETS, i, m->meshlets, (uint64_t)m->meshlet_count * sizeof(meshlet)};
+            }
+        }
+
+        file = fopen(file_name, "wb");
+        if (!file) {
+            LOG("Open mesh file %s for write failed!\n", file_name);
+            break;
+        }
+
+        // header and chunk table are written last, once offsets and checksums are known
+        uint64_t offset = chunk_table_offset() + chunk_count * sizeof(mesh_file_chunk);
+        // long is 32 bit on windows, offsets past 2gb need the 64 bit seek
+        if (_fseeki64(file, (__int64)offset, SEEK_SET) != 0) {
+            break;
+        }
+
+        bool written = true;
+        for (uint32_t i = 0; i < chunk_count && written; ++i) {
+            written = write_padding(file, &offset, MESH_FILE_ALIGNMENT);
+
+            chunks[i].type = sources[i].type;
+            chunks[i].mesh_index = sources[i].mesh_index;
+            chunks[i].offset = offset;
+            chunks[i].size = sources[i].size;
+            chunks[i].checksum = hash_bytes(sources[i].data, (size_t)sources[i].size, CHECKSUM_SEED);
+
+            written = written && (sources[i].size == 0 || fwrite(sources[i].data, 1, (size_t)sources[i].size, file) == sources[i].size);
+            offset += sources[i].size;
+        }
+        if (!written) {
+            LOG("Write mesh file chunks failed!\n");
+            break;
+        }
+
+        mesh_file_header header = {
+            .magic = MESH_FILE_MAGIC,
+            .version = MESH_FILE_VERSION,
+            .alignment = MESH_FILE_ALIGNMENT,
+            .mesh_count = mesh_count,
+            .chunk_count = chunk_count,
+            .reserved = 0,
+            .file_size = offset,
+            .source_hash = source_hash,
+            .checksum = hash_bytes(chunks, chunk_count * sizeof(mesh_file_chunk), CHECKSUM_SEED)
+        };
+
+        uint64_t header_end = sizeof(header);
+        written = _fseeki64(file, 0, SEEK_SET) == 0
+            && fwrite(&header, sizeof(header), 1, file) == 1
+            && write_padding(file, &header_end, MESH_FILE_ALIGNMENT)
+            && (chunk_count == 0 || fwrite(chunks, sizeof(mesh_file_chunk), chunk_count, file) == chunk_count);
+        if (!written) {
+            LOG("Write mesh file header failed!\n");
+            break;
+        }
+
+        ret = true;
+    } while (false);
+
+    if (file) {
+        fclose(file);
+        if (!ret) {
+            remove(file_name);
+        }
+    }
+    free(sources);
+    free(infos);
+    free(chunks);
+
+    return ret;
+}
+
+bool mesh_file_open(const char *file_name, mesh_file *out) {
+    memset(out, 0, sizeof(mesh_file));
+
+    mapped_file file;
+    if (!map_file(file_name, &file)) {
+        return false;
+    }
+
+    bool ret = false;
+    do {
+        const mesh_file_header *header = file.data;
+        if (file.size < chunk_table_offset()
+            || header->magic != MESH_FILE_MAGIC
+            || header->version != MESH_FILE_VERSION
+            || header->alignment != MESH_FILE_ALIGNMENT
+            || header->file_size != file.size) {
+            LOG("Mesh file %s has an unknown version!\n", file_name);
+            break;
+        }
+
+        uint64_t table_size = (uint64_t)header->chunk_count * sizeof(mesh_file_chunk);
+        if (table_size > file.size - chunk_table_offset()) {
+            LOG("Mesh file %s chunk table is truncated!\n", file_name);
+            break;
+        }
+
+        const mesh_file_chunk *chunks = (const mesh_file_chunk *)((const char *)file.data + chunk_table_offset());
+        if (header->checksum != hash_bytes(chunks, (size_t)table_size, CHECKSUM_SEED)) {
+            LOG("Mesh file %s chunk table is corrupted!\n", file_name);
+            break;
+        }
+
+        bool valid = true;
+        for (uint32_t i = 0; i < header->chunk_count && valid; ++i) {
+            const mesh_file_chunk *chunk = chunks + i;
+            valid = chunk->offset % MESH_FILE_ALIGNMENT == 0
+                && chunk->offset <= file.size
+                && chunk->size <= file.size - chunk->offset
+                && chunk->checksum == hash_bytes((const char *)file.data + chunk->offset, (size_t)chunk->size, CHECKSUM_SEED);
+        }
+        if (!valid) {
+            LOG("Mesh file %s has a corrupted chunk!\n", file_name);
+            break;
+        }
+
+        out->file = file;
+        out->header = header;
+        out->chunks = chunks;
+        ret = true;
+    } while (false);
+
+    if (!ret) {
+        unmap_file(&file);
+    }
+    return ret;
+}
+
+void mesh_file_close(mesh_file *file) {
+    unmap_file(&(file->file));
+    file->header = NULL;
+    file->chunks = NULL;
+}
+
+static const void * find_chunk(const mesh_file *file, uint32_t type, uint32_t mesh_index, uint64_t *size) {
+    for (uint32_t i = 0; i < file->header->chunk_count; ++i) {
+        const mesh_file_chunk *chunk = file->chunks + i;
+        if (chunk->type == type && chunk->mesh_index == mesh_index) {
+            *size = chunk->size;
+            return (const char *)file->file.data + chunk->offset;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t max_index(const void *indices, uint32_t index_size, uint32_t first, uint32_t count) {
+    uint32_t ret = 0;
+    if (index_size == sizeof(uint16_t)) {
+        const uint16_t *short_indices = (const uint16_t *)indices + first;
+        for (uint32_t i = 0; i < count; ++i) {
+            ret = MAX(ret, short_indices[i]);
+        }
+    } else {
+        const uint32_t *long_indices = (const uint32_t *)indices + first;
+        for (uint32_t i = 0; i < count; ++i) {
+            ret = MAX(ret, long_indices[i]);
+        }
+    }
+    return ret;
+}
+
+bool mesh_file_get_mesh(const mesh_file *file, uint32_t index, mesh *out) {
+    memset(out, 0, sizeof(mesh));
+    if (!file->header || index >= file->header->mesh_count) {
+        return false;
+    }
+
+    uint64_t info_size = 0;
+    uint64_t vertices_size = 0;
+    uint64_t indices_size = 0;
+    uint64_t submeshes_size = 0;
+    uint64_t lods_size = 0;
+    uint64_t meshlets_size = 0;
+    const mesh_file_info *info = find_chunk(file, MESH_CHUNK_INFO, index, &info_size);
+    const void *vertices = find_chunk(file, MESH_CHUNK_VERTICES, index, &vertices_size);
+    const void *indices = find_chunk(file, MESH_CHUNK_INDICES, index, &indices_size);
+    const submesh *submeshes = find_chunk(file, MESH_CHUNK_SUBMESHES, index, &submeshes_size);
+    const mesh_lod *lods = find_chunk(file, MESH_CHUNK_LODS, index, &lods_size);
+    const meshlet *meshlets = find_chunk(file, MESH_CHUNK_MESHLETS, index, &meshlets_size);
+
+    if (!info || info_size != sizeof(mesh_file_info) || !vertices || !indices || !submeshes) {
+        LOG("Mesh %d misses a chunk!\n", index);
+        return false;
+    }
+
+    bool packed = memcmp(&(info->layout), &mesh_packed_vertex_layout, sizeof(vertex_layout)) == 0;
+    if (!packed && memcmp(&(info->layout), &mesh_vertex_layout, sizeof(vertex_layout)) != 0) {
+        LOG("Mesh %d vertex layout differs from this build!\n", index);
+        return false;
+    }
+
+    if (info->index_size != sizeof(uint16_t) && info->index_size != sizeof(uint32_t)) {
+        LOG("Mesh %d has an unknown index size!\n", index);
+        return false;
+    }
+
+    if (vertices_size != (uint64_t)info->vertex_count * info->layout.stride
+        || indices_size != (uint64_t)info->index_count * info->index_size
+        || submeshes_size != (uint64_t)info->submesh_count * sizeof(submesh)
+        || lods_size != (lods ? (uint64_t)info->lod_count * sizeof(mesh_lod) : 0)
+        || meshlets_size != (meshlets ? (uint64_t)info->meshlet_count * sizeof(meshlet) : 0)) {
+        LOG("Mesh %d chunk sizes do not match its counts!\n", index);
+        return false;
+    }
+
+    uint32_t meshlet_count = meshlets ? info->meshlet_count : 0;
+    for (uint32_t i = 0; i < info->submesh_count; ++i) {
+        const submesh *part = submeshes + i;
+        if ((uint64_t)part->first_index + part->index_count > info->index_count
+            || (uint64_t)part->first_meshlet + part->meshlet_count > meshlet_count
+            || part->vertex_offset < 0
+            || (uint64_t)part->vertex_offset + part->vertex_count > info->vertex_count) {
+            LOG("Mesh %d submesh %d is out of range!\n", index, i);
+            return false;
+        }
+
+        // the checksums only catch corruption, a consistently written bad index would still be drawn
+        if (part->index_count && max_index(indices, info->index_size, part->first_index, part->index_count) >= part->vertex_count) {
+            LOG("Mesh %d submesh %d indexes past its vertices!\n", index, i);
+            return false;
+        }
+
+        // meshlets are drawn with the vertex offset of their submesh, so they stay within its indices
+        for (uint32_t j = part->first_meshlet; j < part->first_meshlet + part->meshlet_count; ++j) {
+            if (meshlets[j].first_index < part->first_index
+                || (uint64_t)meshlets[j].first_index + meshlets[j].index_count > (uint64_t)part->first_index + part->index_count) {
+                LOG("Mesh %d meshlet %d is outside submesh %d!\n", index, j, i);
+                return false;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < meshlet_count; ++i) {
+        if ((uint64_t)meshlets[i].first_index + meshlets[i].index_count > info->index_count) {
+            LOG("Mesh %d meshlet %d is out of range!\n", index, i);
+            return false;
+        }
+    }
+
+    // an empty lod chunk is read as none, the whole mesh is its only level
+    if (!info->lod_count) {
+        lods = NULL;
+    }
+    for (uint32_t i = 0; lods && i < info->lod_count; ++i) {
+        if ((uint64_t)lods[i].first_submesh + lods[i].submesh_count > info->submesh_count) {
+            LOG("Mesh %d lod %d is out of range!\n", index, i);
+            return false;
+        }
+    }
+
+    // the small tables are copied so they outlive the mapping
+    uint32_t lod_count = lods ? info->lod_count : 1;
+    out->submeshes = malloc(MAX(info->submesh_count, 1) * sizeof(submesh));
+    out->lods = malloc(MAX(lod_count, 1) * sizeof(mesh_lod));
+    out->meshlets = malloc(MAX(meshlet_count, 1) * sizeof(meshlet));
+    if (!out->submeshes || !out->lods || !out->meshlets) {
+        mesh_free(out);
+        return false;
+    }
+
+    memcpy(out->submeshes, submeshes, (size_t)submeshes_size);
+    if (meshlets) {
+        memcpy(out->meshlets, meshlets, (size_t)meshlets_size);
+    }
+    if (lods) {
+        memcpy(out->lods, lods, (size_t)lods_size);
+    } else {
+        out->lods[0] = (mesh_lod){.first_submesh = 0, .submesh_count = info->submesh_count, .error = 0.0f};
+    }
+
+    if (packed) {
+        out->packed_vertices = (packed_vertex *)vertices;
+    } else {
+        out->vertices = (vertex *)vertices;
+    }
+    out->vertex_count = info->vertex_count;
+    if (info->index_size == sizeof(uint16_t)) {
+        out->short_indices = (uint16_t *)indices;
+    } else {
+        out->indices = (uint32_t *)indices;
+    }
+    out->index_count = info->index_count;
+    out->submesh_count = info->submesh_count;
+    out->lod_count = lod_count;
+    out->meshlet_count = meshlet_count;
+    out->bounds = info->bounds;
+    out->borrowed = true;
+
+    return true;
+}
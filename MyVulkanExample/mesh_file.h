@@ -0,0 +1,79 @@
+#ifndef VK_EXAMPLE_MESH_FILE_H
+#define VK_EXAMPLE_MESH_FILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "example.h"
+#include "mesh.h"
+
+#define MESH_FILE_FOURCC(a, b, c, d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define MESH_FILE_MAGIC MESH_FILE_FOURCC('M', 'E', 'S', 'H')
+// bump whenever a chunk or record layout changes, older files are rebuilt
+#define MESH_FILE_VERSION 3
+// header, chunk table and every chunk start on this boundary
+#define MESH_FILE_ALIGNMENT 64
+
+typedef enum mesh_chunk_type {
+    MESH_CHUNK_INFO = MESH_FILE_FOURCC('I', 'N', 'F', 'O'),
+    MESH_CHUNK_VERTICES = MESH_FILE_FOURCC('V', 'E', 'R', 'T'),
+    MESH_CHUNK_INDICES = MESH_FILE_FOURCC('I', 'N', 'D', 'X'),
+    MESH_CHUNK_SUBMESHES = MESH_FILE_FOURCC('S', 'U', 'B', 'M'),
+    // optional, a mesh without it has a single level holding every submesh
+    MESH_CHUNK_LODS = MESH_FILE_FOURCC('L', 'O', 'D', 'S'),
+    // optional, a mesh without it draws whole submeshes
+    MESH_CHUNK_MESHLETS = MESH_FILE_FOURCC('M', 'S', 'L', 'T')
+} mesh_chunk_type;
+
+typedef struct mesh_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t alignment;
+    uint32_t mesh_count;
+    uint32_t chunk_count;
+    uint32_t reserved;
+    uint64_t file_size;
+    // hash of the source content the file was built from
+    uint64_t source_hash;
+    // hash of the chunk table, which holds the hash of every chunk
+    uint64_t checksum;
+} mesh_file_header;
+
+typedef struct mesh_file_chunk {
+    uint32_t type;
+    uint32_t mesh_index;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+} mesh_file_chunk;
+
+typedef struct mesh_file_info {
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t submesh_count;
+    uint32_t lod_count;
+    uint32_t index_size; // 2 or 4 bytes
+    uint32_t meshlet_count;
+    mesh_bounds bounds;
+    vertex_layout layout;
+} mesh_file_info;
+
+typedef struct mesh_file {
+    mapped_file file;
+    const mesh_file_header *header;
+    const mesh_file_chunk *chunks;
+} mesh_file;
+
+extern bool mesh_file_write(const char *file_name, uint64_t source_hash, const mesh *meshes, uint32_t mesh_count);
+
+// map the file and validate its header, chunk table and chunk checksums
+extern bool mesh_file_open(const char *file_name, mesh_file *out);
+
+extern void mesh_file_close(mesh_file *file);
+
+// fails if the stored vertex layout is neither of the two this build uses,
+// vertices and indices are borrowed from the mapping and must be released before the file is closed
+extern bool mesh_file_get_mesh(const mesh_file *file, uint32_t index, mesh *out);
+
+#endif //VK_EXAMPLE_MESH_FILE_H
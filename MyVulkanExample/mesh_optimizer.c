@@ -0,0 +1,511 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "example.h"
+#include "mesh_optimizer.h"
+
+// forsyth, linear-speed vertex cache optimisation, with the constants from the paper
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 32
+static const float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+static const int32_t NOT_IN_CACHE = -1;
+
+typedef struct forsyth_tables {
+    float cache_score[FORSYTH_CACHE_SIZE];
+    float valence_score[FORSYTH_MAX_VALENCE];
+} forsyth_tables;
+
+static void forsyth_init_tables(forsyth_tables *tables) {
+    for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+        if (i < 3) {
+            // the last triangle's vertices are penalised so strips do not ping-pong
+            tables->cache_score[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            tables->cache_score[i] = powf(1.0f - (i - 3) * scaler, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+
+    tables->valence_score[0] = 0.0f;
+    for (uint32_t i = 1; i < FORSYTH_MAX_VALENCE; ++i) {
+        tables->valence_score[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+}
+
+static float forsyth_vertex_score(const forsyth_tables *tables, int32_t cache_position, uint32_t live_triangles) {
+    if (live_triangles == 0) {
+        return -1.0f;
+    }
+
+    float score = cache_position == NOT_IN_CACHE ? 0.0f : tables->cache_score[cache_position];
+    if (live_triangles < FORSYTH_MAX_VALENCE) {
+        score += tables->valence_score[live_triangles];
+    } else {
+        score += FORSYTH_VALENCE_BOOST_SCALE * powf((float)live_triangles, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+    return score;
+}
+
+// reorder the triangles of one index range in place, index values are below vertex_count
+static bool forsyth_optimize(const forsyth_tables *tables, uint32_t *indices, uint32_t index_count, uint32_t vertex_count) {
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return true;
+    }
+
+    uint32_t *live_triangles = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t *adjacency_offsets = malloc((vertex_count + 1) * sizeof(uint32_t));
+    uint32_t *adjacency = malloc(index_count * sizeof(uint32_t));
+    int32_t *cache_positions = malloc(vertex_count * sizeof(int32_t));
+    float *vertex_scores = malloc(vertex_count * sizeof(float));
+    float *triangle_scores = malloc(triangle_count * sizeof(float));
+    bool *emitted = calloc(triangle_count, sizeof(bool));
+    uint32_t *result = malloc(index_count * sizeof(uint32_t));
+
+    bool ret = live_triangles && adjacency_offsets && adjacency && cache_positions && vertex_scores && triangle_scores && emitted && result;
+    if (ret) {
+        // per vertex list of the triangles still to be emitted, packed
+        for (uint32_t i = 0; i < index_count; ++i) {
+            ++ live_triangles[indices[i]];
+        }
+        adjacency_offsets[0] = 0;
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            adjacency_offsets[i + 1] = adjacency_offsets[i] + live_triangles[i];
+            live_triangles[i] = 0;
+        }
+        for (uint32_t i = 0; i < index_count; ++i) {
+            uint32_t v = indices[i];
+            adjacency[adjacency_offsets[v] + live_triangles[v] ++] = i / 3;
+        }
+
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            cache_positions[i] = NOT_IN_CACHE;
+            vertex_scores[i] = forsyth_vertex_score(tables, NOT_IN_CACHE, live_triangles[i]);
+        }
+
+        uint32_t best_triangle = 0;
+        for (uint32_t i = 0; i < triangle_count; ++i) {
+            triangle_scores[i] = vertex_scores[indices[3 * i]] + vertex_scores[indices[3 * i + 1]] + vertex_scores[indices[3 * i + 2]];
+            if (triangle_scores[i] > triangle_scores[best_triangle]) {
+                best_triangle = i;
+            }
+        }
+
+        // three extra slots hold the vertices pushed out by the newest triangle
+        uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t cache_count = 0;
+        uint32_t next_unemitted = 0;
+
+        for (uint32_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+            if (best_triangle == UINT32_MAX) {
+                // nothing in the cache touches a live triangle, restart from the first one left
+                while (emitted[next_unemitted]) {
+                    ++ next_unemitted;
+                }
+                best_triangle = next_unemitted;
+            }
+
+            const uint32_t *corners = indices + 3 * best_triangle;
+            memcpy(result + 3 * emitted_count, corners, 3 * sizeof(uint32_t));
+            emitted[best_triangle] = true;
+
+            for (uint32_t i = 0; i < 3; ++i) {
+                uint32_t v = corners[i];
+                uint32_t *triangles = adjacency + adjacency_offsets[v];
+                for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+                    if (triangles[j] == best_triangle) {
+                        triangles[j] = triangles[live_triangles[v] - 1];
+                        break;
+                    }
+                }
+                -- live_triangles[v];
+            }
+
+            // move the triangle's vertices to the front, keep the rest in lru order
+            uint32_t new_cache[FORSYTH_CACHE_SIZE + 3];
+            uint32_t new_cache_count = 0;
+            for (uint32_t i = 0; i < 3; ++i) {
+                uint32_t v = corners[i];
+                if (new_cache_count == 0 || (new_cache[0] != v && (new_cache_count < 2 || new_cache[1] != v))) {
+                    new_cache[new_cache_count ++] = v;
+                }
+            }
+            for (uint32_t i = 0; i < cache_count; ++i) {
+                uint32_t v = cache[i];
+                if (v != corners[0] && v != corners[1] && v != corners[2]) {
+                    new_cache[new_cache_count ++] = v;
+                }
+            }
+
+            for (uint32_t i = 0; i < new_cache_count; ++i) {
+                uint32_t v = new_cache[i];
+                cache_positions[v] = i < FORSYTH_CACHE_SIZE ? (int32_t)i : NOT_IN_CACHE;
+
+                float score = forsyth_vertex_score(tables, cache_positions[v], live_triangles[v]);
+                float delta = score - vertex_scores[v];
+                vertex_scores[v] = score;
+
+                const uint32_t *triangles = adjacency + adjacency_offsets[v];
+                for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+                    triangle_scores[triangles[j]] += delta;
+                }
+            }
+
+            // only triangles touching the cache changed, the next best one is among them
+            best_triangle = UINT32_MAX;
+            float best_score = -1.0f;
+            for (uint32_t i = 0; i < new_cache_count; ++i) {
+                uint32_t v = new_cache[i];
+                const uint32_t *triangles = adjacency + adjacency_offsets[v];
+                for (uint32_t j = 0; j < live_triangles[v]; ++j) {
+                    if (triangle_scores[triangles[j]] > best_score) {
+                        best_score = triangle_scores[triangles[j]];
+                        best_triangle = triangles[j];
+                    }
+                }
+            }
+
+            cache_count = MIN(new_cache_count, FORSYTH_CACHE_SIZE);
+            memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+        }
+
+        memcpy(indices, result, index_count * sizeof(uint32_t));
+    } else {
+        LOG("Allocate vertex cache optimizer buffers failed!\n");
+    }
+
+    free(live_triangles);
+    free(adjacency_offsets);
+    free(adjacency);
+    free(cache_positions);
+    free(vertex_scores);
+    free(triangle_scores);
+    free(emitted);
+    free(result);
+
+    return ret;
+}
+
+bool mesh_optimize_vertex_cache(mesh *m) {
+    // the passes work on 32 bit indices, meshes get short indices after optimizing
+    if (!m->indices) {
+        return false;
+    }
+
+    forsyth_tables tables;
+    forsyth_init_tables(&tables);
+
+    for (uint32_t i = 0; i < m->submesh_count; ++i) {
+        submesh *part = m->submeshes + i;
+        uint32_t vertex_count = m->vertex_count - part->vertex_offset;
+        if (!forsyth_optimize(&tables, m->indices + part->first_index, part->index_count, vertex_count)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+typedef struct overdraw_cluster {
+    uint32_t first_triangle;
+    uint32_t triangle_count;
+    float sort_key;
+} overdraw_cluster;
+
+// returns the number of vertices of triangle that missed a fifo of cache_size entries
+static uint32_t fifo_triangle_misses(const uint32_t *triangle, uint32_t *cache_stamps, uint32_t *misses, uint32_t cache_size) {
+    uint32_t triangle_misses = 0;
+    for (uint32_t i = 0; i < 3; ++i) {
+        uint32_t v = triangle[i];
+        if (*misses - cache_stamps[v] >= cache_size) {
+            cache_stamps[v] = (*misses) ++;
+            ++ triangle_misses;
+        }
+    }
+    return triangle_misses;
+}
+
+static int compare_overdraw_clusters(const void *a, const void *b) {
+    float key_a = ((const overdraw_cluster *)a)->sort_key;
+    float key_b = ((const overdraw_cluster *)b)->sort_key;
+    return key_a > key_b ? -1 : (key_a < key_b ? 1 : 0);
+}
+
+static bool overdraw_optimize(const vertex *vertices, uint32_t *indices, uint32_t index_count, uint32_t vertex_count, float threshold) {
+    uint32_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return true;
+    }
+
+    uint32_t *cache_stamps = calloc(vertex_count, sizeof(uint32_t));
+    overdraw_cluster *clusters = malloc(triangle_count * sizeof(overdraw_cluster));
+    uint32_t *hard_starts = malloc((triangle_count + 1) * sizeof(uint32_t));
+    uint32_t *result = malloc(index_count * sizeof(uint32_t));
+    if (!cache_stamps || !clusters || !hard_starts || !result) {
+        LOG("Allocate overdraw optimizer buffers failed!\n");
+        free(cache_stamps);
+        free(clusters);
+        free(hard_starts);
+        free(result);
+        return false;
+    }
+
+    // hard boundaries, a triangle missing all its vertices starts a new strip of the cache order
+    uint32_t cache_size = VERTEX_CACHE_REPORT_SIZE;
+    uint32_t misses = cache_size;
+    uint32_t hard_count = 0;
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        if (fifo_triangle_misses(indices + 3 * i, cache_stamps, &misses, cache_size) == 3 || i == 0) {
+            hard_starts[hard_count ++] = i;
+        }
+    }
+    hard_starts[hard_count] = triangle_count;
+
+    // soft boundaries, a strip is cut again as soon as its prefix is about as cache friendly as the whole strip
+    uint32_t cluster_count = 0;
+    for (uint32_t i = 0; i < hard_count; ++i) {
+        uint32_t start = hard_starts[i];
+        uint32_t end = hard_starts[i + 1];
+
+        misses += cache_size;
+        uint32_t strip_misses = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            strip_misses += fifo_triangle_misses(indices + 3 * t, cache_stamps, &misses, cache_size);
+        }
+        float strip_threshold = threshold * (float)strip_misses / (float)(end - start);
+
+        misses += cache_size;
+        uint32_t cluster_start = start;
+        uint32_t cluster_misses = 0;
+        for (uint32_t t = start; t < end; ++t) {
+            cluster_misses += fifo_triangle_misses(indices + 3 * t, cache_stamps, &misses, cache_size);
+            if (t + 1 == end || (float)cluster_misses / (float)(t + 1 - cluster_start) <= strip_threshold) {
+                clusters[cluster_count ++] = (overdraw_cluster){cluster_start, t + 1 - cluster_start, 0.0f};
+                cluster_start = t + 1;
+                cluster_misses = 0;
+                misses += cache_size;
+            }
+        }
+    }
+
+    // sort key is how far the cluster sits along its own normal from the center of the range,
+    // clusters on the outside facing away from the center are drawn first and occlude the rest
+    float (*centroids)[3] = malloc(cluster_count * sizeof(float[3]));
+    float (*normals)[3] = malloc(cluster_count * sizeof(float[3]));
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float total_area = 0.0f;
+    bool ret = centroids && normals;
+    for (uint32_t i = 0; ret && i < cluster_count; ++i) {
+        float centroid[3] = {0.0f, 0.0f, 0.0f};
+        float normal[3] = {0.0f, 0.0f, 0.0f};
+        float cluster_area = 0.0f;
+        for (uint32_t t = clusters[i].first_triangle; t < clusters[i].first_triangle + clusters[i].triangle_count; ++t) {
+            const float *p0 = vertices[indices[3 * t]].position;
+            const float *p1 = vertices[indices[3 * t + 1]].position;
+            const float *p2 = vertices[indices[3 * t + 2]].position;
+            float e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float n[3] = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (uint32_t k = 0; k < 3; ++k) {
+                centroid[k] += area * (p0[k] + p1[k] + p2[k]) / 3.0f;
+                normal[k] += n[k];
+            }
+            cluster_area += area;
+        }
+
+        for (uint32_t k = 0; k < 3; ++k) {
+            center[k] += centroid[k];
+            centroids[i][k] = cluster_area > 0.0f ? centroid[k] / cluster_area : 0.0f;
+        }
+        total_area += cluster_area;
+
+        float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (uint32_t k = 0; k < 3; ++k) {
+            normals[i][k] = length > 0.0f ? normal[k] / length : 0.0f;
+        }
+    }
+
+    if (ret) {
+        for (uint32_t k = 0; k < 3; ++k) {
+            center[k] = total_area > 0.0f ? center[k] / total_area : 0.0f;
+        }
+
+        for (uint32_t i = 0; i < cluster_count; ++i) {
+            clusters[i].sort_key = (centroids[i][0] - center[0]) * normals[i][0]
+                + (centroids[i][1] - center[1]) * normals[i][1]
+                + (centroids[i][2] - center[2]) * normals[i][2];
+        }
+
+        qsort(clusters, cluster_count, sizeof(overdraw_cluster), compare_overdraw_clusters);
+
+        uint32_t next_index = 0;
+        for (uint32_t i = 0; i < cluster_count; ++i) {
+            uint32_t count = 3 * clusters[i].triangle_count;
+            memcpy(result + next_index, indices + 3 * clusters[i].first_triangle, count * sizeof(uint32_t));
+            next_index += count;
+        }
+        memcpy(indices, result, index_count * sizeof(uint32_t));
+    } else {
+        LOG("Allocate overdraw optimizer buffers failed!\n");
+    }
+
+    free(cache_stamps);
+    free(clusters);
+    free(hard_starts);
+    free(result);
+    free(centroids);
+    free(normals);
+
+    return ret;
+}
+
+bool mesh_optimize_overdraw(mesh *m, float threshold) {
+    // cluster normals need float positions, meshes are packed after optimizing
+    if (!m->vertices || !m->indices) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < m->submesh_count; ++i) {
+        submesh *part = m->submeshes + i;
+        uint32_t vertex_count = m->vertex_count - part->vertex_offset;
+        if (!overdraw_optimize(m->vertices + part->vertex_offset, m->indices + part->first_index, part->index_count, vertex_count, threshold)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool mesh_optimize_vertex_fetch(mesh *m) {
+    if (!m->vertices || !m->indices) {
+        return false;
+    }
+
+    uint32_t *remap = malloc(MAX(m->vertex_count, 1) * sizeof(uint32_t));
+    vertex *vertices = malloc(MAX(m->vertex_count, 1) * sizeof(vertex));
+    if (!remap || !vertices) {
+        LOG("Allocate vertex fetch optimizer buffers failed!\n");
+        free(remap);
+        free(vertices);
+        return false;
+    }
+    memset(remap, 0xff, m->vertex_count * sizeof(uint32_t));
+
+    bool ret = true;
+    for (uint32_t i = 0; i < m->submesh_count && ret; ++i) {
+        const submesh *part = m->submeshes + i;
+        uint32_t range_begin = part->vertex_offset;
+        uint32_t range_end = part->vertex_offset + part->vertex_count;
+
+        bool done = false;
+        for (uint32_t j = 0; j < i; ++j) {
+            const submesh *other = m->submeshes + j;
+            bool same = other->vertex_offset == part->vertex_offset && other->vertex_count == part->vertex_count;
+            bool disjoint = (uint32_t)other->vertex_offset + other->vertex_count <= range_begin || range_end <= (uint32_t)other->vertex_offset;
+            if (!same && !disjoint) {
+                LOG("Submesh %d overlaps the vertex range of submesh %d!\n", i, j);
+                ret = false;
+            }
+            done = done || same;
+        }
+        if (done || !ret) {
+            continue;
+        }
+
+        // every submesh drawing from this range, in draw order
+        uint32_t next_vertex = range_begin;
+        for (uint32_t j = i; j < m->submesh_count; ++j) {
+            const submesh *other = m->submeshes + j;
+            if (other->vertex_offset != part->vertex_offset || other->vertex_count != part->vertex_count) {
+                continue;
+            }
+            for (uint32_t k = other->first_index; k < other->first_index + other->index_count; ++k) {
+                uint32_t v = range_begin + m->indices[k];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = next_vertex ++;
+                }
+            }
+        }
+        for (uint32_t v = range_begin; v < range_end; ++v) {
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = next_vertex ++;
+            }
+        }
+    }
+
+    if (ret) {
+        // vertices outside of every range stay where they are
+        for (uint32_t v = 0; v < m->vertex_count; ++v) {
+            if (remap[v] == UINT32_MAX) {
+                remap[v] = v;
+            }
+            vertices[remap[v]] = m->vertices[v];
+        }
+        for (uint32_t i = 0; i < m->submesh_count; ++i) {
+            const submesh *part = m->submeshes + i;
+            for (uint32_t k = part->first_index; k < part->first_index + part->index_count; ++k) {
+                m->indices[k] = remap[part->vertex_offset + m->indices[k]] - part->vertex_offset;
+            }
+        }
+
+        memcpy(m->vertices, vertices, m->vertex_count * sizeof(vertex));
+    }
+
+    free(remap);
+    free(vertices);
+    return ret;
+}
+
+vertex_cache_stats mesh_analyze_vertex_cache(const mesh *m, uint32_t cache_size) {
+    vertex_cache_stats stats = {0};
+    if (!m->indices && !m->short_indices) {
+        return stats;
+    }
+
+    uint32_t *cache_stamps = calloc(MAX(m->vertex_count, 1), sizeof(uint32_t));
+    bool *referenced = calloc(MAX(m->vertex_count, 1), sizeof(bool));
+    if (!cache_stamps || !referenced) {
+        free(cache_stamps);
+        free(referenced);
+        return stats;
+    }
+
+    // a vertex is in the fifo while fewer than cache_size misses happened since it was loaded,
+    // the stamp counter never goes back so every submesh starts with a cold cache
+    uint32_t misses = cache_size;
+    uint32_t triangle_count = 0;
+    uint32_t referenced_count = 0;
+    uint32_t first_submesh = m->lods ? m->lods[0].first_submesh : 0;
+    uint32_t submesh_count = m->lods ? m->lods[0].submesh_count : m->submesh_count;
+    for (uint32_t i = first_submesh; i < first_submesh + submesh_count; ++i) {
+        const submesh *part = m->submeshes + i;
+        misses += cache_size;
+        for (uint32_t j = part->first_index; j < part->first_index + part->index_count; ++j) {
+            uint32_t v = part->vertex_offset + (m->indices ? m->indices[j] : m->short_indices[j]);
+            if (misses - cache_stamps[v] >= cache_size) {
+                cache_stamps[v] = misses ++;
+                ++ stats.transformed;
+            }
+            if (!referenced[v]) {
+                referenced[v] = true;
+                ++ referenced_count;
+            }
+        }
+        triangle_count += part->index_count / 3;
+    }
+
+    stats.acmr = triangle_count ? (float)stats.transformed / triangle_count : 0.0f;
+    stats.atvr = referenced_count ? (float)stats.transformed / referenced_count : 0.0f;
+
+    free(cache_stamps);
+    free(referenced);
+    return stats;
+}
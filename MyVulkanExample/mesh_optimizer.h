@@ -0,0 +1,32 @@
+#ifndef VK_EXAMPLE_MESH_OPTIMIZER_H
+#define VK_EXAMPLE_MESH_OPTIMIZER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mesh.h"
+
+// fifo size used for reporting, small enough to hold on any gpu we target
+#define VERTEX_CACHE_REPORT_SIZE 16
+
+typedef struct vertex_cache_stats {
+    uint32_t transformed; // vertex shader invocations with a fifo post-transform cache
+    float acmr;           // transformed per triangle, 0.5 is the ideal for a regular grid
+    float atvr;           // transformed per referenced vertex, 1.0 is the ideal
+} vertex_cache_stats;
+
+// simulate a fifo post-transform cache of cache_size entries over every submesh of lod 0
+extern vertex_cache_stats mesh_analyze_vertex_cache(const mesh *m, uint32_t cache_size);
+
+// reorder triangles inside every submesh for post-transform cache locality (forsyth), needs 32 bit indices
+extern bool mesh_optimize_vertex_cache(mesh *m);
+
+// cut the cache optimized triangles of every submesh into clusters and draw outward facing clusters first,
+// threshold bounds the acmr a cluster may lose to a cut, 1.05 allows 5%, the mesh must not be packed yet
+extern bool mesh_optimize_overdraw(mesh *m, float threshold);
+
+// store vertices in the order the indices first use them, unreferenced vertices move to the end,
+// submeshes must share the same vertex range or use disjoint ones, the mesh must not be packed yet
+extern bool mesh_optimize_vertex_fetch(mesh *m);
+
+#endif //VK_EXAMPLE_MESH_OPTIMIZER_H
@@ -0,0 +1,401 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include "example.h"
+#include "mesh_simplifier.h"
+
+static const uint64_t EDGE_EMPTY_SLOT = UINT64_MAX;
+// a level has to drop at least this share of the triangles of the one before, otherwise the chain ends
+static const float LOD_MIN_REDUCTION = 0.1f;
+
+// symmetric 4x4 plane quadric, weight is the summed triangle area so the error reads as a squared distance
+typedef struct quadric {
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    double weight;
+} quadric;
+
+typedef struct edge_collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+} edge_collapse;
+
+static void quadric_add_plane(quadric *q, const double *normal, double distance, double weight) {
+    q->a00 += weight * normal[0] * normal[0];
+    q->a01 += weight * normal[0] * normal[1];
+    q->a02 += weight * normal[0] * normal[2];
+    q->a03 += weight * normal[0] * distance;
+    q->a11 += weight * normal[1] * normal[1];
+    q->a12 += weight * normal[1] * normal[2];
+    q->a13 += weight * normal[1] * distance;
+    q->a22 += weight * normal[2] * normal[2];
+    q->a23 += weight * normal[2] * distance;
+    q->a33 += weight * distance * distance;
+    q->weight += weight;
+}
+
+static void quadric_add(quadric *q, const quadric *other) {
+    q->a00 += other->a00;
+    q->a01 += other->a01;
+    q->a02 += other->a02;
+    q->a03 += other->a03;
+    q->a11 += other->a11;
+    q->a12 += other->a12;
+    q->a13 += other->a13;
+    q->a22 += other->a22;
+    q->a23 += other->a23;
+    q->a33 += other->a33;
+    q->weight += other->weight;
+}
+
+// mean squared distance of point to the planes of q
+static double quadric_error(const quadric *q, const float *point) {
+    double x = point[0];
+    double y = point[1];
+    double z = point[2];
+    double error = q->a00 * x * x + 2.0 * q->a01 * x * y + 2.0 * q->a02 * x * z + 2.0 * q->a03 * x
+                 + q->a11 * y * y + 2.0 * q->a12 * y * z + 2.0 * q->a13 * y
+                 + q->a22 * z * z + 2.0 * q->a23 * z
+                 + q->a33;
+    return q->weight > 0.0 ? fabs(error) / q->weight : 0.0;
+}
+
+static void triangle_normal(const float *p0, const float *p1, const float *p2, double *normal) {
+    double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static uint32_t edge_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return (uint32_t)key;
+}
+
+// directed edges without a twin lie on a border or a uv seam, their vertices must not move
+static bool mark_locked_vertices(const uint32_t *indices, uint32_t index_count, bool *locked) {
+    uint32_t capacity = 1;
+    while (capacity < index_count * 2) {
+        capacity <<= 1;
+    }
+
+    uint64_t *slots = malloc(capacity * sizeof(uint64_t));
+    if (!slots) {
+        return false;
+    }
+    memset(slots, 0xff, capacity * sizeof(uint64_t));
+
+    for (uint32_t i = 0; i < index_count; ++i) {
+        uint32_t a = indices[i];
+        uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+        uint64_t key = ((uint64_t)a << 32) | b;
+        uint32_t slot = edge_hash(key) & (capacity - 1);
+        while (slots[slot] != EDGE_EMPTY_SLOT && slots[slot] != key) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = key;
+    }
+
+    for (uint32_t i = 0; i < index_count; ++i) {
+        uint32_t a = indices[i];
+        uint32_t b = indices[i % 3 == 2 ? i - 2 : i + 1];
+        uint64_t twin = ((uint64_t)b << 32) | a;
+        uint32_t slot = edge_hash(twin) & (capacity - 1);
+        while (slots[slot] != EDGE_EMPTY_SLOT && slots[slot] != twin) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (slots[slot] == EDGE_EMPTY_SLOT) {
+            locked[a] = true;
+            locked[b] = true;
+        }
+    }
+
+    free(slots);
+    return true;
+}
+
+static int compare_edge_collapses(const void *a, const void *b) {
+    double cost_a = ((const edge_collapse *)a)->cost;
+    double cost_b = ((const edge_collapse *)b)->cost;
+    return cost_a < cost_b ? -1 : (cost_a > cost_b ? 1 : 0);
+}
+
+// moving from onto to must not turn any remaining triangle of from around
+static bool collapse_flips(const vertex *vertices, const uint32_t *indices, const uint32_t *adjacency, uint32_t adjacency_count, uint32_t from, uint32_t to) {
+    for (uint32_t i = 0; i < adjacency_count; ++i) {
+        const uint32_t *triangle = indices + 3 * adjacency[i];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue;
+        }
+
+        const float *before[3];
+        const float *after[3];
+        for (uint32_t k = 0; k < 3; ++k) {
+            before[k] = vertices[triangle[k]].position;
+            after[k] = triangle[k] == from ? vertices[to].position : before[k];
+        }
+
+        double normal_before[3];
+        double normal_after[3];
+        triangle_normal(before[0], before[1], before[2], normal_before);
+        triangle_normal(after[0], after[1], after[2], normal_after);
+        if (normal_before[0] * normal_after[0] + normal_before[1] * normal_after[1] + normal_before[2] * normal_after[2] <= 0.0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t mesh_simplify(uint32_t *destination, const uint32_t *indices, uint32_t index_count, const vertex *vertices, uint32_t vertex_count,
+                       uint32_t target_index_count, float target_error, float *error) {
+    index_count -= index_count % 3;
+    memmove(destination, indices, index_count * sizeof(uint32_t));
+    *error = 0.0f;
+    if (index_count <= target_index_count) {
+        return index_count;
+    }
+
+    uint32_t triangle_count = index_count / 3;
+    quadric *quadrics = calloc(MAX(vertex_count, 1), sizeof(quadric));
+    bool *locked = calloc(MAX(vertex_count, 1), sizeof(bool));
+    bool *touched = malloc(MAX(vertex_count, 1) * sizeof(bool));
+    uint32_t *remap = malloc(MAX(vertex_count, 1) * sizeof(uint32_t));
+    uint32_t *adjacency_offsets = malloc((vertex_count + 1) * sizeof(uint32_t));
+    uint32_t *adjacency = malloc(MAX(index_count, 1) * sizeof(uint32_t));
+    edge_collapse *collapses = malloc(MAX(index_count, 1) * sizeof(edge_collapse));
+
+    // without its buffers the range is returned as is
+    if (!quadrics || !locked || !touched || !remap || !adjacency_offsets || !adjacency || !collapses
+        || !mark_locked_vertices(destination, index_count, locked)) {
+        LOG("Allocate simplifier buffers failed!\n");
+        target_index_count = index_count;
+        triangle_count = 0;
+    }
+
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        const uint32_t *triangle = destination + 3 * i;
+        const float *p0 = vertices[triangle[0]].position;
+        double normal[3];
+        triangle_normal(p0, vertices[triangle[1]].position, vertices[triangle[2]].position, normal);
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0) {
+            continue;
+        }
+
+        normal[0] /= length;
+        normal[1] /= length;
+        normal[2] /= length;
+        double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+        for (uint32_t k = 0; k < 3; ++k) {
+            quadric_add_plane(quadrics + triangle[k], normal, distance, length * 0.5);
+        }
+    }
+
+    double cost_limit = (double)MAX(target_error, 0.0f) * MAX(target_error, 0.0f);
+    double max_cost = 0.0;
+    while (index_count > target_index_count) {
+        // triangles around every vertex
+        memset(adjacency_offsets, 0, (vertex_count + 1) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < index_count; ++i) {
+            ++ adjacency_offsets[destination[i] + 1];
+        }
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            adjacency_offsets[i + 1] += adjacency_offsets[i];
+        }
+        for (uint32_t i = 0; i < index_count; ++i) {
+            adjacency[adjacency_offsets[destination[i]] ++] = i / 3;
+        }
+        for (uint32_t i = vertex_count; i > 0; --i) {
+            adjacency_offsets[i] = adjacency_offsets[i - 1];
+        }
+        adjacency_offsets[0] = 0;
+
+        // an interior edge shows up once as a < b, the cheaper free direction is kept
+        uint32_t collapse_count = 0;
+        for (uint32_t i = 0; i < index_count; ++i) {
+            uint32_t a = destination[i];
+            uint32_t b = destination[i % 3 == 2 ? i - 2 : i + 1];
+            if (a >= b || (locked[a] && locked[b])) {
+                continue;
+            }
+
+            quadric q = quadrics[a];
+            quadric_add(&q, quadrics + b);
+            double cost_ab = locked[a] ? DBL_MAX : quadric_error(&q, vertices[b].position);
+            double cost_ba = locked[b] ? DBL_MAX : quadric_error(&q, vertices[a].position);
+            collapses[collapse_count ++] = cost_ab <= cost_ba ? (edge_collapse){a, b, cost_ab} : (edge_collapse){b, a, cost_ba};
+        }
+        qsort(collapses, collapse_count, sizeof(edge_collapse), compare_edge_collapses);
+
+        // collapses of one pass must not share triangles, so each flip test sees final positions
+        for (uint32_t i = 0; i < vertex_count; ++i) {
+            remap[i] = i;
+        }
+        memset(touched, 0, vertex_count * sizeof(bool));
+
+        uint32_t removable = (index_count - target_index_count) / 3;
+        uint32_t removed = 0;
+        for (uint32_t i = 0; i < collapse_count && removed < removable; ++i) {
+            const edge_collapse *collapse = collapses + i;
+            if (collapse->cost > cost_limit) {
+                break;
+            }
+
+            uint32_t from = collapse->from;
+            uint32_t to = collapse->to;
+            const uint32_t *around = adjacency + adjacency_offsets[from];
+            uint32_t around_count = adjacency_offsets[from + 1] - adjacency_offsets[from];
+            if (touched[from] || touched[to] || collapse_flips(vertices, destination, around, around_count, from, to)) {
+                continue;
+            }
+
+            for (uint32_t j = 0; j < around_count; ++j) {
+                const uint32_t *triangle = destination + 3 * around[j];
+                touched[triangle[0]] = true;
+                touched[triangle[1]] = true;
+                touched[triangle[2]] = true;
+                removed += triangle[0] == to || triangle[1] == to || triangle[2] == to;
+            }
+            remap[from] = to;
+            quadric_add(quadrics + to, quadrics + from);
+            max_cost = MAX(max_cost, collapse->cost);
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        // degenerate triangles drop out
+        uint32_t write = 0;
+        for (uint32_t i = 0; i < index_count; i += 3) {
+            uint32_t a = remap[destination[i]];
+            uint32_t b = remap[destination[i + 1]];
+            uint32_t c = remap[destination[i + 2]];
+            if (a != b && b != c && c != a) {
+                destination[write ++] = a;
+                destination[write ++] = b;
+                destination[write ++] = c;
+            }
+        }
+        index_count = write;
+    }
+
+    free(quadrics);
+    free(locked);
+    free(touched);
+    free(remap);
+    free(adjacency_offsets);
+    free(adjacency);
+    free(collapses);
+
+    *error = (float)sqrt(max_cost);
+    return index_count;
+}
+
+bool mesh_build_lods(mesh *m, uint32_t max_lod_count, float ratio, float max_error) {
+    if (!m->vertices || !m->indices || m->lod_count != 1) {
+        return false;
+    }
+
+    max_lod_count = MIN(MAX(max_lod_count, 1), MESH_MAX_LODS);
+    const mesh_lod base = m->lods[0];
+    uint32_t base_index_count = 0;
+    for (uint32_t i = base.first_submesh; i < base.first_submesh + base.submesh_count; ++i) {
+        base_index_count += m->submeshes[i].index_count;
+    }
+
+    // room for every level at full size, trimmed once the chain is known
+    size_t index_capacity = m->index_count + (size_t)(max_lod_count - 1) * base_index_count;
+    size_t submesh_capacity = m->submesh_count + (size_t)(max_lod_count - 1) * base.submesh_count;
+    uint32_t *indices = realloc(m->indices, MAX(index_capacity, 1) * sizeof(uint32_t));
+    if (indices) {
+        m->indices = indices;
+    }
+    submesh *submeshes = realloc(m->submeshes, MAX(submesh_capacity, 1) * sizeof(submesh));
+    if (submeshes) {
+        m->submeshes = submeshes;
+    }
+    mesh_lod *lods = realloc(m->lods, max_lod_count * sizeof(mesh_lod));
+    if (lods) {
+        m->lods = lods;
+    }
+    if (!indices || !submeshes || !lods) {
+        LOG("Allocate lod chain failed!\n");
+        return false;
+    }
+
+    float diagonal = 0.0f;
+    for (uint32_t i = 0; i < 3; ++i) {
+        float extent = m->bounds.max[i] - m->bounds.min[i];
+        diagonal += extent * extent;
+    }
+    float error_limit = max_error * sqrtf(diagonal);
+
+    // every level simplifies the one before, so its error is bounded by the sum of the collapse errors so far
+    uint32_t previous_index_count = base_index_count;
+    for (uint32_t level = 1; level < max_lod_count; ++level) {
+        const mesh_lod *previous = lods + level - 1;
+        mesh_lod lod = {.first_submesh = m->submesh_count, .submesh_count = base.submesh_count, .error = 0.0f};
+
+        uint32_t level_index_count = 0;
+        float level_error = 0.0f;
+        for (uint32_t i = 0; i < base.submesh_count; ++i) {
+            const submesh *source = submeshes + previous->first_submesh + i;
+            submesh *part = submeshes + lod.first_submesh + i;
+            *part = *source;
+            part->first_index = m->index_count + level_index_count;
+
+            float part_error = 0.0f;
+            uint32_t target_index_count = (uint32_t)(source->index_count / 3 * ratio) * 3;
+            part->index_count = mesh_simplify(indices + part->first_index, indices + source->first_index, source->index_count,
+                                              m->vertices + source->vertex_offset, source->vertex_count,
+                                              target_index_count, error_limit - previous->error, &part_error);
+            level_index_count += part->index_count;
+            level_error = MAX(level_error, part_error);
+        }
+
+        if (level_index_count > previous_index_count * (1.0f - LOD_MIN_REDUCTION)) {
+            break;
+        }
+
+        lod.error = previous->error + level_error;
+        lods[level] = lod;
+        m->index_count += level_index_count;
+        m->submesh_count += base.submesh_count;
+        m->lod_count = level + 1;
+        previous_index_count = level_index_count;
+    }
+
+    indices = realloc(m->indices, MAX(m->index_count, 1) * sizeof(uint32_t));
+    if (indices) {
+        m->indices = indices;
+    }
+    submeshes = realloc(m->submeshes, MAX(m->submesh_count, 1) * sizeof(submesh));
+    if (submeshes) {
+        m->submeshes = submeshes;
+    }
+    return true;
+}
+
+uint32_t mesh_select_lod(const mesh *m, float distance, float projection_scale, float pixel_threshold) {
+    distance = MAX(distance, FLT_MIN);
+
+    uint32_t selected = 0;
+    for (uint32_t i = 1; i < m->lod_count; ++i) {
+        if (m->lods[i].error * projection_scale / distance > pixel_threshold) {
+            break;
+        }
+        selected = i;
+    }
+    return selected;
+}
@@ -0,0 +1,27 @@
+#ifndef VK_EXAMPLE_MESH_SIMPLIFIER_H
+#define VK_EXAMPLE_MESH_SIMPLIFIER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mesh.h"
+
+// detail levels a mesh may carry, level 0 included
+#define MESH_MAX_LODS 8
+
+// collapse edges of one index range by quadric error until target_index_count or target_error is reached,
+// vertices on a border or uv seam stay where they are and no new vertices are made,
+// writes at most index_count indices to destination and returns how many, error receives the largest collapse error
+extern uint32_t mesh_simplify(uint32_t *destination, const uint32_t *indices, uint32_t index_count, const vertex *vertices, uint32_t vertex_count,
+                              uint32_t target_index_count, float target_error, float *error);
+
+// replace the lod chain with lod 0 plus up to max_lod_count - 1 levels, each with ratio of the triangles of the one before,
+// the chain ends early once a level stops shrinking or its error passes max_error times the bounds diagonal,
+// needs float vertices and 32 bit indices
+extern bool mesh_build_lods(mesh *m, uint32_t max_lod_count, float ratio, float max_error);
+
+// coarsest level whose error stays within pixel_threshold pixels at distance,
+// projection_scale is the viewport height over 2 * tan(fov_y / 2)
+extern uint32_t mesh_select_lod(const mesh *m, float distance, float projection_scale, float pixel_threshold);
+
+#endif //VK_EXAMPLE_MESH_SIMPLIFIER_H
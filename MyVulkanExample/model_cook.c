@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "model_cook.h"
+#include "mesh_cluster.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+
+// seeds the source hash, bump when the cook steps change so cooked models are rebuilt
+static const uint64_t MODEL_COOK_VERSION = 6;
+// longest material library name looked up for the source hash
+static const size_t MTLLIB_NAME_LENGTH = 260;
+
+const model_cook_settings model_cook_default_settings = {
+    // each detail level keeps half the triangles of the one before, none may stray further than 2% of the model size
+    .lod_count = 6,
+    .lod_ratio = 0.5f,
+    .lod_max_error = 0.02f,
+    .overdraw_threshold = 1.05f,
+    .packed_vertices = false
+};
+
+// name of the last mtllib line, the one the obj parser loads
+static bool find_mtllib(const char *content, size_t size, char *name, size_t name_size) {
+    bool found = false;
+    size_t i = 0;
+    while (i < size) {
+        size_t line_end = i;
+        while (line_end < size && content[line_end] != '\n') {
+            ++ line_end;
+        }
+
+        size_t p = i;
+        while (p < line_end && (content[p] == ' ' || content[p] == '\t')) {
+            ++ p;
+        }
+        if (p + 7 <= line_end && !strncmp(content + p, "mtllib", 6) && (content[p + 6] == ' ' || content[p + 6] == '\t')) {
+            p += 7;
+            size_t end = line_end;
+            while (end > p && (content[end - 1] == '\r' || content[end - 1] == ' ' || content[end - 1] == '\t')) {
+                -- end;
+            }
+            if (end > p && end - p < name_size) {
+                memcpy(name, content + p, end - p);
+                name[end - p] = '\0';
+                found = true;
+            }
+        }
+
+        i = line_end + 1;
+    }
+
+    return found;
+}
+
+uint64_t model_cook_source_hash(const mapped_file *source, const model_cook_settings *settings) {
+    // fields one by one, the struct has padding
+    uint64_t hash = MODEL_COOK_VERSION;
+    hash = hash_bytes(&(settings->lod_count), sizeof(settings->lod_count), hash);
+    hash = hash_bytes(&(settings->lod_ratio), sizeof(settings->lod_ratio), hash);
+    hash = hash_bytes(&(settings->lod_max_error), sizeof(settings->lod_max_error), hash);
+    hash = hash_bytes(&(settings->overdraw_threshold), sizeof(settings->overdraw_threshold), hash);
+    hash = hash_bytes(&(settings->packed_vertices), sizeof(settings->packed_vertices), hash);
+    hash = hash_bytes(source->data, source->size, hash);
+
+    char mtllib[MTLLIB_NAME_LENGTH];
+    mapped_file materials = {0};
+    if (find_mtllib(source->data, source->size, mtllib, sizeof(mtllib)) && map_file(mtllib, &materials)) {
+        hash = hash_bytes(materials.data, materials.size, hash);
+        unmap_file(&materials);
+    }
+
+    return hash;
+}
+
+bool model_cook(const mapped_file *source, thread_pool *pool, const model_cook_settings *settings, mesh *out) {
+    if (!mesh_parse_obj(source->data, source->size, pool, out)) {
+        LOG("Load model file failed!\n");
+        return false;
+    }
+
+    if (!mesh_build_lods(out, settings->lod_count, settings->lod_ratio, settings->lod_max_error)) {
+        LOG("Build model lods failed!\n");
+        return false;
+    }
+    LOG("Model has %d lods, coarsest error %f\n", out->lod_count, out->lods[out->lod_count - 1].error);
+
+    vertex_cache_stats before = mesh_analyze_vertex_cache(out, VERTEX_CACHE_REPORT_SIZE);
+
+    if (!mesh_optimize_vertex_cache(out)) {
+        LOG("Optimize model vertex cache failed!\n");
+        return false;
+    }
+    vertex_cache_stats after = mesh_analyze_vertex_cache(out, VERTEX_CACHE_REPORT_SIZE);
+    LOG("Model vertex cache ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", before.acmr, after.acmr, before.atvr, after.atvr);
+
+    if (!mesh_optimize_overdraw(out, settings->overdraw_threshold) || !mesh_optimize_vertex_fetch(out)) {
+        LOG("Optimize model overdraw and vertex fetch failed!\n");
+        return false;
+    }
+    after = mesh_analyze_vertex_cache(out, VERTEX_CACHE_REPORT_SIZE);
+    LOG("Model vertex cache after overdraw ordering ACMR %.3f, ATVR %.3f\n", after.acmr, after.atvr);
+
+    if (!mesh_pack_indices(out)) {
+        LOG("Pack model indices failed!\n");
+        return false;
+    }
+    if (!mesh_build_meshlets(out)) {
+        LOG("Build model meshlets failed!\n");
+        return false;
+    }
+    LOG("Model has %d meshlets\n", out->meshlet_count);
+    if (settings->packed_vertices && !mesh_pack_vertices(out)) {
+        LOG("Pack model vertices failed!\n");
+        return false;
+    }
+    LOG("Model vertices %d, %d bytes each, %d submeshes with 16 bit indices\n", out->vertex_count, mesh_get_vertex_layout(out)->stride, out->submesh_count);
+
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef VK_EXAMPLE_MODEL_COOK_H
+#define VK_EXAMPLE_MODEL_COOK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "example.h"
+#include "mesh.h"
+#include "thread_pool.h"
+
+// every step between the obj source and the mesh file the renderer loads, shared by the renderer and the asset cooker
+typedef struct model_cook_settings {
+    uint32_t lod_count;
+    float lod_ratio;
+    float lod_max_error;
+    float overdraw_threshold;
+    bool packed_vertices;
+} model_cook_settings;
+
+extern const model_cook_settings model_cook_default_settings;
+
+// hash of the obj content, the material library it names and every setting,
+// the material library is opened relative to the working directory like the obj parser does
+extern uint64_t model_cook_source_hash(const mapped_file *source, const model_cook_settings *settings);
+
+// parse the obj content and run the lod, ordering, packing and meshlet passes, the result is ready for mesh_file_write
+extern bool model_cook(const mapped_file *source, thread_pool *pool, const model_cook_settings *settings, mesh *out);
+
+#endif //VK_EXAMPLE_MODEL_COOK_H
@@ -1,2 +1,8 @@
 call glslangValidator.exe -V shader.frag
-call glslangValidator.exe -V shader.vert
\ No newline at end of file
+call glslangValidator.exe -V shader.vert
+call glslangValidator.exe -V -DPACKED_VERTICES -o vert_packed.spv shader.vert
+call glslangValidator.exe -V -DBINDLESS -o frag_bindless.spv shader.frag
+call glslangValidator.exe -V -DBINDLESS -o vert_bindless.spv shader.vert
+call glslangValidator.exe -V -DPACKED_VERTICES -DBINDLESS -o vert_packed_bindless.spv shader.vert
+call glslangValidator.exe -V -DVIRTUAL -o frag_virtual.spv shader.frag
+call glslangValidator.exe -V -DFEEDBACK -o frag_feedback.spv shader.frag
\ No newline at end of file
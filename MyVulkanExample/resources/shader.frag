@@ -1,14 +1,64 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 1) uniform sampler2D tex_sampler;
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+// every texture, the material index of the draw picks one
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+layout(location = 2) flat in uint frag_material;
+#elif defined(VIRTUAL)
+// pages with their borders, found through the page table level of the level sampled
+layout(set = 1, binding = 1) uniform sampler2D page_cache;
+layout(set = 1, binding = 2) uniform usampler2D page_table;
+#elif !defined(FEEDBACK)
+layout(set = 1, binding = 1) uniform sampler2D tex_sampler;
+#endif
+
+#if defined(VIRTUAL) || defined(FEEDBACK)
+layout(push_constant) uniform virtual_constants {
+    layout(offset = 32) vec4 size; // level 0 and the cache in texels
+    vec4 page;                     // page size, page size with borders, border and paged levels
+    vec4 lod;                      // added to the level picked from the derivatives
+} vt;
+#endif
 
 layout(location = 0) in vec3 frag_color;
 layout(location = 1) in vec2 frag_texcoord;
 
+#ifdef FEEDBACK
+// level << 24 | page y << 12 | page x
+layout(location = 0) out uint out_page;
+#else
 layout(location = 0) out vec4 out_color;
+#endif
 
 void main() {
+#if defined(VIRTUAL) || defined(FEEDBACK)
+    // the finer level of the two a trilinear sample would blend, clamped to the paged ones
+    vec2 dx = dFdx(frag_texcoord) * vt.size.xy;
+    vec2 dy = dFdy(frag_texcoord) * vt.size.xy;
+    float level = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + vt.lod.x;
+    level = clamp(floor(level), 0.0, vt.page.w - 1.0);
+    vec2 uv = fract(frag_texcoord);
+    vec2 pages = vt.size.xy / (vt.page.x * exp2(level));
+    uvec2 page = min(uvec2(uv * pages), uvec2(pages) - 1u);
+#endif
+
+#ifdef FEEDBACK
+    out_page = (uint(level) << 24) | (page.y << 12) | page.x;
+#elif defined(VIRTUAL)
+    // a missing page points at its nearest resident ancestor, whose level is in z
+    uvec4 entry = texelFetch(page_table, ivec2(page), int(level));
+    float scale = exp2(-float(entry.z)) / vt.page.x;
+    vec2 in_page = fract(uv * vt.size.xy * scale) * vt.page.x;
+    vec2 texel = vec2(entry.xy) * vt.page.y + vt.page.z + in_page;
+    vec2 gradient_scale = vt.size.xy * exp2(-float(entry.z)) / vt.size.zw;
+    out_color = vec4(textureGrad(page_cache, texel / vt.size.zw, dFdx(frag_texcoord) * gradient_scale, dFdy(frag_texcoord) * gradient_scale).rgb, 1.0);
+#elif defined(BINDLESS)
+    //out_color = vec4(frag_color * texture(tex_sampler, frag_texcoord).rgb, 1.0);
+    out_color = vec4(texture(textures[nonuniformEXT(frag_material)], frag_texcoord).rgb, 1.0);
+#else
     //out_color = vec4(frag_color * texture(tex_sampler, frag_texcoord).rgb, 1.0);
     out_color = vec4(texture(tex_sampler, frag_texcoord).rgb, 1.0);
+#endif
 }
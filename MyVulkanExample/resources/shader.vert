@@ -1,7 +1,7 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 0) uniform uniform_buffer_object {
+layout(set = 0, binding = 0) uniform uniform_buffer_object {
     mat4 model;
     mat4 view;
     mat4 proj;
@@ -9,17 +9,38 @@ layout(binding = 0) uniform uniform_buffer_object {
 
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec2 in_texcoord;
+#ifdef PACKED_VERTICES
+// unorm16 position within the mesh bounds and half float texcoord, no color stream
+layout(push_constant) uniform mesh_constants {
+    vec4 position_offset;
+    vec4 position_scale;
+} push;
+#else
 layout(location = 2) in vec3 in_color;
+#endif
 
 layout(location = 0) out vec3 frag_color;
 layout(location = 1) out vec2 frag_texcoord;
+#ifdef BINDLESS
+// the first instance of a draw is its material index
+layout(location = 2) flat out uint frag_material;
+#endif
 
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
 void main() {
+#ifdef PACKED_VERTICES
+    vec3 position = push.position_offset.xyz + in_position * push.position_scale.xyz;
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+    frag_color = vec3(1.0);
+#else
     gl_Position = ubo.proj * ubo.view * ubo.model * vec4(in_position, 1.0);
     frag_color = in_color;
+#endif
     frag_texcoord = in_texcoord;
+#ifdef BINDLESS
+    frag_material = uint(gl_InstanceIndex);
+#endif
 }
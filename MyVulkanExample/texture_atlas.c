@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stb_rect_pack.h"
+
+#include "example.h"
+#include "texture_atlas.h"
+#include "texture_mips.h"
+
+const texture_atlas_settings texture_atlas_default_settings = {
+    .size = 2048,
+    .padding = 8,
+    .max_layers = 16
+};
+
+uint32_t texture_atlas_mip_count(const texture_atlas_settings *settings) {
+    uint32_t count = 1;
+    while ((1u << count) <= settings->padding) {
+        ++ count;
+    }
+    return MIN(count, texture_mip_count(settings->size, settings->size));
+}
+
+// images are placed on a grid of this many texels, at least a 4x4 block so no compressed block holds two images,
+// and coarse enough that every level keeps the images on whole texels
+static uint32_t pack_unit(const texture_atlas_settings *settings) {
+    return MAX(4, 1u << (texture_atlas_mip_count(settings) - 1));
+}
+
+uint32_t texture_atlas_pack(texture_atlas_entry *entries, uint32_t count, const texture_atlas_settings *settings) {
+    uint32_t unit = pack_unit(settings);
+    int grid = (int)(settings->size / unit);
+    stbrp_rect *rects = malloc(MAX(count, 1) * sizeof(stbrp_rect));
+    stbrp_node *nodes = malloc(MAX(grid, 1) * sizeof(stbrp_node));
+    if (!rects || !nodes) {
+        LOG("Allocate atlas packer failed!\n");
+        free(rects);
+        free(nodes);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+        if (entries[i].width == 0 || entries[i].height == 0 || entries[i].width + 2 * settings->padding > settings->size || entries[i].height + 2 * settings->padding > settings->size) {
+            LOG("Atlas image %d of %dx%d does not fit a layer!\n", i, entries[i].width, entries[i].height);
+            free(rects);
+            free(nodes);
+            return 0;
+        }
+        rects[i].id = (int)i;
+        rects[i].w = (stbrp_coord)((entries[i].width + 2 * settings->padding + unit - 1) / unit);
+        rects[i].h = (stbrp_coord)((entries[i].height + 2 * settings->padding + unit - 1) / unit);
+        rects[i].was_packed = 0;
+    }
+
+    // whatever did not fit the layer is packed into the next one
+    uint32_t layer_count = 0;
+    uint32_t remaining = count;
+    stbrp_context context;
+    while (remaining > 0 && layer_count < settings->max_layers) {
+        stbrp_init_target(&context, grid, grid, nodes, grid);
+        stbrp_pack_rects(&context, rects, (int)remaining);
+
+        uint32_t left = 0;
+        for (uint32_t i = 0; i < remaining; ++i) {
+            if (!rects[i].was_packed) {
+                rects[left ++] = rects[i];
+                continue;
+            }
+
+            texture_atlas_entry *entry = entries + rects[i].id;
+            entry->layer = layer_count;
+            entry->x = rects[i].x * unit + settings->padding;
+            entry->y = rects[i].y * unit + settings->padding;
+            entry->uv_scale[0] = (float)entry->width / settings->size;
+            entry->uv_scale[1] = (float)entry->height / settings->size;
+            entry->uv_offset[0] = (float)entry->x / settings->size;
+            entry->uv_offset[1] = (float)entry->y / settings->size;
+        }
+        remaining = left;
+        ++ layer_count;
+    }
+
+    free(rects);
+    free(nodes);
+    if (remaining > 0) {
+        LOG("%d atlas images are left over after %d layers!\n", remaining, layer_count);
+        return 0;
+    }
+    return layer_count;
+}
+
+void texture_atlas_blit(const texture_atlas_entry *entries, const uint8_t *const *pixels, uint32_t count, const texture_atlas_settings *settings, uint8_t *layers) {
+    size_t layer_size = (size_t)settings->size * settings->size * 4;
+    for (uint32_t i = 0; i < count; ++i) {
+        const texture_atlas_entry *entry = entries + i;
+        uint8_t *layer = layers + entry->layer * layer_size;
+        uint32_t padding = settings->padding;
+
+        for (uint32_t y = entry->y - padding; y < entry->y + entry->height + padding; ++y) {
+            uint32_t source_y = (uint32_t)MIN(MAX((int64_t)y - entry->y, 0), entry->height - 1);
+            const uint8_t *row = pixels[i] + (size_t)source_y * entry->width * 4;
+            uint8_t *target = layer + ((size_t)y * settings->size + entry->x - padding) * 4;
+
+            // left edge, the row itself, right edge
+            for (uint32_t x = 0; x < padding; ++x) {
+                memcpy(target + x * 4, row, 4);
+            }
+            memcpy(target + padding * 4, row, (size_t)entry->width * 4);
+            for (uint32_t x = 0; x < padding; ++x) {
+                memcpy(target + (padding + entry->width + x) * 4, row + (entry->width - 1) * 4, 4);
+            }
+        }
+    }
+}
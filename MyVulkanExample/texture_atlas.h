@@ -0,0 +1,42 @@
+#ifndef VK_EXAMPLE_TEXTURE_ATLAS_H
+#define VK_EXAMPLE_TEXTURE_ATLAS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// where one image of an atlas went, texcoords of the image map into it with uv * uv_scale + uv_offset on layer,
+// they have to stay within 0 to 1 since an atlas can not repeat an image,
+// atlases are packed offline, nothing here remaps a model, it is authored against the transforms the cooker writes out
+typedef struct texture_atlas_entry {
+    uint32_t width;  // of the source image, set before packing
+    uint32_t height;
+    uint32_t layer;
+    uint32_t x;      // texel of the top left corner of the image in its layer
+    uint32_t y;
+    float uv_scale[2];
+    float uv_offset[2];
+} texture_atlas_entry;
+
+typedef struct texture_atlas_settings {
+    // width and height of every layer
+    uint32_t size;
+    // texels of repeated edge around every image, a power of two, it also sets how many levels stay apart
+    uint32_t padding;
+    // 1 packs a plain 2d atlas, more spill into the layers of a 2d array
+    uint32_t max_layers;
+} texture_atlas_settings;
+
+extern const texture_atlas_settings texture_atlas_default_settings;
+
+// place every image with stb_rect_pack, filling one layer before the next, and return the layers used,
+// 0 when an image is larger than a layer or max_layers are not enough
+extern uint32_t texture_atlas_pack(texture_atlas_entry *entries, uint32_t count, const texture_atlas_settings *settings);
+
+// levels of the atlas, past them a texel would cover more than the padding and blend neighboring images
+extern uint32_t texture_atlas_mip_count(const texture_atlas_settings *settings);
+
+// copy every rgba8 image into its layer, the padding repeats the nearest edge texel,
+// layers are size * size rgba8 texels back to back, texels no image covers are left as they are
+extern void texture_atlas_blit(const texture_atlas_entry *entries, const uint8_t *const *pixels, uint32_t count, const texture_atlas_settings *settings, uint8_t *layers);
+
+#endif //VK_EXAMPLE_TEXTURE_ATLAS_H
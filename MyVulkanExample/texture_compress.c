@@ -0,0 +1,86 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stb_dxt.h"
+
+#include "example.h"
+#include "texture_compress.h"
+
+// block rows of a level compressed by one task
+static const uint32_t COMPRESS_BAND_ROWS = 4;
+
+typedef struct compress_pass {
+    const uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+    uint8_t *blocks;
+    size_t block_size;
+    bool alpha;
+} compress_pass;
+
+texture_format texture_pick_block_format(const uint8_t *pixels, size_t texel_count) {
+    for (size_t i = 0; i < texel_count; ++i) {
+        if (pixels[i * 4 + 3] != 255) {
+            return TEXTURE_FORMAT_BC3;
+        }
+    }
+    return TEXTURE_FORMAT_BC1;
+}
+
+static void compress_band(void *data, size_t band) {
+    const compress_pass *pass = data;
+    uint32_t blocks_wide = (pass->width + 3) / 4;
+    uint32_t blocks_high = (pass->height + 3) / 4;
+    uint32_t first_row = (uint32_t)band * COMPRESS_BAND_ROWS;
+    uint32_t end_row = MIN(first_row + COMPRESS_BAND_ROWS, blocks_high);
+
+    uint8_t texels[16 * 4];
+    for (uint32_t by = first_row; by < end_row; ++by) {
+        for (uint32_t bx = 0; bx < blocks_wide; ++bx) {
+            for (uint32_t y = 0; y < 4; ++y) {
+                uint32_t row = MIN(by * 4 + y, pass->height - 1);
+                for (uint32_t x = 0; x < 4; ++x) {
+                    uint32_t column = MIN(bx * 4 + x, pass->width - 1);
+                    memcpy(texels + (y * 4 + x) * 4, pass->pixels + ((size_t)row * pass->width + column) * 4, 4);
+                }
+            }
+
+            uint8_t *block = pass->blocks + ((size_t)by * blocks_wide + bx) * pass->block_size;
+            stb_compress_dxt_block(block, texels, pass->alpha, STB_DXT_HIGHQUAL);
+        }
+    }
+}
+
+bool texture_compress(const uint8_t *chain, const texture_mip *mips, uint32_t mip_count, texture_format format, thread_pool *pool, uint8_t *blocks, const texture_mip *block_mips) {
+    if (format != TEXTURE_FORMAT_BC1 && format != TEXTURE_FORMAT_BC3) {
+        return false;
+    }
+
+    // stb_dxt fills its tables on the first call without a lock, so make that call here before the workers start
+    uint8_t warm_up_texels[16 * 4] = {0};
+    uint8_t warm_up_block[16];
+    stb_compress_dxt_block(warm_up_block, warm_up_texels, 0, STB_DXT_NORMAL);
+
+    compress_pass pass = {
+        .block_size = format == TEXTURE_FORMAT_BC3 ? 16 : 8,
+        .alpha = format == TEXTURE_FORMAT_BC3
+    };
+    for (uint32_t i = 0; i < mip_count; ++i) {
+        if (block_mips[i].size != texture_level_size(format, mips[i].width, mips[i].height)) {
+            LOG("Block level %d size does not match its texels!\n", i);
+            return false;
+        }
+
+        pass.pixels = chain + mips[i].offset;
+        pass.width = mips[i].width;
+        pass.height = mips[i].height;
+        pass.blocks = blocks + block_mips[i].offset;
+
+        uint32_t blocks_high = (pass.height + 3) / 4;
+        thread_pool_parallel_for(pool, (blocks_high + COMPRESS_BAND_ROWS - 1) / COMPRESS_BAND_ROWS, compress_band, &pass);
+    }
+
+    return true;
+}
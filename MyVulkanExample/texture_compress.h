@@ -0,0 +1,18 @@
+#ifndef VK_EXAMPLE_TEXTURE_COMPRESS_H
+#define VK_EXAMPLE_TEXTURE_COMPRESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "texture_mips.h"
+#include "thread_pool.h"
+
+// bc3 when any of the rgba8 texels is not fully opaque, bc1 otherwise
+extern texture_format texture_pick_block_format(const uint8_t *pixels, size_t texel_count);
+
+// compress every level of an rgba8 chain into blocks laid out by block_mips, block rows are spread over the pool,
+// texels past the edge of a level repeat the last row and column
+extern bool texture_compress(const uint8_t *chain, const texture_mip *mips, uint32_t mip_count, texture_format format, thread_pool *pool, uint8_t *blocks, const texture_mip *block_mips);
+
+#endif //VK_EXAMPLE_TEXTURE_COMPRESS_H
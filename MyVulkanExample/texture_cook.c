@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "stb_image.h"
+
+#include "example.h"
+#include "texture_cook.h"
+#include "texture_compress.h"
+
+// seeds the source hash, bump when the cook steps change so cooked textures are rebuilt
+static const uint64_t TEXTURE_COOK_VERSION = 1;
+
+const texture_cook_settings texture_cook_default_settings = {
+    .srgb = true,
+    .block_compress = true
+};
+
+uint64_t texture_cook_source_hash(const mapped_file *source, const texture_cook_settings *settings) {
+    // fields one by one, the struct has padding
+    uint64_t hash = TEXTURE_COOK_VERSION;
+    hash = hash_bytes(&(settings->srgb), sizeof(settings->srgb), hash);
+    hash = hash_bytes(&(settings->block_compress), sizeof(settings->block_compress), hash);
+    return hash_bytes(source->data, source->size, hash);
+}
+
+uint8_t * texture_decode(const mapped_file *source, uint32_t *width, uint32_t *height) {
+    int w, h, channels;
+    stbi_uc *pixels = stbi_load_from_memory(source->data, (int)source->size, &w, &h, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        return NULL;
+    }
+
+    *width = (uint32_t)w;
+    *height = (uint32_t)h;
+    return pixels;
+}
+
+void texture_decode_free(uint8_t *pixels) {
+    stbi_image_free(pixels);
+}
+
+// build the mips of every layer, compress them to format unless it is rgba8, and lay the levels out with all layers of a level together,
+// pixels holds the layers back to back
+static bool cook_layers(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t layer_count, uint32_t mip_count, texture_format format, thread_pool *pool, const texture_cook_settings *settings, texture_chain *out) {
+    if (width == 0 || height == 0 || layer_count == 0) {
+        return false;
+    }
+
+    texture_mip mips[TEXTURE_MAX_MIPS];
+    texture_mip layer_mips[TEXTURE_MAX_MIPS];
+    size_t chain_size = texture_mip_layout(TEXTURE_FORMAT_RGBA8, width, height, mip_count, mips);
+    size_t layer_size = texture_mip_layout(format, width, height, mip_count, layer_mips);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < mip_count; ++i) {
+        out->mips[i] = layer_mips[i];
+        out->mips[i].offset = offset;
+        out->mips[i].size = layer_mips[i].size * layer_count;
+        offset += out->mips[i].size;
+    }
+
+    // a single layer is built in place, the layers of an array go through scratch space and are spread over the levels after
+    bool compress = format != TEXTURE_FORMAT_RGBA8;
+    out->data = malloc(offset);
+    uint8_t *chain = compress ? malloc(chain_size) : NULL;
+    uint8_t *scratch = layer_count > 1 ? malloc(layer_size) : NULL;
+    if (!out->data || (compress && !chain) || (layer_count > 1 && !scratch)) {
+        LOG("Allocate texture chain failed!\n");
+        free(chain);
+        free(scratch);
+        texture_chain_free(out);
+        return false;
+    }
+
+    bool ret = true;
+    float mip_seconds = 0.0f;
+    float compress_seconds = 0.0f;
+    size_t texel_size = (size_t)width * height * 4;
+    for (uint32_t layer = 0; layer < layer_count && ret; ++layer) {
+        uint8_t *target = scratch ? scratch : out->data;
+
+        float start = high_resolution_clock_now();
+        ret = texture_build_mips(pixels + layer * texel_size, mips, mip_count, settings->srgb, pool, compress ? chain : target);
+        mip_seconds += high_resolution_clock_now() - start;
+        if (!ret) {
+            LOG("Build texture mips failed!\n");
+            break;
+        }
+
+        start = high_resolution_clock_now();
+        ret = !compress || texture_compress(chain, mips, mip_count, format, pool, target, layer_mips);
+        compress_seconds += high_resolution_clock_now() - start;
+        if (!ret) {
+            LOG("Compress texture failed!\n");
+            break;
+        }
+
+        for (uint32_t i = 0; scratch && i < mip_count; ++i) {
+            memcpy(out->data + out->mips[i].offset + layer * layer_mips[i].size, scratch + layer_mips[i].offset, layer_mips[i].size);
+        }
+    }
+    free(chain);
+    free(scratch);
+    if (!ret) {
+        texture_chain_free(out);
+        return false;
+    }
+
+    LOG("Texture mips built in %f seconds\n", mip_seconds);
+    if (compress) {
+        LOG("Texture compressed to %s in %f seconds\n", format == TEXTURE_FORMAT_BC3 ? "bc3" : "bc1", compress_seconds);
+    }
+
+    out->format = format;
+    out->mip_count = mip_count;
+    out->layer_count = layer_count;
+    out->size = offset;
+    return true;
+}
+
+bool texture_cook(const mapped_file *source, thread_pool *pool, const texture_cook_settings *settings, texture_chain *out) {
+    memset(out, 0, sizeof(texture_chain));
+
+    uint32_t width, height;
+    uint8_t *pixels = texture_decode(source, &width, &height);
+    if (!pixels) {
+        LOG("Decode texture failed!\n");
+        return false;
+    }
+
+    texture_format format = settings->block_compress ? texture_pick_block_format(pixels, (size_t)width * height) : TEXTURE_FORMAT_RGBA8;
+    bool ret = cook_layers(pixels, width, height, 1, texture_mip_count(width, height), format, pool, settings, out);
+    texture_decode_free(pixels);
+    return ret;
+}
+
+bool texture_cook_atlas(const mapped_file *sources, uint32_t count, thread_pool *pool, const texture_cook_settings *settings, const texture_atlas_settings *atlas_settings, texture_atlas_entry *entries, texture_chain *out) {
+    memset(out, 0, sizeof(texture_chain));
+
+    uint8_t **pixels = calloc(MAX(count, 1), sizeof(uint8_t *));
+    if (!pixels) {
+        return false;
+    }
+
+    // bc3 for the whole atlas once any image has alpha, the texels between images do not count
+    bool ret = true;
+    texture_format format = settings->block_compress ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_RGBA8;
+    for (uint32_t i = 0; i < count && ret; ++i) {
+        memset(entries + i, 0, sizeof(texture_atlas_entry));
+        pixels[i] = texture_decode(sources + i, &(entries[i].width), &(entries[i].height));
+        if (!pixels[i]) {
+            LOG("Decode atlas image %d failed!\n", i);
+            ret = false;
+        } else if (settings->block_compress && texture_pick_block_format(pixels[i], (size_t)entries[i].width * entries[i].height) == TEXTURE_FORMAT_BC3) {
+            format = TEXTURE_FORMAT_BC3;
+        }
+    }
+
+    uint32_t layer_count = ret ? texture_atlas_pack(entries, count, atlas_settings) : 0;
+    uint8_t *layers = layer_count ? calloc(layer_count, (size_t)atlas_settings->size * atlas_settings->size * 4) : NULL;
+    if (layers) {
+        texture_atlas_blit(entries, (const uint8_t *const *)pixels, count, atlas_settings, layers);
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        texture_decode_free(pixels[i]);
+    }
+    free(pixels);
+
+    ret = layers && cook_layers(layers, atlas_settings->size, atlas_settings->size, layer_count, texture_atlas_mip_count(atlas_settings), format, pool, settings, out);
+    free(layers);
+    return ret;
+}
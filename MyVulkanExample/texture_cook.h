@@ -0,0 +1,38 @@
+#ifndef VK_EXAMPLE_TEXTURE_COOK_H
+#define VK_EXAMPLE_TEXTURE_COOK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "example.h"
+#include "texture_atlas.h"
+#include "texture_mips.h"
+#include "thread_pool.h"
+
+// every step between the decoded image and the texture file the renderer loads
+typedef struct texture_cook_settings {
+    // color channels are srgb encoded, mips are filtered on linear values
+    bool srgb;
+    // bc1 for opaque images and bc3 for the rest, plain rgba8 otherwise
+    bool block_compress;
+} texture_cook_settings;
+
+extern const texture_cook_settings texture_cook_default_settings;
+
+// hash of the encoded image content and every setting
+extern uint64_t texture_cook_source_hash(const mapped_file *source, const texture_cook_settings *settings);
+
+// decode a jpeg, png, tga or bmp to rgba8, this file holds the only copy of the image loader
+extern uint8_t * texture_decode(const mapped_file *source, uint32_t *width, uint32_t *height);
+
+extern void texture_decode_free(uint8_t *pixels);
+
+// decode the image, build its mip chain and compress it, the result is ready for texture_file_write
+extern bool texture_cook(const mapped_file *source, thread_pool *pool, const texture_cook_settings *settings, texture_chain *out);
+
+// decode the images, pack them with texture_atlas_pack and cook the layers into one chain with a layer per atlas layer,
+// entries get where each image went, the chain only has the levels texture_atlas_mip_count allows
+extern bool texture_cook_atlas(const mapped_file *sources, uint32_t count, thread_pool *pool, const texture_cook_settings *settings, const texture_atlas_settings *atlas_settings, texture_atlas_entry *entries, texture_chain *out);
+
+#endif //VK_EXAMPLE_TEXTURE_COOK_H
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "texture_file.h"
+
+static const uint64_t CHECKSUM_SEED = 0x74657872ull;
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint64_t level_table_offset(void) {
+    return align_up(sizeof(texture_file_header), TEXTURE_FILE_ALIGNMENT);
+}
+
+static bool write_padding(FILE *file, uint64_t *offset, uint64_t alignment) {
+    static const char zeros[TEXTURE_FILE_ALIGNMENT] = {0};
+    uint64_t padding = align_up(*offset, alignment) - *offset;
+    *offset += padding;
+    return padding == 0 || fwrite(zeros, 1, (size_t)padding, file) == padding;
+}
+
+bool texture_file_write(const char *file_name, uint64_t source_hash, const texture_chain *chain) {
+    if (chain->mip_count == 0 || chain->mip_count > TEXTURE_MAX_MIPS || chain->layer_count == 0) {
+        return false;
+    }
+
+    texture_file_level levels[TEXTURE_MAX_MIPS];
+    memset(levels, 0, sizeof(levels));
+
+    FILE *file = fopen(file_name, "wb");
+    if (!file) {
+        LOG("Open texture file %s for write failed!\n", file_name);
+        return false;
+    }
+
+    bool ret = false;
+    do {
+        // header and level table are written last, once offsets and checksums are known
+        uint64_t offset = level_table_offset() + chain->mip_count * sizeof(texture_file_level);
+        if (_fseeki64(file, (__int64)offset, SEEK_SET) != 0) {
+            break;
+        }
+
+        bool written = true;
+        for (uint32_t i = 0; i < chain->mip_count && written; ++i) {
+            const texture_mip *mip = chain->mips + i;
+            written = write_padding(file, &offset, TEXTURE_FILE_ALIGNMENT);
+
+            levels[i].width = mip->width;
+            levels[i].height = mip->height;
+            levels[i].offset = offset;
+            levels[i].size = mip->size;
+            levels[i].checksum = hash_bytes(chain->data + mip->offset, mip->size, CHECKSUM_SEED);
+
+            written = written && fwrite(chain->data + mip->offset, 1, mip->size, file) == mip->size;
+            offset += mip->size;
+        }
+        if (!written) {
+            LOG("Write texture file levels failed!\n");
+            break;
+        }
+
+        texture_file_header header = {
+            .magic = TEXTURE_FILE_MAGIC,
+            .version = TEXTURE_FILE_VERSION,
+            .alignment = TEXTURE_FILE_ALIGNMENT,
+            .format = chain->format,
+            .width = chain->mips[0].width,
+            .height = chain->mips[0].height,
+            .mip_count = chain->mip_count,
+            .layer_count = chain->layer_count,
+            .file_size = offset,
+            .source_hash = source_hash,
+            .checksum = hash_bytes(levels, chain->mip_count * sizeof(texture_file_level), CHECKSUM_SEED)
+        };
+
+        uint64_t header_end = sizeof(header);
+        written = _fseeki64(file, 0, SEEK_SET) == 0
+            && fwrite(&header, sizeof(header), 1, file) == 1
+            && write_padding(file, &header_end, TEXTURE_FILE_ALIGNMENT)
+            && fwrite(levels, sizeof(texture_file_level), chain->mip_count, file) == chain->mip_count;
+        if (!written) {
+            LOG("Write texture file header failed!\n");
+            break;
+        }
+
+        ret = true;
+    } while (false);
+
+    fclose(file);
+    if (!ret) {
+        remove(file_name);
+    }
+
+    return ret;
+}
+
+bool texture_file_open(const char *file_name, texture_file *out) {
+    memset(out, 0, sizeof(texture_file));
+
+    mapped_file file;
+    if (!map_file(file_name, &file)) {
+        return false;
+    }
+
+    bool ret = false;
+    do {
+        const texture_file_header *header = file.data;
+        if (file.size < level_table_offset()
+            || header->magic != TEXTURE_FILE_MAGIC
+            || header->version != TEXTURE_FILE_VERSION
+            || header->alignment != TEXTURE_FILE_ALIGNMENT
+            || header->file_size != file.size) {
+            LOG("Texture file %s has an unknown version!\n", file_name);
+            break;
+        }
+
+        uint64_t table_size = (uint64_t)header->mip_count * sizeof(texture_file_level);
+        if (header->mip_count == 0 || header->mip_count > TEXTURE_MAX_MIPS || header->layer_count == 0 || table_size > file.size - level_table_offset()) {
+            LOG("Texture file %s level table is truncated!\n", file_name);
+            break;
+        }
+
+        const texture_file_level *levels = (const texture_file_level *)((const char *)file.data + level_table_offset());
+        if (header->checksum != hash_bytes(levels, (size_t)table_size, CHECKSUM_SEED)) {
+            LOG("Texture file %s level table is corrupted!\n", file_name);
+            break;
+        }
+
+        bool valid = true;
+        for (uint32_t i = 0; i < header->mip_count && valid; ++i) {
+            const texture_file_level *level = levels + i;
+            valid = level->offset % TEXTURE_FILE_ALIGNMENT == 0
+                && level->offset <= file.size
+                && level->size <= file.size - level->offset
+                && level->checksum == hash_bytes((const char *)file.data + level->offset, (size_t)level->size, CHECKSUM_SEED);
+        }
+        if (!valid) {
+            LOG("Texture file %s has a corrupted level!\n", file_name);
+            break;
+        }
+
+        out->file = file;
+        out->header = header;
+        out->levels = levels;
+        ret = true;
+    } while (false);
+
+    if (!ret) {
+        unmap_file(&file);
+    }
+    return ret;
+}
+
+void texture_file_close(texture_file *file) {
+    unmap_file(&(file->file));
+    file->header = NULL;
+    file->levels = NULL;
+}
+
+bool texture_file_get_chain(const texture_file *file, texture_chain *out) {
+    memset(out, 0, sizeof(texture_chain));
+    if (!file->header) {
+        return false;
+    }
+
+    const texture_file_header *header = file->header;
+    if (header->format != TEXTURE_FORMAT_RGBA8 && header->format != TEXTURE_FORMAT_BC1 && header->format != TEXTURE_FORMAT_BC3) {
+        LOG("Texture file has an unknown format!\n");
+        return false;
+    }
+
+    // levels follow each other in the file, so the chain is the span from the first level to the end
+    uint64_t first_offset = file->levels[0].offset;
+    uint32_t width = header->width;
+    uint32_t height = header->height;
+    for (uint32_t i = 0; i < header->mip_count; ++i) {
+        const texture_file_level *level = file->levels + i;
+        if (level->width != width || level->height != height
+            || level->size != texture_level_size(header->format, width, height) * header->layer_count
+            || level->offset < first_offset) {
+            LOG("Texture file level %d does not match the header!\n", i);
+            return false;
+        }
+
+        out->mips[i].width = width;
+        out->mips[i].height = height;
+        out->mips[i].offset = (size_t)(level->offset - first_offset);
+        out->mips[i].size = (size_t)level->size;
+
+        width = MAX(width / 2, 1);
+        height = MAX(height / 2, 1);
+    }
+
+    out->format = header->format;
+    out->mip_count = header->mip_count;
+    out->layer_count = header->layer_count;
+    out->data = (uint8_t *)file->file.data + first_offset;
+    out->size = (size_t)(header->file_size - first_offset);
+    out->borrowed = true;
+
+    return true;
+}
@@ -0,0 +1,58 @@
+#ifndef VK_EXAMPLE_TEXTURE_FILE_H
+#define VK_EXAMPLE_TEXTURE_FILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "example.h"
+#include "mesh_file.h"
+#include "texture_mips.h"
+
+#define TEXTURE_FILE_MAGIC MESH_FILE_FOURCC('T', 'E', 'X', 'R')
+// bump whenever the header or level layout changes, older files are rebuilt
+#define TEXTURE_FILE_VERSION 2
+// header, level table and every level start on this boundary
+#define TEXTURE_FILE_ALIGNMENT 64
+
+typedef struct texture_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t alignment;
+    uint32_t format; // texture_format
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_count;
+    uint32_t layer_count;
+    uint64_t file_size;
+    // hash of the source content the file was built from
+    uint64_t source_hash;
+    // hash of the level table, which holds the hash of every level
+    uint64_t checksum;
+} texture_file_header;
+
+// a level of an array texture holds every layer, one after the other
+typedef struct texture_file_level {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t checksum;
+} texture_file_level;
+
+typedef struct texture_file {
+    mapped_file file;
+    const texture_file_header *header;
+    const texture_file_level *levels;
+} texture_file;
+
+extern bool texture_file_write(const char *file_name, uint64_t source_hash, const texture_chain *chain);
+
+// map the file and validate its header, level table and level checksums
+extern bool texture_file_open(const char *file_name, texture_file *out);
+
+extern void texture_file_close(texture_file *file);
+
+// the levels are borrowed from the mapping and must be released before the file is closed
+extern bool texture_file_get_chain(const texture_file *file, texture_chain *out);
+
+#endif //VK_EXAMPLE_TEXTURE_FILE_H
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+#include "example.h"
+#include "texture_loader.h"
+
+struct texture_loader {
+    thread_pool *pool;
+    const texture_cook_settings *settings;
+    texture_load *loads;
+    uint32_t load_count;
+
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE load_finished;
+
+    // loads are started in queue order, each task takes the next one
+    uint32_t started_count;
+
+    // indices of finished loads in the order they finished
+    uint32_t *finished;
+    uint32_t finished_count;
+    uint32_t handed_count;
+};
+
+static bool open_cooked(const texture_loader *loader, texture_load *load, const mapped_file *source, uint64_t source_hash) {
+    if (!texture_file_open(load->bin_path, &(load->file))) {
+        return false;
+    }
+
+    // without the source there is nothing to compare against, so any valid file in the asked kind of format is used
+    if ((source->data && load->file.header->source_hash != source_hash)
+        || !texture_file_get_chain(&(load->file), &(load->chain))
+        || (load->chain.format != TEXTURE_FORMAT_RGBA8) != loader->settings->block_compress) {
+        LOG("Texture binary file %s is stale!\n", load->bin_path);
+        texture_chain_free(&(load->chain));
+        texture_file_close(&(load->file));
+        return false;
+    }
+
+    return true;
+}
+
+static void load_texture(void *data, size_t index) {
+    texture_loader *loader = data;
+
+    EnterCriticalSection(&(loader->lock));
+    texture_load *load = loader->loads + loader->started_count ++;
+    LeaveCriticalSection(&(loader->lock));
+
+    float start = high_resolution_clock_now();
+    mapped_file source = {0};
+    uint64_t source_hash = 0;
+    if (map_file(load->source_path, &source)) {
+        source_hash = texture_cook_source_hash(&source, loader->settings);
+    }
+
+    load->loaded = open_cooked(loader, load, &source, source_hash);
+    if (!load->loaded && source.data) {
+        load->cooked = true;
+        load->loaded = texture_cook(&source, loader->pool, loader->settings, &(load->chain));
+        if (load->loaded && !texture_file_write(load->bin_path, source_hash, &(load->chain))) {
+            LOG("Write texture binary file %s failed!\n", load->bin_path);
+        }
+    }
+    unmap_file(&source);
+    load->load_seconds = high_resolution_clock_now() - start;
+
+    EnterCriticalSection(&(loader->lock));
+    loader->finished[loader->finished_count ++] = (uint32_t)(load - loader->loads);
+    WakeAllConditionVariable(&(loader->load_finished));
+    LeaveCriticalSection(&(loader->lock));
+}
+
+texture_loader * texture_loader_start(thread_pool *pool, const texture_cook_settings *settings, texture_load *loads, uint32_t load_count) {
+    texture_loader *loader = calloc(1, sizeof(texture_loader));
+    uint32_t *finished = malloc(MAX(load_count, 1) * sizeof(uint32_t));
+    if (!loader || !finished) {
+        LOG("Allocate texture loader failed!\n");
+        free(loader);
+        free(finished);
+        return NULL;
+    }
+
+    loader->pool = pool;
+    loader->settings = settings;
+    loader->loads = loads;
+    loader->load_count = load_count;
+    loader->finished = finished;
+    InitializeCriticalSection(&(loader->lock));
+    InitializeConditionVariable(&(loader->load_finished));
+
+    for (uint32_t i = 0; i < load_count; ++i) {
+        texture_load *load = loads + i;
+        load->loaded = false;
+        load->cooked = false;
+        memset(&(load->chain), 0, sizeof(texture_chain));
+        memset(&(load->file), 0, sizeof(texture_file));
+        load->load_seconds = 0.0f;
+    }
+    for (uint32_t i = 0; i < load_count; ++i) {
+        thread_pool_submit(pool, load_texture, loader);
+    }
+
+    return loader;
+}
+
+texture_load * texture_loader_next(texture_loader *loader) {
+    EnterCriticalSection(&(loader->lock));
+    texture_load *load = NULL;
+    if (loader->handed_count < loader->load_count) {
+        while (loader->finished_count == loader->handed_count) {
+            SleepConditionVariableCS(&(loader->load_finished), &(loader->lock), INFINITE);
+        }
+        load = loader->loads + loader->finished[loader->handed_count ++];
+    }
+    LeaveCriticalSection(&(loader->lock));
+    return load;
+}
+
+void texture_loader_delete(texture_loader *loader) {
+    if (!loader) {
+        return;
+    }
+
+    // every task signals once it is done with the loader, so waiting for all of them keeps it alive long enough
+    EnterCriticalSection(&(loader->lock));
+    while (loader->finished_count < loader->load_count) {
+        SleepConditionVariableCS(&(loader->load_finished), &(loader->lock), INFINITE);
+    }
+    LeaveCriticalSection(&(loader->lock));
+
+    DeleteCriticalSection(&(loader->lock));
+    free(loader->finished);
+    free(loader);
+}
+
+void texture_load_release(texture_load *load) {
+    texture_chain_free(&(load->chain));
+    texture_file_close(&(load->file));
+}
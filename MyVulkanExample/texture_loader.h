@@ -0,0 +1,38 @@
+#ifndef VK_EXAMPLE_TEXTURE_LOADER_H
+#define VK_EXAMPLE_TEXTURE_LOADER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "texture_cook.h"
+#include "texture_file.h"
+#include "texture_mips.h"
+#include "thread_pool.h"
+
+// one texture to load, the cooked file is used when it matches the source, otherwise the source is cooked and the file written again
+typedef struct texture_load {
+    const char *source_path;
+    const char *bin_path;
+
+    // valid once texture_loader_next hands the load out
+    bool loaded;
+    bool cooked;         // the cooked file was missing or stale
+    texture_chain chain; // borrowed from file when it was used
+    texture_file file;
+    float load_seconds;  // spent on the worker
+} texture_load;
+
+typedef struct texture_loader texture_loader;
+
+// queue every load on the pool and return at once, loads and settings must outlive the loader
+extern texture_loader * texture_loader_start(thread_pool *pool, const texture_cook_settings *settings, texture_load *loads, uint32_t load_count);
+
+// the next load to finish, in completion order, blocks until one does and returns NULL once every load was handed out
+extern texture_load * texture_loader_next(texture_loader *loader);
+
+// waits for loads still running, the loads themselves stay with the caller
+extern void texture_loader_delete(texture_loader *loader);
+
+extern void texture_load_release(texture_load *load);
+
+#endif //VK_EXAMPLE_TEXTURE_LOADER_H
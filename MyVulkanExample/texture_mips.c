@@ -0,0 +1,230 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include "example.h"
+#include "texture_mips.h"
+
+// rows of a level filtered by one task
+static const uint32_t MIP_BAND_ROWS = 16;
+// precision of the linear to 8 bit table, 12 bits keeps dark srgb steps apart
+#define MIP_ENCODE_TABLE_SIZE 4096
+
+typedef struct mip_taps {
+    uint32_t first;
+    uint32_t count;
+    float weights[3];
+} mip_taps;
+
+typedef struct mip_pass {
+    // the level read, level 0 comes as 8 bit pixels, later ones as linear floats
+    const uint8_t *source_pixels;
+    const float *source_values;
+    uint32_t source_width;
+    uint32_t source_height;
+
+    // the level written, values is NULL for the last level
+    uint8_t *pixels;
+    float *values;
+    uint32_t width;
+    uint32_t height;
+
+    const float *decode;   // 8 bit to linear, 256 entries per channel kind
+    const uint8_t *encode; // linear to 8 bit, MIP_ENCODE_TABLE_SIZE entries per channel kind
+} mip_pass;
+
+uint32_t texture_mip_count(uint32_t width, uint32_t height) {
+    uint32_t length = MAX(MAX(width, height), 1);
+    uint32_t count = 1;
+    while (length > 1 && count < TEXTURE_MAX_MIPS) {
+        length /= 2;
+        ++ count;
+    }
+    return count;
+}
+
+size_t texture_level_size(texture_format format, uint32_t width, uint32_t height) {
+    size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+    case TEXTURE_FORMAT_BC1:
+        return blocks * 8;
+    case TEXTURE_FORMAT_BC3:
+        return blocks * 16;
+    default:
+        return (size_t)width * height * 4;
+    }
+}
+
+size_t texture_mip_layout(texture_format format, uint32_t width, uint32_t height, uint32_t mip_count, texture_mip *mips) {
+    size_t offset = 0;
+    for (uint32_t i = 0; i < mip_count; ++i) {
+        mips[i].width = width;
+        mips[i].height = height;
+        mips[i].offset = offset;
+        mips[i].size = texture_level_size(format, width, height);
+        offset += mips[i].size;
+
+        width = MAX(width / 2, 1);
+        height = MAX(height / 2, 1);
+    }
+    return offset;
+}
+
+// source texels covered by destination texel i, an odd source of 2n + 1 texels spreads n + 1/2 of them over each side
+static void get_taps(uint32_t source, uint32_t destination, uint32_t i, mip_taps *taps) {
+    if (source == 1) {
+        taps->first = 0;
+        taps->count = 1;
+        taps->weights[0] = 1.0f;
+    } else if (source % 2 == 0) {
+        taps->first = 2 * i;
+        taps->count = 2;
+        taps->weights[0] = 0.5f;
+        taps->weights[1] = 0.5f;
+    } else {
+        float scale = 1.0f / source;
+        taps->first = 2 * i;
+        taps->count = 3;
+        taps->weights[0] = (destination - i) * scale;
+        taps->weights[1] = destination * scale;
+        taps->weights[2] = (i + 1) * scale;
+    }
+}
+
+static __m128 load_texel(const mip_pass *pass, uint32_t x, uint32_t y) {
+    size_t index = (size_t)y * pass->source_width + x;
+    if (pass->source_values) {
+        return _mm_loadu_ps(pass->source_values + index * 4);
+    }
+
+    // alpha is coverage, never srgb encoded
+    const uint8_t *texel = pass->source_pixels + index * 4;
+    return _mm_setr_ps(pass->decode[texel[0]], pass->decode[texel[1]], pass->decode[texel[2]], pass->decode[256 + texel[3]]);
+}
+
+static void filter_band(void *data, size_t band) {
+    const mip_pass *pass = data;
+    uint32_t first_row = (uint32_t)band * MIP_BAND_ROWS;
+    uint32_t end_row = MIN(first_row + MIP_BAND_ROWS, pass->height);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 table_scale = _mm_set1_ps(MIP_ENCODE_TABLE_SIZE - 1);
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    mip_taps row_taps;
+    mip_taps column_taps;
+    for (uint32_t y = first_row; y < end_row; ++y) {
+        get_taps(pass->source_height, pass->height, y, &row_taps);
+        for (uint32_t x = 0; x < pass->width; ++x) {
+            get_taps(pass->source_width, pass->width, x, &column_taps);
+
+            __m128 sum = zero;
+            for (uint32_t j = 0; j < row_taps.count; ++j) {
+                __m128 row = zero;
+                for (uint32_t i = 0; i < column_taps.count; ++i) {
+                    __m128 texel = load_texel(pass, column_taps.first + i, row_taps.first + j);
+                    row = _mm_add_ps(row, _mm_mul_ps(texel, _mm_set1_ps(column_taps.weights[i])));
+                }
+                sum = _mm_add_ps(sum, _mm_mul_ps(row, _mm_set1_ps(row_taps.weights[j])));
+            }
+
+            size_t index = (size_t)y * pass->width + x;
+            if (pass->values) {
+                _mm_storeu_ps(pass->values + index * 4, sum);
+            }
+
+            // table index per channel, rounded and clamped
+            __m128i slots = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_min_ps(_mm_max_ps(sum, zero), one), table_scale), half));
+            uint32_t slot[4];
+            _mm_storeu_si128((__m128i *)slot, slots);
+            uint8_t *texel = pass->pixels + index * 4;
+            texel[0] = pass->encode[slot[0]];
+            texel[1] = pass->encode[slot[1]];
+            texel[2] = pass->encode[slot[2]];
+            texel[3] = pass->encode[MIP_ENCODE_TABLE_SIZE + slot[3]];
+        }
+    }
+}
+
+static float srgb_to_linear(float value) {
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_srgb(float value) {
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+bool texture_build_mips(const uint8_t *pixels, const texture_mip *mips, uint32_t mip_count, bool srgb, thread_pool *pool, uint8_t *chain) {
+    if (mip_count == 0) {
+        return false;
+    }
+    memcpy(chain + mips[0].offset, pixels, mips[0].size);
+    if (mip_count == 1) {
+        return true;
+    }
+
+    // levels after the first are kept as floats for the next one, two slots are enough since every level is smaller than the one before
+    size_t slot_sizes[2] = {
+        (size_t)mips[1].width * mips[1].height * 4,
+        mip_count > 3 ? (size_t)mips[2].width * mips[2].height * 4 : 0
+    };
+    float *values = malloc((slot_sizes[0] + slot_sizes[1]) * sizeof(float));
+    float *decode = malloc(2 * 256 * sizeof(float));
+    uint8_t *encode = malloc(2 * MIP_ENCODE_TABLE_SIZE);
+    if (!values || !decode || !encode) {
+        LOG("Allocate mip buffers failed!\n");
+        free(values);
+        free(decode);
+        free(encode);
+        return false;
+    }
+
+    // first half of each table is for color, second half for alpha
+    for (uint32_t i = 0; i < 256; ++i) {
+        decode[i] = srgb ? srgb_to_linear(i / 255.0f) : i / 255.0f;
+        decode[256 + i] = i / 255.0f;
+    }
+    for (uint32_t i = 0; i < MIP_ENCODE_TABLE_SIZE; ++i) {
+        float value = i / (float)(MIP_ENCODE_TABLE_SIZE - 1);
+        encode[i] = (uint8_t)(255.0f * (srgb ? linear_to_srgb(value) : value) + 0.5f);
+        encode[MIP_ENCODE_TABLE_SIZE + i] = (uint8_t)(255.0f * value + 0.5f);
+    }
+
+    mip_pass pass = {
+        .source_pixels = pixels,
+        .source_values = NULL,
+        .source_width = mips[0].width,
+        .source_height = mips[0].height,
+        .decode = decode,
+        .encode = encode
+    };
+    for (uint32_t i = 1; i < mip_count; ++i) {
+        pass.pixels = chain + mips[i].offset;
+        pass.values = i + 1 < mip_count ? values + (i % 2 ? 0 : slot_sizes[0]) : NULL;
+        pass.width = mips[i].width;
+        pass.height = mips[i].height;
+
+        thread_pool_parallel_for(pool, (pass.height + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS, filter_band, &pass);
+
+        pass.source_pixels = NULL;
+        pass.source_values = pass.values;
+        pass.source_width = pass.width;
+        pass.source_height = pass.height;
+    }
+
+    free(values);
+    free(decode);
+    free(encode);
+    return true;
+}
+
+void texture_chain_free(texture_chain *chain) {
+    if (!chain->borrowed) {
+        free(chain->data);
+    }
+    memset(chain, 0, sizeof(texture_chain));
+}
@@ -0,0 +1,59 @@
+#ifndef VK_EXAMPLE_TEXTURE_MIPS_H
+#define VK_EXAMPLE_TEXTURE_MIPS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "thread_pool.h"
+
+// enough for a 32768 texel wide texture
+#define TEXTURE_MAX_MIPS 16
+
+typedef enum texture_format {
+    TEXTURE_FORMAT_RGBA8 = 0,
+    // 4x4 blocks of 8 bytes, opaque color
+    TEXTURE_FORMAT_BC1 = 1,
+    // 4x4 blocks of 16 bytes, color and alpha
+    TEXTURE_FORMAT_BC3 = 2
+} texture_format;
+
+// one level of a chain of levels stored back to back
+typedef struct texture_mip {
+    uint32_t width;
+    uint32_t height;
+    size_t offset;
+    size_t size;
+} texture_mip;
+
+// every level of a texture in one buffer, as cooked or as read from a texture_file,
+// a level of an array holds all its layers back to back and its size covers them all
+typedef struct texture_chain {
+    texture_format format;
+    uint32_t mip_count;
+    uint32_t layer_count;
+    texture_mip mips[TEXTURE_MAX_MIPS];
+    uint8_t *data;
+    size_t size;
+
+    // data points into a texture_file mapping instead of the heap
+    bool borrowed;
+} texture_chain;
+
+// levels of a full chain down to 1x1, capped at TEXTURE_MAX_MIPS
+extern uint32_t texture_mip_count(uint32_t width, uint32_t height);
+
+// bytes of one level, block formats round the size up to whole blocks
+extern size_t texture_level_size(texture_format format, uint32_t width, uint32_t height);
+
+// fill mips with the layout of a tightly packed chain and return its size in bytes
+extern size_t texture_mip_layout(texture_format format, uint32_t width, uint32_t height, uint32_t mip_count, texture_mip *mips);
+
+// write every level of the chain to chain, level 0 is a copy of pixels, each level after is a box filter of the one before,
+// odd sizes get exact three tap weights, filtering happens on linear values and srgb decodes and encodes the color channels around it,
+// chain is only written, so it may be mapped staging memory
+extern bool texture_build_mips(const uint8_t *pixels, const texture_mip *mips, uint32_t mip_count, bool srgb, thread_pool *pool, uint8_t *chain);
+
+extern void texture_chain_free(texture_chain *chain);
+
+#endif //VK_EXAMPLE_TEXTURE_MIPS_H
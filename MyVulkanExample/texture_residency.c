@@ -0,0 +1,101 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "texture_residency.h"
+
+void texture_residency_init(texture_residency *texture, const texture_chain *chain, size_t tail_size) {
+    memset(texture, 0, sizeof(texture_residency));
+    texture->mip_count = chain->mip_count;
+    for (uint32_t i = 0; i < chain->mip_count; ++i) {
+        texture->level_sizes[i] = chain->mips[i].size;
+    }
+
+    texture->resident_level = chain->mip_count ? chain->mip_count - 1 : 0;
+    while (texture->resident_level > 0 && texture_residency_size(texture, texture->resident_level - 1) <= tail_size) {
+        -- texture->resident_level;
+    }
+}
+
+size_t texture_residency_size(const texture_residency *texture, uint32_t level) {
+    size_t size = 0;
+    for (uint32_t i = level; i < texture->mip_count; ++i) {
+        size += texture->level_sizes[i];
+    }
+    return size;
+}
+
+size_t texture_residency_total(const texture_residency *textures, uint32_t count) {
+    size_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        total += texture_residency_size(textures + i, textures[i].resident_level);
+    }
+    return total;
+}
+
+static bool is_idle(const texture_residency *texture, uint64_t frame, uint32_t idle_frames) {
+    return frame > texture->last_used_frame + idle_frames;
+}
+
+bool texture_residency_next(const texture_residency *textures, uint32_t count, size_t budget, uint64_t frame, uint32_t idle_frames, uint32_t *index, uint32_t *level) {
+    size_t total = texture_residency_total(textures, count);
+    bool over_budget = total > budget;
+
+    // least recently used texture with a level to drop, over budget textures in use are dropped as well
+    uint32_t victim = UINT32_MAX;
+    size_t reclaimable = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const texture_residency *texture = textures + i;
+        if (texture->resident_level + 1 >= texture->mip_count || (!over_budget && !is_idle(texture, frame, idle_frames))) {
+            continue;
+        }
+        if (victim == UINT32_MAX || texture->last_used_frame < textures[victim].last_used_frame) {
+            victim = i;
+        }
+        reclaimable += texture_residency_size(texture, texture->resident_level) - texture->level_sizes[texture->mip_count - 1];
+    }
+
+    if (over_budget) {
+        if (victim == UINT32_MAX) {
+            return false;
+        }
+        *index = victim;
+        *level = textures[victim].resident_level + 1;
+        return true;
+    }
+
+    // most recently used texture short of full detail, the blurriest of those first
+    uint32_t grown = UINT32_MAX;
+    for (uint32_t i = 0; i < count; ++i) {
+        const texture_residency *texture = textures + i;
+        if (texture->resident_level == 0 || is_idle(texture, frame, idle_frames)) {
+            continue;
+        }
+        if (grown == UINT32_MAX || texture->last_used_frame > textures[grown].last_used_frame
+            || (texture->last_used_frame == textures[grown].last_used_frame && texture->resident_level > textures[grown].resident_level)) {
+            grown = i;
+        }
+    }
+    if (grown == UINT32_MAX) {
+        return false;
+    }
+
+    const texture_residency *texture = textures + grown;
+    size_t cost = texture->level_sizes[texture->resident_level - 1];
+    if (total + cost <= budget) {
+        *index = grown;
+        *level = texture->resident_level - 1;
+        return true;
+    }
+
+    // idle textures are never the one grown, so this makes room without undoing the growth,
+    // nothing is dropped when dropping all it could would still not be enough
+    if (victim != UINT32_MAX && total - reclaimable + cost <= budget) {
+        *index = victim;
+        *level = textures[victim].resident_level + 1;
+        return true;
+    }
+    return false;
+}
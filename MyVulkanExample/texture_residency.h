@@ -0,0 +1,32 @@
+#ifndef VK_EXAMPLE_TEXTURE_RESIDENCY_H
+#define VK_EXAMPLE_TEXTURE_RESIDENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "texture_mips.h"
+
+// which levels of a streamed texture are in video memory, always a tail from resident_level down to the last level
+typedef struct texture_residency {
+    uint32_t mip_count;
+    size_t level_sizes[TEXTURE_MAX_MIPS];
+    uint32_t resident_level;
+    uint64_t last_used_frame;
+} texture_residency;
+
+// start with the longest tail of chain that fits in tail_size bytes, at least the last level
+extern void texture_residency_init(texture_residency *texture, const texture_chain *chain, size_t tail_size);
+
+// bytes of the levels from level down to the last one
+extern size_t texture_residency_size(const texture_residency *texture, uint32_t level);
+
+// bytes resident over all textures
+extern size_t texture_residency_total(const texture_residency *textures, uint32_t count);
+
+// the next single level change that keeps the textures within budget, false when there is none:
+// over budget the least recently used texture drops its finest level, otherwise the most recently used texture short of level 0
+// gets its next level, making room by dropping levels of textures not used for more than idle_frames, least recently used first
+extern bool texture_residency_next(const texture_residency *textures, uint32_t count, size_t budget, uint64_t frame, uint32_t idle_frames, uint32_t *index, uint32_t *level);
+
+#endif //VK_EXAMPLE_TEXTURE_RESIDENCY_H
@@ -0,0 +1,244 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "thread_pool.h"
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+// every parallel_for is cut into a few batches per worker to balance uneven tasks
+static const size_t BATCHES_PER_THREAD = 4;
+
+typedef struct thread_pool_job {
+    thread_pool_task task;
+    void *data;
+    size_t begin;
+    size_t end;
+    size_t *remaining; // owned by the parallel_for caller, NULL for submitted tasks
+} thread_pool_job;
+
+struct thread_pool {
+    HANDLE *threads;
+    uint32_t thread_count;
+
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE job_available;
+    CONDITION_VARIABLE job_finished;
+
+    // ring buffer of pending jobs
+    thread_pool_job *jobs;
+    size_t job_capacity;
+    size_t job_head;
+    size_t job_count;
+
+    uint32_t active_count;
+    bool quit;
+};
+
+// false when the queue could not grow, the caller runs the job itself then
+static bool push_job(thread_pool *pool, const thread_pool_job *job) {
+    if (pool->job_count == pool->job_capacity) {
+        size_t capacity = pool->job_capacity ? pool->job_capacity * 2 : 64;
+        thread_pool_job *jobs = malloc(capacity * sizeof(thread_pool_job));
+        if (!jobs) {
+            LOG("Allocate thread pool jobs failed!\n");
+            return false;
+        }
+        for (size_t i = 0; i < pool->job_count; ++i) {
+            jobs[i] = pool->jobs[(pool->job_head + i) % pool->job_capacity];
+        }
+        free(pool->jobs);
+        pool->jobs = jobs;
+        pool->job_capacity = capacity;
+        pool->job_head = 0;
+    }
+
+    pool->jobs[(pool->job_head + pool->job_count) % pool->job_capacity] = *job;
+    ++ pool->job_count;
+    return true;
+}
+
+static thread_pool_job pop_job(thread_pool *pool) {
+    thread_pool_job job = pool->jobs[pool->job_head];
+    pool->job_head = (pool->job_head + 1) % pool->job_capacity;
+    -- pool->job_count;
+    return job;
+}
+
+// called with the lock held, releases it while the job runs
+static void run_job(thread_pool *pool, thread_pool_job job) {
+    ++ pool->active_count;
+    LeaveCriticalSection(&(pool->lock));
+
+    for (size_t i = job.begin; i < job.end; ++i) {
+        job.task(job.data, i);
+    }
+
+    EnterCriticalSection(&(pool->lock));
+    -- pool->active_count;
+    if (job.remaining) {
+        -- *(job.remaining);
+    }
+    WakeAllConditionVariable(&(pool->job_finished));
+}
+
+static DWORD WINAPI worker_main(LPVOID param) {
+    thread_pool *pool = param;
+
+    EnterCriticalSection(&(pool->lock));
+    while (true) {
+        while (!pool->quit && pool->job_count == 0) {
+            SleepConditionVariableCS(&(pool->job_available), &(pool->lock), INFINITE);
+        }
+
+        if (pool->job_count == 0) {
+            break;
+        }
+
+        run_job(pool, pop_job(pool));
+    }
+    LeaveCriticalSection(&(pool->lock));
+
+    return 0;
+}
+
+thread_pool * thread_pool_new(uint32_t thread_count) {
+    if (thread_count == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        thread_count = MAX(info.dwNumberOfProcessors, 1);
+    }
+
+    thread_pool *pool = calloc(1, sizeof(thread_pool));
+    if (!pool) {
+        LOG("Allocate thread pool failed!\n");
+        return NULL;
+    }
+
+    InitializeCriticalSection(&(pool->lock));
+    InitializeConditionVariable(&(pool->job_available));
+    InitializeConditionVariable(&(pool->job_finished));
+
+    // without workers every task runs on the calling thread
+    pool->threads = malloc(thread_count * sizeof(HANDLE));
+    if (!pool->threads) {
+        LOG("Allocate worker threads failed!\n");
+        thread_count = 0;
+    }
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        HANDLE thread = CreateThread(NULL, 0, worker_main, pool, 0, NULL);
+        if (!thread) {
+            LOG("Create worker thread %d failed!\n", i);
+            break;
+        }
+        pool->threads[pool->thread_count ++] = thread;
+    }
+
+    return pool;
+}
+
+void thread_pool_delete(thread_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    EnterCriticalSection(&(pool->lock));
+    pool->quit = true;
+    WakeAllConditionVariable(&(pool->job_available));
+    LeaveCriticalSection(&(pool->lock));
+
+    for (uint32_t i = 0; i < pool->thread_count; ++i) {
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+    }
+
+    DeleteCriticalSection(&(pool->lock));
+    free(pool->threads);
+    free(pool->jobs);
+    free(pool);
+}
+
+uint32_t thread_pool_size(const thread_pool *pool) {
+    return pool ? pool->thread_count : 0;
+}
+
+void thread_pool_parallel_for(thread_pool *pool, size_t count, thread_pool_task task, void *data) {
+    if (!pool || pool->thread_count == 0 || count < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            task(data, i);
+        }
+        return;
+    }
+
+    size_t batch_count = MIN(count, (size_t)pool->thread_count * BATCHES_PER_THREAD);
+    size_t remaining = batch_count;
+
+    EnterCriticalSection(&(pool->lock));
+    for (size_t i = 0; i < batch_count; ++i) {
+        thread_pool_job job = {
+            .task = task,
+            .data = data,
+            .begin = count * i / batch_count,
+            .end = count * (i + 1) / batch_count,
+            .remaining = &remaining
+        };
+        if (!push_job(pool, &job)) {
+            run_job(pool, job);
+        }
+    }
+    WakeAllConditionVariable(&(pool->job_available));
+
+    // help instead of blocking, which also keeps nested parallel_for calls from deadlocking
+    while (remaining > 0) {
+        if (pool->job_count > 0) {
+            run_job(pool, pop_job(pool));
+        } else {
+            SleepConditionVariableCS(&(pool->job_finished), &(pool->lock), INFINITE);
+        }
+    }
+    LeaveCriticalSection(&(pool->lock));
+}
+
+void thread_pool_submit(thread_pool *pool, thread_pool_task task, void *data) {
+    if (!pool || pool->thread_count == 0) {
+        task(data, 0);
+        return;
+    }
+
+    thread_pool_job job = {
+        .task = task,
+        .data = data,
+        .begin = 0,
+        .end = 1,
+        .remaining = NULL
+    };
+
+    EnterCriticalSection(&(pool->lock));
+    bool pushed = push_job(pool, &job);
+    WakeConditionVariable(&(pool->job_available));
+    LeaveCriticalSection(&(pool->lock));
+
+    if (!pushed) {
+        task(data, 0);
+    }
+}
+
+void thread_pool_wait(thread_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    EnterCriticalSection(&(pool->lock));
+    while (pool->job_count > 0 || pool->active_count > 0) {
+        if (pool->job_count > 0) {
+            run_job(pool, pop_job(pool));
+        } else {
+            SleepConditionVariableCS(&(pool->job_finished), &(pool->lock), INFINITE);
+        }
+    }
+    LeaveCriticalSection(&(pool->lock));
+}
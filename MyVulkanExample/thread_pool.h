@@ -0,0 +1,27 @@
+#ifndef VK_EXAMPLE_THREAD_POOL_H
+#define VK_EXAMPLE_THREAD_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct thread_pool thread_pool;
+
+typedef void (*thread_pool_task)(void *data, size_t index);
+
+// thread_count 0 creates one worker per logical processor
+extern thread_pool * thread_pool_new(uint32_t thread_count);
+
+extern void thread_pool_delete(thread_pool *pool);
+
+extern uint32_t thread_pool_size(const thread_pool *pool);
+
+// call task(data, i) for every i in [0, count), the caller helps and returns when all calls finished
+extern void thread_pool_parallel_for(thread_pool *pool, size_t count, thread_pool_task task, void *data);
+
+// queue task(data, 0) and return immediately
+extern void thread_pool_submit(thread_pool *pool, thread_pool_task task, void *data);
+
+// help with queued tasks until the queue is drained and every worker is idle
+extern void thread_pool_wait(thread_pool *pool);
+
+#endif //VK_EXAMPLE_THREAD_POOL_H
@@ -0,0 +1,321 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "virtual_texture.h"
+
+const virtual_texture_settings virtual_texture_default_settings = {
+    .page_size = 128,
+    .border = 4,
+    .cache_columns = 16,
+    .cache_rows = 16
+};
+
+static bool is_power_of_two(uint32_t value) {
+    return value && !(value & (value - 1));
+}
+
+// texels on a block side and bytes of a block, a texel is a block of rgba8
+static void get_block_layout(texture_format format, uint32_t *block_size, uint32_t *block_bytes) {
+    switch (format) {
+    case TEXTURE_FORMAT_BC1:
+        *block_size = 4;
+        *block_bytes = 8;
+        break;
+    case TEXTURE_FORMAT_BC3:
+        *block_size = 4;
+        *block_bytes = 16;
+        break;
+    default:
+        *block_size = 1;
+        *block_bytes = 4;
+        break;
+    }
+}
+
+bool virtual_texture_init(virtual_texture *texture, const texture_chain *chain, const virtual_texture_settings *settings) {
+    memset(texture, 0, sizeof(virtual_texture));
+    texture->settings = *settings;
+    texture->chain = chain;
+
+    uint32_t block_size, block_bytes;
+    get_block_layout(chain->format, &block_size, &block_bytes);
+    uint32_t width = chain->mips[0].width;
+    uint32_t height = chain->mips[0].height;
+    if (chain->layer_count != 1 || !is_power_of_two(settings->page_size) || settings->page_size % block_size || settings->border % block_size
+        || !is_power_of_two(width) || !is_power_of_two(height) || width < settings->page_size || height < settings->page_size
+        || settings->cache_columns > 256 || settings->cache_rows > 256) {
+        LOG("Texture of %dx%d can not be paged!\n", width, height);
+        return false;
+    }
+
+    uint32_t columns = width / settings->page_size;
+    uint32_t rows = height / settings->page_size;
+    while (texture->level_count < chain->mip_count) {
+        uint32_t level = texture->level_count ++;
+        texture->page_columns[level] = columns;
+        texture->page_rows[level] = rows;
+        texture->first_page[level] = texture->page_count;
+        texture->page_count += columns * rows;
+        if (columns == 1 || rows == 1) {
+            break;
+        }
+        columns /= 2;
+        rows /= 2;
+    }
+
+    uint32_t last = texture->level_count - 1;
+    texture->slot_count = settings->cache_columns * settings->cache_rows;
+    if (texture->page_columns[last] * texture->page_rows[last] >= texture->slot_count) {
+        LOG("Page cache of %d pages is too small!\n", texture->slot_count);
+        return false;
+    }
+
+    texture->page_slots = malloc(texture->page_count * sizeof(uint32_t));
+    texture->page_frames = calloc(texture->page_count, sizeof(uint64_t));
+    texture->slot_pages = malloc(texture->slot_count * sizeof(uint32_t));
+    texture->slot_frames = calloc(texture->slot_count, sizeof(uint64_t));
+    texture->pending_slots = malloc(texture->slot_count * sizeof(uint32_t));
+    texture->requests = malloc(texture->page_count * sizeof(uint32_t));
+    texture->table_size = texture->page_count;
+    texture->table = calloc(texture->table_size, sizeof(uint32_t));
+    if (!texture->page_slots || !texture->page_frames || !texture->slot_pages || !texture->slot_frames || !texture->pending_slots || !texture->requests || !texture->table) {
+        LOG("Allocate virtual texture failed!\n");
+        virtual_texture_free(texture);
+        return false;
+    }
+
+    memset(texture->page_slots, 0xff, texture->page_count * sizeof(uint32_t));
+    memset(texture->slot_pages, 0xff, texture->slot_count * sizeof(uint32_t));
+    return true;
+}
+
+void virtual_texture_free(virtual_texture *texture) {
+    free(texture->page_slots);
+    free(texture->page_frames);
+    free(texture->slot_pages);
+    free(texture->slot_frames);
+    free(texture->pending_slots);
+    free(texture->requests);
+    free(texture->table);
+    memset(texture, 0, sizeof(virtual_texture));
+}
+
+size_t virtual_texture_page_bytes(const virtual_texture *texture) {
+    uint32_t block_size, block_bytes;
+    get_block_layout(texture->chain->format, &block_size, &block_bytes);
+    uint32_t blocks = (texture->settings.page_size + 2 * texture->settings.border) / block_size;
+    return (size_t)blocks * blocks * block_bytes;
+}
+
+uint32_t virtual_texture_cache_width(const virtual_texture *texture) {
+    return texture->settings.cache_columns * (texture->settings.page_size + 2 * texture->settings.border);
+}
+
+uint32_t virtual_texture_cache_height(const virtual_texture *texture) {
+    return texture->settings.cache_rows * (texture->settings.page_size + 2 * texture->settings.border);
+}
+
+static uint32_t page_index(const virtual_texture *texture, uint32_t level, uint32_t x, uint32_t y) {
+    return texture->first_page[level] + y * texture->page_columns[level] + x;
+}
+
+static uint32_t page_level(const virtual_texture *texture, uint32_t page) {
+    uint32_t level = 0;
+    while (level + 1 < texture->level_count && page >= texture->first_page[level + 1]) {
+        ++ level;
+    }
+    return level;
+}
+
+// coarser levels come later in the page arrays, so the larger index goes first
+static int compare_requests(const void *a, const void *b) {
+    uint32_t page_a = *(const uint32_t *)a;
+    uint32_t page_b = *(const uint32_t *)b;
+    return page_a == page_b ? 0 : (page_a > page_b ? -1 : 1);
+}
+
+void virtual_texture_feedback(virtual_texture *texture, const uint32_t *pages, uint32_t count, uint64_t frame) {
+    texture->request_count = 0;
+    texture->next_request = 0;
+
+    uint32_t previous = VIRTUAL_TEXTURE_NO_PAGE;
+    for (uint32_t i = 0; i < count; ++i) {
+        // neighboring texels mostly ask for the same page
+        if (pages[i] == VIRTUAL_TEXTURE_NO_PAGE || pages[i] == previous) {
+            continue;
+        }
+        previous = pages[i];
+
+        uint32_t level = pages[i] >> 24;
+        uint32_t x = pages[i] & 0xfff;
+        uint32_t y = (pages[i] >> 12) & 0xfff;
+        if (level >= texture->level_count || x >= texture->page_columns[level] || y >= texture->page_rows[level]) {
+            continue;
+        }
+
+        // from the page up, the coarsest missing page is the one to load next
+        uint32_t missing = VIRTUAL_TEXTURE_NO_PAGE;
+        for (; level < texture->level_count; ++level, x /= 2, y /= 2) {
+            uint32_t page = page_index(texture, level, x, y);
+            uint32_t slot = texture->page_slots[page];
+            if (slot == VIRTUAL_TEXTURE_NO_PAGE) {
+                missing = page;
+            } else if (texture->slot_frames[slot] == frame) {
+                // ancestors were marked by an earlier texel
+                break;
+            } else {
+                texture->slot_frames[slot] = frame;
+            }
+        }
+
+        if (missing != VIRTUAL_TEXTURE_NO_PAGE && texture->page_frames[missing] != frame) {
+            texture->page_frames[missing] = frame;
+            texture->requests[texture->request_count ++] = missing;
+        }
+    }
+
+    qsort(texture->requests, texture->request_count, sizeof(uint32_t), compare_requests);
+}
+
+static void map_page(virtual_texture *texture, uint32_t page, uint32_t slot) {
+    uint32_t evicted = texture->slot_pages[slot];
+    if (evicted != VIRTUAL_TEXTURE_NO_PAGE) {
+        texture->page_slots[evicted] = VIRTUAL_TEXTURE_NO_PAGE;
+    }
+    texture->slot_pages[slot] = page;
+    texture->page_slots[page] = slot;
+    texture->table_dirty = true;
+}
+
+bool virtual_texture_next(virtual_texture *texture, uint64_t frame, uint32_t *level, uint32_t *x, uint32_t *y, uint32_t *slot) {
+    uint32_t tail = texture->first_page[texture->level_count - 1];
+    while (texture->next_request < texture->request_count) {
+        uint32_t page = texture->requests[texture->next_request ++];
+        if (texture->page_slots[page] != VIRTUAL_TEXTURE_NO_PAGE) {
+            continue;
+        }
+
+        // a free slot, otherwise the least recently used one outside the coarsest level and the last feedback
+        uint32_t found = VIRTUAL_TEXTURE_NO_PAGE;
+        for (uint32_t i = 0; i < texture->slot_count; ++i) {
+            uint32_t resident = texture->slot_pages[i];
+            if (resident == VIRTUAL_TEXTURE_NO_PAGE) {
+                found = i;
+                break;
+            }
+            if (resident >= tail || texture->slot_frames[i] >= frame) {
+                continue;
+            }
+            if (found == VIRTUAL_TEXTURE_NO_PAGE || texture->slot_frames[i] < texture->slot_frames[found]) {
+                found = i;
+            }
+        }
+        if (found == VIRTUAL_TEXTURE_NO_PAGE) {
+            return false;
+        }
+
+        map_page(texture, page, found);
+        texture->slot_frames[found] = frame;
+        if (texture->pending_count < texture->slot_count) {
+            texture->pending_slots[texture->pending_count ++] = found;
+        }
+        *level = page_level(texture, page);
+        uint32_t index = page - texture->first_page[*level];
+        *x = index % texture->page_columns[*level];
+        *y = index / texture->page_columns[*level];
+        *slot = found;
+        return true;
+    }
+    return false;
+}
+
+void virtual_texture_commit(virtual_texture *texture) {
+    texture->pending_count = 0;
+}
+
+void virtual_texture_cancel(virtual_texture *texture) {
+    for (uint32_t i = 0; i < texture->pending_count; ++i) {
+        uint32_t slot = texture->pending_slots[i];
+        uint32_t page = texture->slot_pages[slot];
+        if (page != VIRTUAL_TEXTURE_NO_PAGE) {
+            texture->page_slots[page] = VIRTUAL_TEXTURE_NO_PAGE;
+            texture->page_frames[page] = 0;
+        }
+        texture->slot_pages[slot] = VIRTUAL_TEXTURE_NO_PAGE;
+        texture->slot_frames[slot] = 0;
+    }
+    texture->table_dirty = texture->table_dirty || texture->pending_count;
+    texture->pending_count = 0;
+}
+
+void virtual_texture_request_tail(virtual_texture *texture) {
+    texture->request_count = 0;
+    texture->next_request = 0;
+    for (uint32_t page = texture->first_page[texture->level_count - 1]; page < texture->page_count; ++page) {
+        texture->requests[texture->request_count ++] = page;
+    }
+}
+
+void virtual_texture_copy_page(const virtual_texture *texture, uint32_t level, uint32_t x, uint32_t y, uint8_t *page) {
+    uint32_t block_size, block_bytes;
+    get_block_layout(texture->chain->format, &block_size, &block_bytes);
+    const texture_mip *mip = texture->chain->mips + level;
+    const uint8_t *data = texture->chain->data + mip->offset;
+    int32_t level_columns = (int32_t)((mip->width + block_size - 1) / block_size);
+    int32_t level_rows = (int32_t)((mip->height + block_size - 1) / block_size);
+
+    // in blocks, the border is block aligned so it never splits one
+    int32_t border = (int32_t)(texture->settings.border / block_size);
+    int32_t size = (int32_t)(texture->settings.page_size / block_size);
+    int32_t left = (int32_t)x * size - border;
+    int32_t top = (int32_t)y * size - border;
+    int32_t blocks = size + 2 * border;
+    for (int32_t row = 0; row < blocks; ++row) {
+        int32_t source_row = MIN(MAX(top + row, 0), level_rows - 1);
+        const uint8_t *source = data + (size_t)source_row * level_columns * block_bytes;
+        uint8_t *target = page + (size_t)row * blocks * block_bytes;
+
+        // the inner run is one copy, border blocks past an edge repeat it
+        int32_t first = MAX(left, 0);
+        int32_t last = MIN(left + blocks, level_columns);
+        memcpy(target + (size_t)(first - left) * block_bytes, source + (size_t)first * block_bytes, (size_t)(last - first) * block_bytes);
+        for (int32_t column = left; column < first; ++column) {
+            memcpy(target + (size_t)(column - left) * block_bytes, source, block_bytes);
+        }
+        for (int32_t column = last; column < left + blocks; ++column) {
+            memcpy(target + (size_t)(column - left) * block_bytes, source + (size_t)(level_columns - 1) * block_bytes, block_bytes);
+        }
+    }
+}
+
+bool virtual_texture_update_table(virtual_texture *texture) {
+    if (!texture->table_dirty) {
+        return false;
+    }
+
+    // coarsest first, so a missing page can take the entry of its parent
+    for (uint32_t level = texture->level_count; level-- > 0;) {
+        for (uint32_t y = 0; y < texture->page_rows[level]; ++y) {
+            for (uint32_t x = 0; x < texture->page_columns[level]; ++x) {
+                uint32_t page = page_index(texture, level, x, y);
+                uint32_t slot = texture->page_slots[page];
+                if (slot != VIRTUAL_TEXTURE_NO_PAGE) {
+                    uint32_t slot_x = slot % texture->settings.cache_columns;
+                    uint32_t slot_y = slot / texture->settings.cache_columns;
+                    texture->table[page] = slot_x | (slot_y << 8) | (level << 16) | (0xffu << 24);
+                } else if (level + 1 < texture->level_count) {
+                    texture->table[page] = texture->table[page_index(texture, level + 1, x / 2, y / 2)];
+                } else {
+                    // only before the coarsest level is mapped, nothing samples the table then
+                    texture->table[page] = level << 16;
+                }
+            }
+        }
+    }
+
+    texture->table_dirty = false;
+    return true;
+}
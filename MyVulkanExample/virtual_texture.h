@@ -0,0 +1,94 @@
+#ifndef VK_EXAMPLE_VIRTUAL_TEXTURE_H
+#define VK_EXAMPLE_VIRTUAL_TEXTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "texture_mips.h"
+
+// a page of a level as the feedback pass writes it, texels the pass did not cover hold VIRTUAL_TEXTURE_NO_PAGE
+#define VIRTUAL_TEXTURE_PAGE(level, x, y) (((uint32_t)(level) << 24) | ((uint32_t)(y) << 12) | (uint32_t)(x))
+#define VIRTUAL_TEXTURE_NO_PAGE UINT32_MAX
+
+typedef struct virtual_texture_settings {
+    // texels of a page side without its border, a power of two and a multiple of 4 for block formats
+    uint32_t page_size;
+    // texels repeated around every page so filtering never reads a neighbor in the cache, a multiple of 4 for block formats
+    uint32_t border;
+    // pages in a row and a column of the cache image, at most 256 each since the page table holds 8 bit slots
+    uint32_t cache_columns;
+    uint32_t cache_rows;
+} virtual_texture_settings;
+
+extern const virtual_texture_settings virtual_texture_default_settings;
+
+// which pages of a texture chain sit in which slot of a fixed cache, the chain is paged from level 0 down to the
+// first level covered by a single row or column of pages, which is resident all the time
+typedef struct virtual_texture {
+    virtual_texture_settings settings;
+    const texture_chain *chain;
+    uint32_t level_count;
+    uint32_t page_columns[TEXTURE_MAX_MIPS];
+    uint32_t page_rows[TEXTURE_MAX_MIPS];
+    uint32_t first_page[TEXTURE_MAX_MIPS]; // of every level in the page arrays
+    uint32_t page_count;
+
+    uint32_t *page_slots;  // slot of every page, VIRTUAL_TEXTURE_NO_PAGE when it is not resident
+    uint64_t *page_frames; // feedback the page was last asked for in, keeps requests unique
+    uint32_t *slot_pages;  // page in every slot, VIRTUAL_TEXTURE_NO_PAGE when the slot is free
+    uint64_t *slot_frames; // feedback the page in the slot was last seen in
+    uint32_t slot_count;
+    uint32_t *pending_slots; // mapped by virtual_texture_next since the last commit or cancel
+    uint32_t pending_count;
+
+    // pages the last feedback asked for that are not resident, coarsest first
+    uint32_t *requests;
+    uint32_t request_count;
+    uint32_t next_request;
+
+    // page table with the levels back to back, an entry is the rgba8 slot x, slot y and level of the page to sample,
+    // a page that is not resident points at its nearest resident ancestor
+    uint32_t *table;
+    uint32_t table_size; // entries
+    bool table_dirty;
+} virtual_texture;
+
+// false when the chain can not be paged with settings: its level 0 sides have to be powers of two of at least a page,
+// a block format needs block aligned pages and borders, and the cache has to hold the pages of the coarsest level
+extern bool virtual_texture_init(virtual_texture *texture, const texture_chain *chain, const virtual_texture_settings *settings);
+
+extern void virtual_texture_free(virtual_texture *texture);
+
+// bytes of a page with its border as stored in the chain format, rows of blocks back to back
+extern size_t virtual_texture_page_bytes(const virtual_texture *texture);
+
+// texels of a cache image side
+extern uint32_t virtual_texture_cache_width(const virtual_texture *texture);
+extern uint32_t virtual_texture_cache_height(const virtual_texture *texture);
+
+// take the pages a feedback pass read back, the resident ones and their ancestors count as used at frame, which starts at 1,
+// for a missing one the coarsest missing ancestor is requested, so detail arrives level by level
+extern void virtual_texture_feedback(virtual_texture *texture, const uint32_t *pages, uint32_t count, uint64_t frame);
+
+// map the next requested page into a free slot, or the least recently used slot not seen in the feedback of frame,
+// false when nothing is requested or every slot is in use, the page has to be copied into the slot before the table is used
+extern bool virtual_texture_next(virtual_texture *texture, uint64_t frame, uint32_t *level, uint32_t *x, uint32_t *y, uint32_t *slot);
+
+// the pages mapped since the last commit or cancel had their texels copied
+extern void virtual_texture_commit(virtual_texture *texture);
+
+// the copies of the pages mapped since the last commit or cancel failed, their slots are free again
+// and the pages are requested anew by later feedback
+extern void virtual_texture_cancel(virtual_texture *texture);
+
+// request every page of the coarsest level, at startup before any feedback, they are never evicted once mapped
+extern void virtual_texture_request_tail(virtual_texture *texture);
+
+// cut a page out of its level with the border around it, edges of the level repeat
+extern void virtual_texture_copy_page(const virtual_texture *texture, uint32_t level, uint32_t x, uint32_t y, uint8_t *page);
+
+// write the table again if pages moved since the last call, true when it did
+extern bool virtual_texture_update_table(virtual_texture *texture);
+
+#endif //VK_EXAMPLE_VIRTUAL_TEXTURE_H
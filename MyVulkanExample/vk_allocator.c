@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "example.h"
+#include "vk_allocator.h"
+
+#ifdef WIN32
+#include <Windows.h>
+#include <malloc.h>
+#endif
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+// command scope allocations up to the largest class and this alignment come from the pool of the calling thread
+static const size_t POOL_ALIGNMENT = 16;
+static const size_t POOL_CLASS_SIZES[] = {64, 128, 256, 512, 1024, 2048, 4096};
+#define POOL_CLASS_COUNT 7
+// slots of a class are cut from chunks of this size
+static const size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+typedef struct thread_pool_chunk {
+    struct thread_pool_chunk *next;
+} thread_pool_chunk;
+
+// slots freed by their owner go to its free lists without a lock, slots freed on another thread are pushed onto
+// remote_slots and taken back by the owner when a free list runs dry
+typedef struct command_pool {
+    struct command_pool *next; // in the list of every pool
+    void *free_slots[POOL_CLASS_COUNT];
+    void * volatile remote_slots;
+    thread_pool_chunk *chunks;
+    uint8_t *chunk_next;
+    uint8_t *chunk_end;
+} command_pool;
+
+// right in front of every allocation
+typedef struct allocation_header {
+    size_t size;
+    command_pool *pool;  // owner of a pooled slot, NULL for the heap
+    uint32_t scope;
+    uint32_t size_class; // of a pooled slot, the offset from the start of the heap allocation otherwise
+} allocation_header;
+
+// the header rounded up to POOL_ALIGNMENT keeps pooled slots aligned
+#define HEADER_SIZE ((sizeof(allocation_header) + 15) & ~(size_t)15)
+
+static vk_allocator_stats s_stats;
+static command_pool * volatile s_pools;
+// set by vk_allocator_shutdown, from then on every allocation comes from the heap
+static volatile LONG s_shut_down;
+static THREAD_LOCAL command_pool *s_thread_pool;
+
+static void * heap_allocate(size_t size, size_t alignment) {
+#if defined(_MSC_VER)
+    return _aligned_malloc(size, alignment);
+#else
+    void *memory = NULL;
+    return posix_memalign(&memory, MAX(alignment, sizeof(void *)), size) ? NULL : memory;
+#endif
+}
+
+static void heap_free(void *memory) {
+#if defined(_MSC_VER)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+static allocation_header * get_header(void *memory) {
+    return (allocation_header *)((uint8_t *)memory - HEADER_SIZE);
+}
+
+static void count_bytes(vk_allocator_scope_stats *stats, int64_t delta) {
+    int64_t bytes = InterlockedExchangeAdd64(&(stats->bytes), (LONGLONG)delta) + delta;
+    int64_t peak = stats->peak_bytes;
+    while (bytes > peak) {
+        int64_t seen = InterlockedCompareExchange64(&(stats->peak_bytes), bytes, peak);
+        if (seen == peak) {
+            break;
+        }
+        peak = seen;
+    }
+}
+
+static void count_allocation(uint32_t scope, size_t size, bool pooled) {
+    vk_allocator_scope_stats *stats = s_stats.scopes + scope;
+    count_bytes(stats, (int64_t)size);
+    InterlockedIncrement64(&(stats->count));
+    InterlockedIncrement64(&(stats->allocations));
+    if (pooled) {
+        InterlockedIncrement64(&(stats->pooled));
+    }
+}
+
+static void count_free(uint32_t scope, size_t size) {
+    vk_allocator_scope_stats *stats = s_stats.scopes + scope;
+    InterlockedExchangeAdd64(&(stats->bytes), -(LONGLONG)size);
+    InterlockedDecrement64(&(stats->count));
+    InterlockedIncrement64(&(stats->frees));
+}
+
+static command_pool * get_thread_pool(void) {
+    // the pool of this thread may be freed already, so it is not even looked at
+    if (s_shut_down) {
+        return NULL;
+    }
+    if (!s_thread_pool) {
+        command_pool *pool = calloc(1, sizeof(command_pool));
+        if (!pool) {
+            return NULL;
+        }
+        // pools are only ever added until shutdown, so a plain compare and swap push is safe
+        do {
+            pool->next = s_pools;
+        } while (InterlockedCompareExchangePointer((PVOID volatile *)&s_pools, pool, pool->next) != pool->next);
+        s_thread_pool = pool;
+    }
+    return s_thread_pool;
+}
+
+static uint32_t get_size_class(size_t size) {
+    uint32_t size_class = 0;
+    while (size_class < POOL_CLASS_COUNT && POOL_CLASS_SIZES[size_class] < size) {
+        ++ size_class;
+    }
+    return size_class;
+}
+
+// take back the slots other threads freed into their free lists
+static void collect_remote_slots(command_pool *pool) {
+    void *slot = InterlockedExchangePointer((PVOID volatile *)&(pool->remote_slots), NULL);
+    while (slot) {
+        void *next = *(void **)slot;
+        uint32_t size_class = ((allocation_header *)slot)->size_class;
+        *(void **)slot = pool->free_slots[size_class];
+        pool->free_slots[size_class] = slot;
+        slot = next;
+    }
+}
+
+// a slot starts at its header, a free one holds the next free slot there
+static void * pool_allocate(command_pool *pool, uint32_t size_class) {
+    if (!pool->free_slots[size_class]) {
+        collect_remote_slots(pool);
+    }
+
+    void *slot = pool->free_slots[size_class];
+    if (slot) {
+        pool->free_slots[size_class] = *(void **)slot;
+        return slot;
+    }
+
+    size_t slot_size = HEADER_SIZE + POOL_CLASS_SIZES[size_class];
+    if (pool->chunk_next + slot_size > pool->chunk_end) {
+        thread_pool_chunk *chunk = heap_allocate(POOL_CHUNK_SIZE, POOL_ALIGNMENT);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->next = pool->chunks;
+        pool->chunks = chunk;
+        pool->chunk_next = (uint8_t *)chunk + POOL_ALIGNMENT;
+        pool->chunk_end = (uint8_t *)chunk + POOL_CHUNK_SIZE;
+    }
+    slot = pool->chunk_next;
+    pool->chunk_next += slot_size;
+    return slot;
+}
+
+static void pool_free(allocation_header *header) {
+    command_pool *pool = header->pool;
+    void *slot = header;
+    if (pool == s_thread_pool) {
+        *(void **)slot = pool->free_slots[header->size_class];
+        pool->free_slots[header->size_class] = slot;
+        return;
+    }
+
+    // the size class has to survive in the header, so the link goes where the size was
+    void *head;
+    do {
+        head = pool->remote_slots;
+        *(void **)slot = head;
+    } while (InterlockedCompareExchangePointer((PVOID volatile *)&(pool->remote_slots), slot, head) != head);
+}
+
+static void * VKAPI_PTR allocate(void *user_data, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (!size) {
+        return NULL;
+    }
+    alignment = MAX(alignment, 1);
+
+    allocation_header *header = NULL;
+    if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && alignment <= POOL_ALIGNMENT && size <= POOL_CLASS_SIZES[POOL_CLASS_COUNT - 1]) {
+        command_pool *pool = get_thread_pool();
+        uint32_t size_class = get_size_class(size);
+        header = pool ? pool_allocate(pool, size_class) : NULL;
+        if (header) {
+            header->pool = pool;
+            header->size_class = size_class;
+        }
+    }
+
+    if (!header) {
+        size_t offset = (HEADER_SIZE + alignment - 1) & ~(alignment - 1);
+        uint8_t *memory = heap_allocate(offset + size, MAX(alignment, POOL_ALIGNMENT));
+        if (!memory) {
+            return NULL;
+        }
+        header = (allocation_header *)(memory + offset - HEADER_SIZE);
+        header->pool = NULL;
+        header->size_class = (uint32_t)offset;
+    }
+
+    header->size = size;
+    header->scope = (uint32_t)scope;
+    count_allocation(header->scope, size, header->pool != NULL);
+    return (uint8_t *)header + HEADER_SIZE;
+}
+
+static void VKAPI_PTR release(void *user_data, void *memory) {
+    if (!memory) {
+        return;
+    }
+
+    allocation_header *header = get_header(memory);
+    count_free(header->scope, header->size);
+    if (header->pool) {
+        pool_free(header);
+    } else {
+        heap_free((uint8_t *)header + HEADER_SIZE - header->size_class);
+    }
+}
+
+static void * VKAPI_PTR reallocate(void *user_data, void *original, size_t size, size_t alignment, VkSystemAllocationScope scope) {
+    if (!original) {
+        return allocate(user_data, size, alignment, scope);
+    }
+    if (!size) {
+        release(user_data, original);
+        return NULL;
+    }
+
+    // a pooled slot grows in place up to its class
+    allocation_header *header = get_header(original);
+    if (header->pool && header->scope == (uint32_t)scope && size <= POOL_CLASS_SIZES[header->size_class] && alignment <= POOL_ALIGNMENT) {
+        count_bytes(s_stats.scopes + scope, (int64_t)size - (int64_t)header->size);
+        header->size = size;
+        return original;
+    }
+
+    void *memory = allocate(user_data, size, alignment, scope);
+    if (memory) {
+        memcpy(memory, original, MIN(size, header->size));
+        release(user_data, original);
+    }
+    return memory;
+}
+
+static void VKAPI_PTR notify_internal_allocation(void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    InterlockedExchangeAdd64(&(s_stats.internal_bytes), (LONGLONG)size);
+}
+
+static void VKAPI_PTR notify_internal_free(void *user_data, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope) {
+    InterlockedExchangeAdd64(&(s_stats.internal_bytes), -(LONGLONG)size);
+}
+
+static const VkAllocationCallbacks s_callbacks = {
+    .pUserData = NULL,
+    .pfnAllocation = allocate,
+    .pfnReallocation = reallocate,
+    .pfnFree = release,
+    .pfnInternalAllocation = notify_internal_allocation,
+    .pfnInternalFree = notify_internal_free
+};
+
+const VkAllocationCallbacks * vk_allocator_callbacks(void) {
+    return &s_callbacks;
+}
+
+void vk_allocator_snapshot(vk_allocator_stats *stats) {
+    for (uint32_t i = 0; i < VK_ALLOCATOR_SCOPE_COUNT; ++i) {
+        const volatile vk_allocator_scope_stats *scope = s_stats.scopes + i;
+        stats->scopes[i].bytes = scope->bytes;
+        stats->scopes[i].count = scope->count;
+        stats->scopes[i].peak_bytes = scope->peak_bytes;
+        stats->scopes[i].allocations = scope->allocations;
+        stats->scopes[i].frees = scope->frees;
+        stats->scopes[i].pooled = scope->pooled;
+    }
+    stats->internal_bytes = *(volatile int64_t *)&(s_stats.internal_bytes);
+}
+
+void vk_allocator_difference(const vk_allocator_stats *now, const vk_allocator_stats *before, vk_allocator_stats *difference) {
+    for (uint32_t i = 0; i < VK_ALLOCATOR_SCOPE_COUNT; ++i) {
+        const vk_allocator_scope_stats *a = now->scopes + i;
+        const vk_allocator_scope_stats *b = before->scopes + i;
+        vk_allocator_scope_stats *d = difference->scopes + i;
+        d->bytes = a->bytes - b->bytes;
+        d->count = a->count - b->count;
+        d->peak_bytes = a->peak_bytes;
+        d->allocations = a->allocations - b->allocations;
+        d->frees = a->frees - b->frees;
+        d->pooled = a->pooled - b->pooled;
+    }
+    difference->internal_bytes = now->internal_bytes - before->internal_bytes;
+}
+
+static const char *SCOPE_NAMES[VK_ALLOCATOR_SCOPE_COUNT] = {"command", "object", "cache", "device", "instance"};
+
+void vk_allocator_log(const char *title, const vk_allocator_stats *stats) {
+    LOG("%s, %lld internal bytes\n", title, (long long)stats->internal_bytes);
+    for (uint32_t i = 0; i < VK_ALLOCATOR_SCOPE_COUNT; ++i) {
+        const vk_allocator_scope_stats *scope = stats->scopes + i;
+        LOG("    %-8s %lld bytes in %lld allocations, peak %lld bytes, %lld allocated %lld pooled %lld freed\n", SCOPE_NAMES[i],
+            (long long)scope->bytes, (long long)scope->count, (long long)scope->peak_bytes, (long long)scope->allocations, (long long)scope->pooled, (long long)scope->frees);
+    }
+}
+
+void vk_allocator_print(const vk_allocator_stats *stats) {
+    printf("%-12s %12s %10s %10s %10s %14s\n", "host scope", "allocated", "pooled", "freed", "live", "live bytes");
+    for (uint32_t i = 0; i < VK_ALLOCATOR_SCOPE_COUNT; ++i) {
+        const vk_allocator_scope_stats *scope = stats->scopes + i;
+        printf("%-12s %12lld %10lld %10lld %10lld %14lld\n", SCOPE_NAMES[i], (long long)scope->allocations, (long long)scope->pooled,
+               (long long)scope->frees, (long long)scope->count, (long long)scope->bytes);
+    }
+    printf("%-12s %60lld\n", "internal", (long long)stats->internal_bytes);
+}
+
+bool vk_allocator_shutdown(void) {
+    InterlockedExchange(&s_shut_down, 1);
+
+    // a live pooled slot would point into a freed chunk, so while anything is left the pools stay
+    for (uint32_t i = 0; i < VK_ALLOCATOR_SCOPE_COUNT; ++i) {
+        if (*(volatile int64_t *)&(s_stats.scopes[i].count) != 0) {
+            LOG("Driver host allocations are left, the allocator pools are kept!\n");
+            return false;
+        }
+    }
+
+    command_pool *pool = InterlockedExchangePointer((PVOID volatile *)&s_pools, NULL);
+    while (pool) {
+        command_pool *next = pool->next;
+        thread_pool_chunk *chunk = pool->chunks;
+        while (chunk) {
+            thread_pool_chunk *next_chunk = chunk->next;
+            heap_free(chunk);
+            chunk = next_chunk;
+        }
+        free(pool);
+        pool = next;
+    }
+    s_thread_pool = NULL;
+    return true;
+}
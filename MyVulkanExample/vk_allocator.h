@@ -0,0 +1,47 @@
+#ifndef VK_EXAMPLE_VK_ALLOCATOR_H
+#define VK_EXAMPLE_VK_ALLOCATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vulkan/vulkan.h"
+
+// one per VkSystemAllocationScope, command to instance
+#define VK_ALLOCATOR_SCOPE_COUNT 5
+
+typedef struct vk_allocator_scope_stats {
+    int64_t bytes;       // live
+    int64_t count;       // live allocations
+    int64_t peak_bytes;
+    int64_t allocations; // calls so far, a reallocation to a new place counts as one
+    int64_t frees;
+    int64_t pooled;      // allocations served from a per thread pool
+} vk_allocator_scope_stats;
+
+typedef struct vk_allocator_stats {
+    vk_allocator_scope_stats scopes[VK_ALLOCATOR_SCOPE_COUNT];
+    int64_t internal_bytes; // the driver allocated itself and reported, executable memory mostly
+} vk_allocator_stats;
+
+// the callbacks MY_VK_ALLOCATOR passes to every create and destroy call, short lived command scope allocations
+// come from pools of the calling thread, the rest from the heap
+extern const VkAllocationCallbacks * vk_allocator_callbacks(void);
+
+// the counters now, each is read on its own while other threads may be allocating
+extern void vk_allocator_snapshot(vk_allocator_stats *stats);
+
+// what happened between two snapshots, live bytes and counts are changes, peaks are those of now
+extern void vk_allocator_difference(const vk_allocator_stats *now, const vk_allocator_stats *before, vk_allocator_stats *difference);
+
+extern void vk_allocator_log(const char *title, const vk_allocator_stats *stats);
+
+// the same as a table on stdout, for reports that are printed in release builds too
+extern void vk_allocator_print(const vk_allocator_stats *stats);
+
+// give the pool memory of every thread back, call it once no thread uses the callbacks any more,
+// false when allocations are still live, their pools are kept then,
+// the callbacks keep working afterwards but every allocation comes from the heap
+extern bool vk_allocator_shutdown(void);
+
+#endif //VK_EXAMPLE_VK_ALLOCATOR_H
@@ -100,6 +100,30 @@ extern int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
                                   size_t *num_materials_out,
                                   const char *filename);
 
+/* Runs task(task_data, i) for every i in [0, count) and returns after all of
+ * them finished. Calls may run concurrently.
+ */
+typedef void (*tinyobj_task_func)(void *task_data, size_t index);
+typedef void (*tinyobj_parallel_for_func)(void *user_data, size_t count,
+                                          tinyobj_task_func task,
+                                          void *task_data);
+
+/* Same result as tinyobj_parse_obj, but `buf' is split into `num_chunks'
+ * newline-aligned chunks whose lines are parsed and whose attributes are
+ * constructed through `parallel_for'. Chunk-local counts are rebased with
+ * prefix sums so relative face indices and material ids match the serial
+ * parser. `parallel_for' may be NULL, the chunks then run one by one.
+ */
+extern int tinyobj_parse_obj_parallel(tinyobj_attrib_t *attrib,
+                                      tinyobj_shape_t **shapes,
+                                      size_t *num_shapes,
+                                      tinyobj_material_t **materials,
+                                      size_t *num_materials, const char *buf,
+                                      size_t len, unsigned int flags,
+                                      size_t num_chunks,
+                                      tinyobj_parallel_for_func parallel_for,
+                                      void *user_data);
+
 extern void tinyobj_attrib_init(tinyobj_attrib_t *attrib);
 extern void tinyobj_attrib_free(tinyobj_attrib_t *attrib);
 extern void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes);
@@ -1161,6 +1185,137 @@ static int is_line_ending(const char *p, size_t i, size_t end_i) {
   return 0;
 }
 
+/* Buffers may carry a terminating '\0', which is not part of the content. */
+static size_t content_end(const char *buf, size_t len) {
+  return buf[len - 1] == '\0' ? len - 1 : len;
+}
+
+/* The last line may end at the end of the buffer instead of a line ending. */
+static int has_trailing_line(const char *buf, size_t end_idx) {
+  return end_idx > 0 && !is_line_ending(buf, end_idx - 1, end_idx);
+}
+
+/* Returns the material selected by an usemtl command, or `material_id' when
+ * the command carries no name.
+ */
+static int lookup_material_id(const Command *command, int material_id,
+                              hash_table_t *material_table) {
+  if (command->material_name &&
+     command->material_name_len >0) 
+  {
+    /* Create a null terminated string */
+    char* material_name_null_term = (char*) malloc(command->material_name_len + 1);
+    memcpy((void*) material_name_null_term, (const void*) command->material_name, command->material_name_len);
+    material_name_null_term[command->material_name_len - 1] = 0;
+
+    if (hash_table_exists(material_name_null_term, material_table))
+      material_id = (int)hash_table_get(material_name_null_term, material_table);
+    else
+      material_id = -1;
+
+    free(material_name_null_term);
+  }
+
+  return material_id;
+}
+
+static void construct_shapes(const Command *commands, size_t num_lines,
+                             tinyobj_shape_t **shapes, size_t *num_shapes) {
+  unsigned int face_count = 0;
+  size_t i = 0;
+  size_t n = 0;
+  size_t shape_idx = 0;
+
+  const char *shape_name = NULL;
+  unsigned int shape_name_len = 0;
+  const char *prev_shape_name = NULL;
+  unsigned int prev_shape_name_len = 0;
+  unsigned int prev_shape_face_offset = 0;
+  unsigned int prev_shape_length = 0;
+  unsigned int prev_face_offset = 0;
+  tinyobj_shape_t prev_shape = {NULL, 0, 0};
+
+  /* Find the number of shapes in .obj */
+  for (i = 0; i < num_lines; i++) {
+    if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
+      n++;
+    }
+  }
+
+  /* Allocate array of shapes with maximum possible size(+1 for unnamed
+   * group/object).
+   * Actual # of shapes found in .obj is determined in the later */
+  (*shapes) = malloc(sizeof(tinyobj_shape_t) * (n + 1));
+
+  for (i = 0; i < num_lines; i++) {
+    if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
+      if (commands[i].type == COMMAND_O) {
+        shape_name = commands[i].object_name;
+        shape_name_len = commands[i].object_name_len;
+      } else {
+        shape_name = commands[i].group_name;
+        shape_name_len = commands[i].group_name_len;
+      }
+
+      if (face_count == 0) {
+        /* 'o' or 'g' appears before any 'f' */
+        prev_shape_name = shape_name;
+        prev_shape_name_len = shape_name_len;
+        prev_shape_face_offset = face_count;
+        prev_face_offset = face_count;
+      } else {
+        if (shape_idx == 0) {
+          /* 'o' or 'g' after some 'v' lines. */
+          (*shapes)[shape_idx].name = my_strndup(
+                                                 prev_shape_name, prev_shape_name_len); /* may be NULL */
+          (*shapes)[shape_idx].face_offset = prev_shape.face_offset;
+          (*shapes)[shape_idx].length = face_count - prev_face_offset;
+          shape_idx++;
+
+          prev_shape_length = face_count - prev_face_offset;
+          prev_face_offset = face_count;
+
+        } else {
+          if ((face_count - prev_face_offset) > 0) {
+            (*shapes)[shape_idx].name =
+              my_strndup(prev_shape_name, prev_shape_name_len);
+            (*shapes)[shape_idx].face_offset = prev_face_offset;
+            (*shapes)[shape_idx].length = face_count - prev_face_offset;
+            shape_idx++;
+            prev_shape_length = face_count - prev_face_offset;
+            prev_face_offset = face_count;
+          }
+        }
+
+        /* Record shape info for succeeding 'o' or 'g' command. */
+        prev_shape_name = shape_name;
+        prev_shape_name_len = shape_name_len;
+        prev_shape_face_offset = face_count;
+        prev_shape_length = 0;
+      }
+    }
+    if (commands[i].type == COMMAND_F) {
+      face_count++;
+    }
+  }
+
+  if ((face_count - prev_face_offset) > 0) {
+    size_t length = face_count - prev_shape_face_offset;
+    if (length > 0) {
+      (*shapes)[shape_idx].name =
+        my_strndup(prev_shape_name, prev_shape_name_len);
+      (*shapes)[shape_idx].face_offset = prev_face_offset;
+      (*shapes)[shape_idx].length = face_count - prev_face_offset;
+      shape_idx++;
+    }
+  } else {
+    /* Guess no 'v' line occurrence after 'o' or 'g', so discards current
+     * shape information. */
+  }
+
+  (*num_shapes) = shape_idx;
+}
+
 int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
                       size_t *num_shapes, tinyobj_material_t **materials_out,
                       size_t *num_materials_out, const char *buf, size_t len,
@@ -1194,16 +1349,19 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
    /* 1. Find '\n' and create line data. */
   {
     size_t i;
-    size_t end_idx = len - 1;
+    size_t end_idx = content_end(buf, len);
     size_t prev_pos = 0;
     size_t line_no = 0;
 
     /* Count # of lines. */
-    for (i = 0; i < end_idx; i++) { /* Assume last char is '\0' */
+    for (i = 0; i < end_idx; i++) {
       if (is_line_ending(buf, i, end_idx)) {
         num_lines++;
       }
     }
+    if (has_trailing_line(buf, end_idx)) {
+      num_lines++;
+    }
 
     if (num_lines == 0) return TINYOBJ_ERROR_EMPTY;
 
@@ -1218,6 +1376,11 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
         line_no++;
       }
     }
+    if (line_no < num_lines) {
+      line_infos[line_no].pos = prev_pos;
+      line_infos[line_no].len = end_idx - prev_pos;
+      line_no++;
+    }
   }
 
   commands = (Command *)malloc(sizeof(Command) * num_lines); 
@@ -1313,21 +1476,7 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
         }
         }
         */
-        if (commands[i].material_name &&
-           commands[i].material_name_len >0) 
-        {
-          /* Create a null terminated string */
-          char* material_name_null_term = (char*) malloc(commands[i].material_name_len + 1);
-          memcpy((void*) material_name_null_term, (const void*) commands[i].material_name, commands[i].material_name_len);
-          material_name_null_term[commands[i].material_name_len - 1] = 0;
-
-          if (hash_table_exists(material_name_null_term, &material_table))
-            material_id = (int)hash_table_get(material_name_null_term, &material_table);
-          else
-            material_id = -1;
-
-          free(material_name_null_term);
-        }
+        material_id = lookup_material_id(&commands[i], material_id, &material_table);
       } else if (commands[i].type == COMMAND_V) {
         attrib->vertices[3 * v_count + 0] = commands[i].vx;
         attrib->vertices[3 * v_count + 1] = commands[i].vy;
@@ -1366,108 +1515,361 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   }
 
   /* 5. Construct shape information. */
-  {
-    unsigned int face_count = 0;
-    size_t i = 0;
-    size_t n = 0;
-    size_t shape_idx = 0;
-
-    const char *shape_name = NULL;
-    unsigned int shape_name_len = 0;
-    const char *prev_shape_name = NULL;
-    unsigned int prev_shape_name_len = 0;
-    unsigned int prev_shape_face_offset = 0;
-    unsigned int prev_shape_length = 0;
-    unsigned int prev_face_offset = 0;
-    tinyobj_shape_t prev_shape = {NULL, 0, 0};
-
-    /* Find the number of shapes in .obj */
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        n++;
-      }
-    }
+  construct_shapes(commands, num_lines, shapes, num_shapes);
 
-    /* Allocate array of shapes with maximum possible size(+1 for unnamed
-     * group/object).
-     * Actual # of shapes found in .obj is determined in the later */
-    (*shapes) = malloc(sizeof(tinyobj_shape_t) * (n + 1));
+  if (commands) {
+    free(commands);
+  }
 
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_O || commands[i].type == COMMAND_G) {
-        if (commands[i].type == COMMAND_O) {
-          shape_name = commands[i].object_name;
-          shape_name_len = commands[i].object_name_len;
-        } else {
-          shape_name = commands[i].group_name;
-          shape_name_len = commands[i].group_name_len;
-        }
+  destroy_hash_table(&material_table);
+  
+  (*materials_out) = materials;
+  (*num_materials_out) = num_materials;
 
-        if (face_count == 0) {
-          /* 'o' or 'g' appears before any 'f' */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
-          prev_face_offset = face_count;
-        } else {
-          if (shape_idx == 0) {
-            /* 'o' or 'g' after some 'v' lines. */
-            (*shapes)[shape_idx].name = my_strndup(
-                                                   prev_shape_name, prev_shape_name_len); /* may be NULL */
-            (*shapes)[shape_idx].face_offset = prev_shape.face_offset;
-            (*shapes)[shape_idx].length = face_count - prev_face_offset;
-            shape_idx++;
+  return TINYOBJ_SUCCESS;
+}
 
-            prev_shape_length = face_count - prev_face_offset;
-            prev_face_offset = face_count;
+typedef struct {
+  size_t begin; /* first byte, always right after a line ending */
+  size_t end;
 
-          } else {
-            if ((face_count - prev_face_offset) > 0) {
-              (*shapes)[shape_idx].name =
-                my_strndup(prev_shape_name, prev_shape_name_len);
-              (*shapes)[shape_idx].face_offset = prev_face_offset;
-              (*shapes)[shape_idx].length = face_count - prev_face_offset;
-              shape_idx++;
-              prev_shape_length = face_count - prev_face_offset;
-              prev_face_offset = face_count;
-            }
-          }
+  size_t line_offset;
+  size_t num_lines;
 
-          /* Record shape info for succeeding 'o' or 'g' command. */
-          prev_shape_name = shape_name;
-          prev_shape_name_len = shape_name_len;
-          prev_shape_face_offset = face_count;
-          prev_shape_length = 0;
-        }
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_faces;
+
+  size_t v_offset;
+  size_t vn_offset;
+  size_t vt_offset;
+  size_t f_offset;
+  size_t face_offset;
+
+  int mtllib_line_index; /* last mtllib of the chunk, -1 if none */
+  int usemtl_line_index; /* last usemtl of the chunk, -1 if none */
+  int material_id;       /* material in effect at the start of the chunk */
+  int pad0;
+} ParseChunk;
+
+typedef struct {
+  const char *buf;
+  size_t end_idx;
+  int triangulate;
+  int pad0;
+
+  ParseChunk *chunks;
+  LineInfo *line_infos;
+  Command *commands;
+
+  tinyobj_attrib_t *attrib;
+  hash_table_t *material_table;
+} ParallelParseContext;
+
+static void count_chunk_lines(void *task_data, size_t index) {
+  ParallelParseContext *context = (ParallelParseContext *)task_data;
+  ParseChunk *chunk = &context->chunks[index];
+  size_t i;
+
+  chunk->num_lines = 0;
+  for (i = chunk->begin; i < chunk->end; i++) {
+    if (is_line_ending(context->buf, i, context->end_idx)) {
+      chunk->num_lines++;
+    }
+  }
+  /* Chunks start right after a line ending, so only the last non-empty one
+   * can hold a trailing line. */
+  if (chunk->begin < chunk->end && chunk->end == context->end_idx &&
+      has_trailing_line(context->buf, context->end_idx)) {
+    chunk->num_lines++;
+  }
+}
+
+static void parse_chunk_lines(void *task_data, size_t index) {
+  ParallelParseContext *context = (ParallelParseContext *)task_data;
+  ParseChunk *chunk = &context->chunks[index];
+  LineInfo *line_infos = context->line_infos + chunk->line_offset;
+  Command *commands = context->commands + chunk->line_offset;
+  size_t i;
+  size_t line_no = 0;
+  size_t prev_pos = chunk->begin;
+
+  for (i = chunk->begin; i < chunk->end; i++) {
+    if (is_line_ending(context->buf, i, context->end_idx)) {
+      line_infos[line_no].pos = prev_pos;
+      line_infos[line_no].len = i - prev_pos;
+      prev_pos = i + 1;
+      line_no++;
+    }
+  }
+  if (line_no < chunk->num_lines) {
+    line_infos[line_no].pos = prev_pos;
+    line_infos[line_no].len = chunk->end - prev_pos;
+    line_no++;
+  }
+
+  chunk->num_v = 0;
+  chunk->num_vn = 0;
+  chunk->num_vt = 0;
+  chunk->num_f = 0;
+  chunk->num_faces = 0;
+  chunk->mtllib_line_index = -1;
+  chunk->usemtl_line_index = -1;
+
+  for (i = 0; i < chunk->num_lines; i++) {
+    int ret = parseLine(&commands[i], &context->buf[line_infos[i].pos],
+                        line_infos[i].len, context->triangulate);
+    if (ret) {
+      if (commands[i].type == COMMAND_V) {
+        chunk->num_v++;
+      } else if (commands[i].type == COMMAND_VN) {
+        chunk->num_vn++;
+      } else if (commands[i].type == COMMAND_VT) {
+        chunk->num_vt++;
+      } else if (commands[i].type == COMMAND_F) {
+        chunk->num_f += commands[i].num_f;
+        chunk->num_faces += commands[i].num_f_num_verts;
+      } else if (commands[i].type == COMMAND_USEMTL) {
+        chunk->usemtl_line_index = (int)(chunk->line_offset + i);
       }
-      if (commands[i].type == COMMAND_F) {
-        face_count++;
+
+      if (commands[i].type == COMMAND_MTLLIB) {
+        chunk->mtllib_line_index = (int)(chunk->line_offset + i);
       }
     }
+  }
+}
 
-    if ((face_count - prev_face_offset) > 0) {
-      size_t length = face_count - prev_shape_face_offset;
-      if (length > 0) {
-        (*shapes)[shape_idx].name =
-          my_strndup(prev_shape_name, prev_shape_name_len);
-        (*shapes)[shape_idx].face_offset = prev_face_offset;
-        (*shapes)[shape_idx].length = face_count - prev_face_offset;
-        shape_idx++;
+static void construct_chunk_attrib(void *task_data, size_t index) {
+  ParallelParseContext *context = (ParallelParseContext *)task_data;
+  ParseChunk *chunk = &context->chunks[index];
+  tinyobj_attrib_t *attrib = context->attrib;
+  const Command *commands = context->commands + chunk->line_offset;
+
+  /* running counts start at the chunk bases, so relative indices resolve
+   * against every vertex seen before this line, not only this chunk's */
+  size_t v_count = chunk->v_offset;
+  size_t n_count = chunk->vn_offset;
+  size_t t_count = chunk->vt_offset;
+  size_t f_count = chunk->f_offset;
+  size_t face_count = chunk->face_offset;
+  int material_id = chunk->material_id;
+  size_t i = 0;
+
+  for (i = 0; i < chunk->num_lines; i++) {
+    if (commands[i].type == COMMAND_EMPTY) {
+      continue;
+    } else if (commands[i].type == COMMAND_USEMTL) {
+      material_id = lookup_material_id(&commands[i], material_id, context->material_table);
+    } else if (commands[i].type == COMMAND_V) {
+      attrib->vertices[3 * v_count + 0] = commands[i].vx;
+      attrib->vertices[3 * v_count + 1] = commands[i].vy;
+      attrib->vertices[3 * v_count + 2] = commands[i].vz;
+      v_count++;
+    } else if (commands[i].type == COMMAND_VN) {
+      attrib->normals[3 * n_count + 0] = commands[i].nx;
+      attrib->normals[3 * n_count + 1] = commands[i].ny;
+      attrib->normals[3 * n_count + 2] = commands[i].nz;
+      n_count++;
+    } else if (commands[i].type == COMMAND_VT) {
+      attrib->texcoords[2 * t_count + 0] = commands[i].tx;
+      attrib->texcoords[2 * t_count + 1] = commands[i].ty;
+      t_count++;
+    } else if (commands[i].type == COMMAND_F) {
+      size_t k = 0;
+      for (k = 0; k < commands[i].num_f; k++) {
+        tinyobj_vertex_index_t vi = commands[i].f[k];
+        attrib->faces[f_count + k].v_idx = fixIndex(vi.v_idx, v_count);
+        attrib->faces[f_count + k].vn_idx = fixIndex(vi.vn_idx, n_count);
+        attrib->faces[f_count + k].vt_idx = fixIndex(vi.vt_idx, t_count);
       }
-    } else {
-      /* Guess no 'v' line occurrence after 'o' or 'g', so discards current
-       * shape information. */
+
+      for (k = 0; k < commands[i].num_f_num_verts; k++) {
+        attrib->material_ids[face_count + k] = material_id;
+        attrib->face_num_verts[face_count + k] = commands[i].f_num_verts[k];
+      }
+
+      f_count += commands[i].num_f;
+      face_count += commands[i].num_f_num_verts;
     }
+  }
+}
+
+static void run_chunks(tinyobj_parallel_for_func parallel_for, void *user_data,
+                       size_t num_chunks, tinyobj_task_func task,
+                       ParallelParseContext *context) {
+  size_t i;
+
+  if (parallel_for) {
+    parallel_for(user_data, num_chunks, task, context);
+    return;
+  }
 
-    (*num_shapes) = shape_idx;
+  for (i = 0; i < num_chunks; i++) {
+    task(context, i);
   }
+}
 
-  if (commands) {
-    free(commands);
+int tinyobj_parse_obj_parallel(tinyobj_attrib_t *attrib,
+                               tinyobj_shape_t **shapes, size_t *num_shapes,
+                               tinyobj_material_t **materials_out,
+                               size_t *num_materials_out, const char *buf,
+                               size_t len, unsigned int flags,
+                               size_t num_chunks,
+                               tinyobj_parallel_for_func parallel_for,
+                               void *user_data) {
+  ParallelParseContext context;
+  ParseChunk *chunks = NULL;
+  size_t num_lines = 0;
+
+  size_t num_v = 0;
+  size_t num_vn = 0;
+  size_t num_vt = 0;
+  size_t num_f = 0;
+  size_t num_faces = 0;
+
+  int mtllib_line_index = -1;
+
+  tinyobj_material_t *materials = NULL;
+  size_t num_materials = 0;
+
+  hash_table_t material_table;
+
+  size_t end_idx;
+  size_t i;
+
+  if (len < 1) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (attrib == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_shapes == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (buf == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (num_materials_out == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+
+  tinyobj_attrib_init(attrib);
+
+  end_idx = content_end(buf, len);
+  if (num_chunks < 1) num_chunks = 1;
+  if (num_chunks > end_idx) num_chunks = end_idx > 0 ? end_idx : 1;
+
+  /* 1. Split into chunks which start right after a line ending. */
+  chunks = (ParseChunk *)malloc(sizeof(ParseChunk) * num_chunks);
+  chunks[0].begin = 0;
+  for (i = 1; i < num_chunks; i++) {
+    size_t pos = end_idx / num_chunks * i;
+    if (pos < chunks[i - 1].begin) pos = chunks[i - 1].begin;
+    while (pos < end_idx && !is_line_ending(buf, pos, end_idx)) pos++;
+    chunks[i].begin = pos < end_idx ? pos + 1 : end_idx;
+    chunks[i - 1].end = chunks[i].begin;
+  }
+  chunks[num_chunks - 1].end = end_idx;
+
+  context.buf = buf;
+  context.end_idx = end_idx;
+  context.triangulate = flags & TINYOBJ_FLAG_TRIANGULATE;
+  context.chunks = chunks;
+  context.line_infos = NULL;
+  context.commands = NULL;
+  context.attrib = attrib;
+  context.material_table = &material_table;
+
+  /* 2. Count lines per chunk and assign each chunk its range of lines. */
+  run_chunks(parallel_for, user_data, num_chunks, count_chunk_lines, &context);
+
+  for (i = 0; i < num_chunks; i++) {
+    chunks[i].line_offset = num_lines;
+    num_lines += chunks[i].num_lines;
+  }
+
+  if (num_lines == 0) {
+    free(chunks);
+    return TINYOBJ_ERROR_EMPTY;
+  }
+
+  context.line_infos = (LineInfo *)malloc(sizeof(LineInfo) * num_lines);
+  context.commands = (Command *)malloc(sizeof(Command) * num_lines);
+
+  /* 3. parse each line */
+  run_chunks(parallel_for, user_data, num_chunks, parse_chunk_lines, &context);
+
+  free(context.line_infos);
+  context.line_infos = NULL;
+
+  /* Rebase chunk-local counts to global offsets. */
+  for (i = 0; i < num_chunks; i++) {
+    chunks[i].v_offset = num_v;
+    chunks[i].vn_offset = num_vn;
+    chunks[i].vt_offset = num_vt;
+    chunks[i].f_offset = num_f;
+    chunks[i].face_offset = num_faces;
+
+    num_v += chunks[i].num_v;
+    num_vn += chunks[i].num_vn;
+    num_vt += chunks[i].num_vt;
+    num_f += chunks[i].num_f;
+    num_faces += chunks[i].num_faces;
+
+    if (chunks[i].mtllib_line_index >= 0) {
+      mtllib_line_index = chunks[i].mtllib_line_index;
+    }
+  }
+
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+
+  /* Load material(if exits) */
+  if (mtllib_line_index >= 0 && context.commands[mtllib_line_index].mtllib_name &&
+      context.commands[mtllib_line_index].mtllib_name_len > 0) {
+    char *filename = my_strndup(context.commands[mtllib_line_index].mtllib_name,
+                                context.commands[mtllib_line_index].mtllib_name_len);
+
+    int ret = tinyobj_parse_and_index_mtl_file(&materials, &num_materials, filename, &material_table);
+
+    if (ret != TINYOBJ_SUCCESS) {
+      /* warning. */
+      fprintf(stderr, "TINYOBJ: Failed to parse .mtl file: %s\n", filename);
+    }
+
+    free(filename);
   }
 
+  /* Carry the active material across chunk boundaries. */
+  {
+    int material_id = -1; /* -1 = default unknown material. */
+    for (i = 0; i < num_chunks; i++) {
+      chunks[i].material_id = material_id;
+      if (chunks[i].usemtl_line_index >= 0) {
+        material_id = lookup_material_id(&context.commands[chunks[i].usemtl_line_index],
+                                         material_id, &material_table);
+      }
+    }
+  }
+
+  /* 4. Construct attributes */
+  attrib->vertices = (float *)malloc(sizeof(float) * num_v * 3);
+  attrib->num_vertices = (unsigned int)num_v;
+  attrib->normals = (float *)malloc(sizeof(float) * num_vn * 3);
+  attrib->num_normals = (unsigned int)num_vn;
+  attrib->texcoords = (float *)malloc(sizeof(float) * num_vt * 2);
+  attrib->num_texcoords = (unsigned int)num_vt;
+  attrib->faces = (tinyobj_vertex_index_t *)malloc(
+                                                   sizeof(tinyobj_vertex_index_t) * num_f);
+  attrib->num_faces = (unsigned int)num_f;
+  attrib->face_num_verts = (int *)malloc(sizeof(int) * num_faces);
+  attrib->material_ids = (int *)malloc(sizeof(int) * num_faces);
+  attrib->num_face_num_verts = (unsigned int)num_faces;
+
+  run_chunks(parallel_for, user_data, num_chunks, construct_chunk_attrib, &context);
+
+  /* 5. Construct shape information. */
+  construct_shapes(context.commands, num_lines, shapes, num_shapes);
+
+  free(context.commands);
+  free(chunks);
+
   destroy_hash_table(&material_table);
-  
+
   (*materials_out) = materials;
   (*num_materials_out) = num_materials;
 